@@ -154,8 +154,9 @@ private:
 	const detail::Graph *			GetGraph() const		{ return m_pGraph; }
 	detail::Graph *					GetGraph()				{ return m_pGraph; }
 
-	int								ComputeBaseLocationScore(BWAPI::TilePosition location) const;
-	bool							ValidateBaseLocation(BWAPI::TilePosition location, std::vector<Mineral *> & BlockingMinerals) const;
+	int								ComputeBaseLocationScore(BWAPI::TilePosition location, const utils::SummedAreaTable & Potentials, const utils::SummedAreaTable & Reserved, const utils::SummedAreaTable & Unbuildable) const;
+	bool							ValidateBaseLocation(BWAPI::TilePosition location, const utils::SummedAreaTable & Obstructing) const;
+	void							CollectBlockingMinerals(BWAPI::TilePosition location, std::vector<Mineral *> & BlockingMinerals) const;
 	std::vector<int>				ComputeDistances(BWAPI::TilePosition start, const std::vector<BWAPI::TilePosition> & Targets) const;
 
 	detail::Graph * const			m_pGraph;
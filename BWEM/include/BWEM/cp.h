@@ -14,6 +14,8 @@
 #include <BWAPI.h>
 #include "bwapiExt.h"
 #include <deque>
+#include <iterator>
+#include <vector>
 #include "utils.h"
 #include "defs.h"
 
@@ -65,7 +67,7 @@ public:
 
 	// Type of all the Paths used in BWEM (Cf. Map::GetPath).
 	// See also the typedef CPPath.
-	typedef std::vector<const ChokePoint *> Path;
+	class Path;
 
 	// Tells whether this ChokePoint is a pseudo ChokePoint, i.e., it was created on top of a blocking Neutral.
 	bool									IsPseudo() const		{ return m_pseudo; }
@@ -125,13 +127,13 @@ public:
 	// The path always starts with this ChokePoint and ends with cp, unless AccessibleFrom(cp) == false.
 	// In this case, an empty list is returned.
 	// Note: if this == cp, returns [cp].
-	// Time complexity: O(1)
+	// Time complexity: O(1). Iterating over the returned Path is O(length of the path).
 	// To get the length of the path returned in pixels, use DistanceFrom(cp).
 	// Note: all the possible Paths are precomputed during Map::Initialize().
 	//       The best one is then stored for each pair of ChokePoints.
 	//       However, only the center of the ChokePoints is considered.
 	//       As a consequence, the returned path may not be the shortest one.
-	const ChokePoint::Path &				GetPathTo(const ChokePoint * cp) const;
+	ChokePoint::Path						GetPathTo(const ChokePoint * cp) const;
 
 	Map *									GetMap() const;
 
@@ -165,6 +167,96 @@ private:
 };
 
 
+
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                          //
+//                                  class ChokePoint::Path
+//                                                                                          //
+//////////////////////////////////////////////////////////////////////////////////////////////
+//
+// A Path is a lightweight view of the list of ChokePoints from a ChokePoint to another one.
+// Rather than storing each Path, BWEM stores, for each pair of ChokePoints (a, b), the ChokePoint that follows a
+// on the Path from a to b (its next hop). The ChokePoints of a Path are produced lazily, one hop after another,
+// so that a Path is cheap to copy and to return by value.
+// empty(), front() and back() are O(1). Iterating, size() and operator[] are O(length of the Path).
+// Note: a Path reflects the current paths of the Map: it should not be kept across a change of Map::PathsVersion().
+//
+
+class ChokePoint::Path
+{
+public:
+	class const_iterator
+	{
+	public:
+		typedef std::input_iterator_tag		iterator_category;
+		typedef const ChokePoint *			value_type;
+		typedef std::ptrdiff_t				difference_type;
+		typedef const ChokePoint * const *	pointer;
+		typedef const ChokePoint *			reference;
+
+											const_iterator() = default;
+
+		const ChokePoint *					operator*() const		{ return m_pChokePoints[m_current]; }
+		const_iterator &					operator++()			{ m_current = (m_current == m_to) ? -1 : m_pNextHops[m_current*m_count + m_to]; return *this; }
+		const_iterator						operator++(int)			{ const_iterator it = *this; ++*this; return it; }
+
+		bool								operator==(const const_iterator & Other) const	{ return m_current == Other.m_current; }
+		bool								operator!=(const const_iterator & Other) const	{ return m_current != Other.m_current; }
+
+	private:
+		friend class Path;
+											const_iterator(const Path & path, index current)
+												: m_pChokePoints(path.m_pChokePoints), m_pNextHops(path.m_pNextHops), m_count(path.m_count), m_to(path.m_to), m_current(current) {}
+
+		ChokePoint * const *				m_pChokePoints = nullptr;
+		const index *						m_pNextHops = nullptr;
+		int									m_count = 0;
+		index								m_to = -1;
+		index								m_current = -1;		// -1 == end
+	};
+
+	typedef const_iterator					iterator;
+	typedef const ChokePoint *				value_type;
+
+	// The empty Path.
+											Path() = default;
+
+	bool									empty() const			{ return m_from == -1; }
+	size_t									size() const			{ size_t n = 0; for (auto it = begin() ; it != end() ; ++it) ++n; return n; }
+
+	const_iterator							begin() const			{ return const_iterator(*this, m_from); }
+	const_iterator							end() const				{ return const_iterator(*this, -1); }
+
+	// Assume !empty().
+	const ChokePoint *						front() const			{ bwem_assert(!empty()); return m_pChokePoints[m_from]; }
+	const ChokePoint *						back() const			{ bwem_assert(!empty()); return m_pChokePoints[m_to]; }
+
+	// Assumes i < size().
+	const ChokePoint *						operator[](size_t i) const	{ auto it = begin(); while (i--) ++it; bwem_assert(it != end()); return *it; }
+
+	std::vector<const ChokePoint *>			ToVector() const		{ return std::vector<const ChokePoint *>(begin(), end()); }
+
+////////////////////////////////////////////////////////////////////////////
+//	Details: The functions below are used by the BWEM's internals
+
+	// The Path from the ChokePoint of index from to the ChokePoint of index to.
+	// ChokePoints[i] is the ChokePoint of index i, and NextHops[a*count + b] is the next hop from a to b (a itself if a == b),
+	// or -1 if b cannot be reached from a.
+											Path(ChokePoint * const * ChokePoints, const index * NextHops, int count, index from, index to)
+												: m_pChokePoints(ChokePoints), m_pNextHops(NextHops), m_count(count),
+												  m_from(NextHops[from*count + to] == -1 ? -1 : from), m_to(NextHops[from*count + to] == -1 ? -1 : to) {}
+
+private:
+	ChokePoint * const *					m_pChokePoints = nullptr;
+	const index *							m_pNextHops = nullptr;
+	int										m_count = 0;
+	index									m_from = -1;		// -1 == empty
+	index									m_to = -1;
+};
+
+
 typedef ChokePoint::Path CPPath;
 
 
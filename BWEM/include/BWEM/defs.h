@@ -37,6 +37,20 @@ namespace detail
 #define BWEM_USE_MAP_PRINTER 1	// enable(1) or disable(0) the compilation of mapPrinter.cpp
 								// mapPrinter.h provides optional utils that require the EasyBMP Library (windows).
 
+#define BWEM_USE_DISTANCE_TRANSFORM 0	// enable(1) or disable(0) the linear-time computation of the altitudes (Cf. MapImpl::ComputeAltitude)
+										// When disabled, the former engine, based on the list of seaside MiniTiles, is used.
+										// Disabled by default: the results are not identical to the former engine's (Cf. MapImpl::ComputeAltitudesByDistanceTransform).
+
+#define BWEM_CHECK_DISTANCE_TRANSFORM 0	// enable(1) or disable(0) the comparison of both altitude engines (debugging purpose).
+										// When enabled, the former engine is used and any mismatch is reported.
+
+#define BWEM_INCREMENTAL_PATH_UPDATE 1	// enable(1) or disable(0) the incremental update of the paths between ChokePoints
+										// when a blocking Neutral is destroyed (Cf. Map::AutomaticPathUpdate).
+										// When disabled, the whole ChokePoint distance matrix is recomputed.
+
+#define BWEM_CHECK_INCREMENTAL_PATH_UPDATE 0	// enable(1) or disable(0) the comparison of the incremental update with the full recomputation (debugging purpose).
+												// When enabled, the full recomputation is used and any distance mismatch is reported.
+
 
 class Exception : public std::runtime_error
 {
@@ -79,6 +93,10 @@ const int min_tiles_between_Bases = 10;
 
 const int max_tiles_between_StartingLocation_and_its_AssignedBase = 3;
 
+// Version of the format of the map cache files (Cf. Map::EnableAnalysisCache).
+// Must be incremented each time either the format or the analysis changes, so that outdated files get ignored.
+const int map_cache_version = 6;
+
 } // namespace detail
 
 
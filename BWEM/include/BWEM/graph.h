@@ -16,6 +16,7 @@
 #include "cp.h"
 #include "area.h"
 #include "bwapiExt.h"
+#include "mapCache.h"
 #include "utils.h"
 #include "defs.h"
 
@@ -55,6 +56,43 @@ using namespace BWAPI_ext;
 //////////////////////////////////////////////////////////////////////////////////////////////
 //
 
+//////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                          //
+//                                  class NearestAreaGrid
+//                                                                                          //
+//////////////////////////////////////////////////////////////////////////////////////////////
+//
+// For each Tile (or MiniTile, depending on TPosition), stores the id of the nearest Area and the distance to it
+// (8-connectivity, i.e. queen-wise, in Tiles or MiniTiles).
+// The grid is filled by a multi-source breadth first search starting from all the Tiles (or MiniTiles) that belong to some Area.
+// Makes Graph::GetNearestArea a simple lookup.
+//
+
+template<class TPosition>
+class NearestAreaGrid
+{
+public:
+	bool								Computed() const				{ return !m_Ids.empty(); }
+
+	// Returns 0 if no Area is reachable from p.
+	Area::id							NearestAreaId(const TPosition & p) const	{ bwem_assert(Computed()); return m_Ids[p.y*m_width + p.x]; }
+
+	void								Compute(const MapImpl * pMap);
+
+	// To be called after the AreaId() of the Tiles (or MiniTiles) in Changed has changed.
+	// Only the part of the grid that is now closer to Changed than to any other Area is visited.
+	void								Update(const MapImpl * pMap, const vector<TPosition> & Changed);
+
+private:
+	void								Flood(const MapImpl * pMap, RingQueue<TPosition> & ToVisit);
+
+	int									m_width = 0;
+	vector<Area::id>					m_Ids;
+	vector<uint16_t>					m_Distances;
+};
+
+
+
 class Graph
 {
 public:
@@ -81,7 +119,7 @@ public:
 	template<class TPosition> Area *	GetNearestArea(TPosition p)		{ return const_cast<Area *>(static_cast<const Graph &>(*this).GetNearestArea(p)); }
 
 
-	// Returns the list of all the ChokePoints in the Map.
+	// Returns the list of all the ChokePoints in the Map, ordered by ChokePoint::Index().
 	const vector<ChokePoint *> &		ChokePoints() const				{ return m_ChokePointList; }
 
 	// Returns the ChokePoints between two Areas.
@@ -89,15 +127,19 @@ public:
 	const vector<ChokePoint> &			GetChokePoints(const Area * a, const Area * b) const	{ return GetChokePoints(a->Id(), b->Id()); }
 
 	// Returns the ground distance in pixels between cpA->Center() and cpB>Center()
-	int									Distance(const ChokePoint * cpA, const ChokePoint * cpB) const { return m_ChokePointDistanceMatrix[cpA->Index()][cpB->Index()]; }
+	int									Distance(const ChokePoint * cpA, const ChokePoint * cpB) const { return m_ChokePointDistanceMatrix[MatrixIndex(cpA, cpB)]; }
 
 	// Returns a list of ChokePoints, which is intended to be the shortest walking path from cpA to cpB.
-	const CPPath &						GetPath(const ChokePoint * cpA, const ChokePoint * cpB) const { return m_PathsBetweenChokePoints[cpA->Index()][cpB->Index()]; }
+	// The Path is produced lazily from the next hops matrix (Cf. ChokePoint::Path).
+	CPPath								GetPath(const ChokePoint * cpA, const ChokePoint * cpB) const { return CPPath(m_ChokePointList.data(), m_ChokePointNextHops.data(), (int)m_ChokePointList.size(), cpA->Index(), cpB->Index()); }
 
-	const CPPath &						GetPath(const BWAPI::Position & a, const BWAPI::Position & b, int * pLength = nullptr) const;
+	CPPath								GetPath(const BWAPI::Position & a, const BWAPI::Position & b, int * pLength = nullptr) const;
 
 	int									BaseCount() const	{ return m_baseCount; }
 
+	// Cf. Map::PathsVersion()
+	int									PathsVersion() const	{ return m_pathsVersion; }
+
 
 	vector<ChokePoint> &				GetChokePoints(Area::id a, Area::id b)			{ return const_cast<vector<ChokePoint> &>(static_cast<const Graph &>(*this).GetChokePoints(a, b)); }
 	vector<ChokePoint> &				GetChokePoints(const Area * a, const Area * b) 	{ return GetChokePoints(a->Id(), b->Id()); }
@@ -109,27 +151,46 @@ public:
 	void								CreateChokePoints();
 
 	void								ComputeChokePointDistanceMatrix();
+	void								UpdateChokePointDistanceMatrix(const vector<const ChokePoint *> & UnblockedCPs, const vector<const Area *> & ModifiedAreas);
 
 	void								CollectInformation();
 	void								CreateBases();
 
+	// Computes / updates the grids used by GetNearestArea (Cf. NearestAreaGrid).
+	void								ComputeNearestAreas();
+	void								UpdateNearestAreas(const vector<BWAPI::WalkPosition> & ChangedMiniTiles, const vector<BWAPI::TilePosition> & ChangedTiles);
+
+	// Saves / restores everything computed by the functions above (Cf. Map::EnableAnalysisCache).
+	// The Neutrals are referenced by their index in Neutrals.
+	void								SaveToCache(CacheWriter & writer, const vector<Neutral *> & Neutrals) const;
+	void								LoadFromCache(CacheReader & reader, const vector<Neutral *> & Neutrals);
+
 private:
 	template<class Context>
 	void								ComputeChokePointDistances(const Context * pContext);
 	vector<int>							ComputeDistances(const ChokePoint * pStartCP, const vector<const ChokePoint *> & TargetCPs) const;
+	void								RelaxChokePointDistances(const ChokePoint * u, const ChokePoint * v, int uv);
+	void								UpdateChokePointDistances(const ChokePoint * pStart, const vector<const ChokePoint *> & Targets, const vector<int> & DistanceToTargets, bool throughGraph);
 	void								SetDistance(const ChokePoint * cpA, const ChokePoint * cpB, int value);
+	void								SetChokePointsReferences();
 	void								UpdateGroupIds();
-	void								SetPath(const ChokePoint * cpA, const ChokePoint * cpB, const CPPath & PathAB);
+	void								OnPathsChanged();
+	void								SetNextHops(const ChokePoint * cpA, const ChokePoint * cpB, const ChokePoint * pAfterA, const ChokePoint * pBeforeB);
+	size_t								MatrixIndex(const ChokePoint * cpA, const ChokePoint * cpB) const	{ return cpA->Index()*m_ChokePointList.size() + cpB->Index(); }
 	bool								Valid(Area::id id) const			{ return (1 <= id) && (id <= AreasCount()); }
+	const NearestAreaGrid<BWAPI::WalkPosition> &	GetNearestAreaGrid(BWAPI::WalkPosition) const	{ return m_NearestMiniTileAreas; }
+	const NearestAreaGrid<BWAPI::TilePosition> &	GetNearestAreaGrid(BWAPI::TilePosition) const	{ return m_NearestTileAreas; }
 
 	MapImpl * const						m_pMap;
 	vector<Area>						m_Areas;
 	vector<ChokePoint *>				m_ChokePointList;
 	vector<vector<vector<ChokePoint>>>	m_ChokePointsMatrix;			// index == Area::id x Area::id
-	vector<vector<int>>					m_ChokePointDistanceMatrix;		// index == ChokePoint::index x ChokePoint::index
-	vector<vector<CPPath>>				m_PathsBetweenChokePoints;		// index == ChokePoint::index x ChokePoint::index
-	const CPPath						m_EmptyPath;
+	vector<int>							m_ChokePointDistanceMatrix;		// row-major, index == MatrixIndex(cpA, cpB)
+	vector<ChokePoint::index>			m_ChokePointNextHops;			// row-major, index == MatrixIndex(cpA, cpB): the ChokePoint following cpA on the path from cpA to cpB, or -1
 	int									m_baseCount;
+	int									m_pathsVersion = 0;
+	NearestAreaGrid<BWAPI::WalkPosition>m_NearestMiniTileAreas;
+	NearestAreaGrid<BWAPI::TilePosition>m_NearestTileAreas;
 };
 
 
@@ -139,6 +200,14 @@ const Area * Graph::GetNearestArea(TPosition p) const
 	typedef typename TileOfPosition<TPosition>::type Tile_t;
 	if (const Area * area = GetArea(p)) return area;
 
+	const NearestAreaGrid<TPosition> & Grid = GetNearestAreaGrid(p);
+	if (Grid.Computed())
+	{
+		Area::id id = Grid.NearestAreaId(p);
+		return id > 0 ? GetArea(id) : nullptr;
+	}
+
+	// The grids are not available yet (analysis in progress):
 	p = GetMap()->BreadthFirstSearch(p,
 					[this](const Tile_t & t, TPosition) { return t.AreaId() > 0; },	// findCond
 					[](const Tile_t &,       TPosition) { return true; });			// visitCond
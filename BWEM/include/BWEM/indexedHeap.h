@@ -0,0 +1,154 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This file is part of the BWEM Library.
+// BWEM is free software, licensed under the MIT/X11 License. 
+// A copy of the license is provided with the library in the LICENSE file.
+// Copyright (c) 2015, 2017, Igor Dimitrijevic
+//
+//////////////////////////////////////////////////////////////////////////
+
+
+#ifndef BWEM_INDEXED_HEAP_H
+#define BWEM_INDEXED_HEAP_H
+
+#include <vector>
+#include <algorithm>
+#include "defs.h"
+
+
+namespace BWEM {
+namespace utils {
+
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                          //
+//                                  class IndexedHeap
+//                                                                                          //
+//////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Min priority queue of elements identified by an index in [0, Capacity()), with a key of type Key.
+// Intended for Dijkstra's algorithm: unlike std::priority_queue or std::multimap, it supports DecreaseKey,
+// and allocates nothing once sized.
+//
+// The elements are stored in a D-ary heap held in a flat array, and m_Position maps each index to its slot in the heap.
+// Pop, Push and DecreaseKey are O(log(n)). Clear is O(Size()), so that a same instance can be reused by several searches.
+//
+// Usage: IndexedHeap<int> ToVisit(tileCount);  ToVisit.Push(startIndex, 0);  while (!ToVisit.Empty()) { int i = ToVisit.Pop(); ... }
+//
+
+template<class Key, int D = 4>
+class IndexedHeap
+{
+public:
+	static_assert(D >= 2, "IndexedHeap requires D >= 2");
+
+	explicit					IndexedHeap(int capacity = 0)		{ Reserve(capacity); }
+
+	// Makes the valid indexes be [0, capacity). Clears the heap if capacity changes.
+	void						Reserve(int capacity)				{ if (capacity != Capacity()) { m_Heap.clear(); m_Position.assign(capacity, not_in_heap); } }
+
+	int							Capacity() const					{ return (int)m_Position.size(); }
+	int							Size() const						{ return (int)m_Heap.size(); }
+	bool						Empty() const						{ return m_Heap.empty(); }
+
+	bool						Contains(int index) const			{ return m_Position[index] != not_in_heap; }
+
+	// Assumes Contains(index).
+	const Key &					KeyOf(int index) const				{ bwem_assert(Contains(index)); return m_Heap[m_Position[index]].key; }
+
+	// Index and key of the element with the smallest key. Assumes !Empty().
+	int							Top() const							{ bwem_assert(!Empty()); return m_Heap.front().index; }
+	const Key &					TopKey() const						{ bwem_assert(!Empty()); return m_Heap.front().key; }
+
+	// Assumes !Contains(index).
+	void						Push(int index, const Key & key)	{ bwem_assert(!Contains(index)); m_Position[index] = Size(); m_Heap.push_back(Entry{key, index}); SiftUp(Size()-1); }
+
+	// Assumes Contains(index) and key <= KeyOf(index).
+	void						DecreaseKey(int index, const Key & key)	{ bwem_assert(Contains(index) && !(KeyOf(index) < key)); m_Heap[m_Position[index]].key = key; SiftUp(m_Position[index]); }
+
+	// Pushes index, or decreases its key if it is already contained with a greater key.
+	// Returns whether the heap was modified.
+	bool						PushOrDecrease(int index, const Key & key)
+	{
+		if (!Contains(index))		{ Push(index, key); return true; }
+		if (key < KeyOf(index))		{ DecreaseKey(index, key); return true; }
+		return false;
+	}
+
+	// Removes the element with the smallest key and returns its index. Assumes !Empty().
+	int							Pop()
+	{
+		bwem_assert(!Empty());
+		const int top = m_Heap.front().index;
+		m_Position[top] = not_in_heap;
+		if (Size() > 1)
+		{
+			m_Heap.front() = m_Heap.back();
+			m_Position[m_Heap.front().index] = 0;
+			m_Heap.pop_back();
+			SiftDown(0);
+		}
+		else
+			m_Heap.pop_back();
+
+		return top;
+	}
+
+	void						Clear()								{ for (const Entry & e : m_Heap) m_Position[e.index] = not_in_heap; m_Heap.clear(); }
+
+private:
+	struct Entry
+	{
+		Key						key;
+		int						index;
+	};
+
+	enum {not_in_heap = -1};
+
+	void						Place(int slot, const Entry & e)	{ m_Heap[slot] = e; m_Position[e.index] = slot; }
+
+	void						SiftUp(int slot)
+	{
+		const Entry e = m_Heap[slot];
+		while (slot > 0)
+		{
+			const int parent = (slot - 1) / D;
+			if (!(e.key < m_Heap[parent].key)) break;
+			Place(slot, m_Heap[parent]);
+			slot = parent;
+		}
+		Place(slot, e);
+	}
+
+	void						SiftDown(int slot)
+	{
+		const Entry e = m_Heap[slot];
+		for (;;)
+		{
+			const int firstChild = slot*D + 1;
+			if (firstChild >= Size()) break;
+
+			int best = firstChild;
+			const int lastChild = std::min(firstChild + D, Size());
+			for (int child = firstChild + 1 ; child < lastChild ; ++child)
+				if (m_Heap[child].key < m_Heap[best].key) best = child;
+
+			if (!(m_Heap[best].key < e.key)) break;
+			Place(slot, m_Heap[best]);
+			slot = best;
+		}
+		Place(slot, e);
+	}
+
+	std::vector<Entry>			m_Heap;
+	std::vector<int>			m_Position;		// index -> slot in m_Heap, or not_in_heap
+};
+
+
+
+}} // namespace BWEM::utils
+
+
+#endif
+
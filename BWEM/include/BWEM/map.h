@@ -15,6 +15,8 @@
 #include <vector>
 #include <memory>
 #include <queue>
+#include <functional>
+#include <type_traits>
 #include "tiles.h"
 #include "area.h"
 #include "cp.h"
@@ -79,6 +81,32 @@ public:
 	// Even in this case, one should keep calling OnMineralDestroyed and OnStaticBuildingDestroyed.
 	virtual void						EnableAutomaticPathAnalysis() const = 0;
 
+	// Changes each time the results of GetPath and GetNearestArea may change, i.e. each time the paths between
+	// the ChokePoints are recomputed or the Areas are extended (Cf. AutomaticPathUpdate()).
+	// Allows to cache these results: they remain valid as long as PathsVersion() returns the same value.
+	// Distinct Maps, or the same Map initialized twice, never share a same value.
+	virtual int							PathsVersion() const = 0;
+
+	// Enables the cache of the analysis (off by default). This has to be called before Initialize().
+	// Each Map is identified by a fingerprint of its terrain, its starting Locations and its static neutral units.
+	// Initialize() first looks for the file of that fingerprint in readDirectory, then in writeDirectory.
+	// If found and valid, the file is memory-mapped and its content replaces the analysis (only the Neutrals are recreated).
+	// Otherwise, the analysis is performed as usual and its result is saved into writeDirectory.
+	// Outdated, truncated or corrupted files are simply ignored. Either directory may be empty.
+	// With BWAPI, a good choice is EnableAnalysisCache("bwapi-data/read/", "bwapi-data/write/").
+	virtual void						EnableAnalysisCache(const std::string & readDirectory, const std::string & writeDirectory) = 0;
+
+	// Enables the parallel analysis (off by default). This has to be called before Initialize().
+	// The data-parallel phases of the analysis are then spread among threadCount threads (the calling thread included).
+	// If threadCount == 0, std::thread::hardware_concurrency() threads are used.
+	// The result of the analysis is exactly the same as with the sequential analysis.
+	virtual void						EnableParallelAnalysis(int threadCount = 0) = 0;
+
+	// Sets a function that Initialize() calls right before each phase of the analysis, with its name
+	// ("LoadData", "ComputeAltitude", ...), and with nullptr once the analysis is complete (off by default).
+	// This allows to time the phases or to count their allocations, e.g. in a benchmark.
+	virtual void						SetPhaseObserver(std::function<void (const char * phase)> observer) = 0;
+
 	// Tries to assign one Base for each starting Location in StartingLocations().
 	// Only nearby Bases can be assigned (Cf. detail::max_tiles_between_StartingLocation_and_its_AssignedBase).
 	// Each such assigned Base then has Starting() == true, and its Location() is updated.
@@ -181,12 +209,12 @@ public:
 
 	// Returns the nearest Area from w.
 	// Returns nullptr only if Areas().empty()
-	// Note: Uses a breadth first search.
+	// Note: O(1), using a grid precomputed by a breadth first search from all the Areas (updated by OnMineralDestroyed & co).
 	virtual const Area *				GetNearestArea(BWAPI::WalkPosition w) const = 0;
 
 	// Returns the nearest Area from t.
 	// Returns nullptr only if Areas().empty()
-	// Note: Uses a breadth first search.
+	// Note: O(1), using a grid precomputed by a breadth first search from all the Areas (updated by OnMineralDestroyed & co).
 	virtual const Area *				GetNearestArea(BWAPI::TilePosition t) const = 0;
 
 
@@ -201,13 +229,18 @@ public:
 	//       While this brings robustness, this could yield surprising results in the case where 'a' and/or 'b' are in the Water.
 	//       To avoid this and the potential performance penalty, just make sure GetArea(a) != nullptr and GetArea(b) != nullptr.
 	//       Then GetPath should perform very quick.
-	virtual const CPPath &				GetPath(const BWAPI::Position & a, const BWAPI::Position & b, int * pLength = nullptr) const = 0;
+	virtual CPPath						GetPath(const BWAPI::Position & a, const BWAPI::Position & b, int * pLength = nullptr) const = 0;
 
 	// Generic algorithm for breadth first search in the Map.
 	// See the several use cases in BWEM source files.
 	template<class TPosition, class Pred1, class Pred2>
 	TPosition							BreadthFirstSearch(TPosition start, Pred1 findCond, Pred2 visitCond, bool connect8 = true) const;
 
+	// Same as above, with the connectivity (4 or 8) chosen at compile time.
+	// Each search runs in linear time, using buffers sized to the Map and reused by the subsequent searches of the calling thread.
+	template<int Connectivity, class TPosition, class Pred1, class Pred2>
+	TPosition							BreadthFirstSearch(TPosition start, Pred1 findCond, Pred2 visitCond) const;
+
 
 	// Returns the union of the geometry of all the ChokePoints. Cf. ChokePoint::Geometry()
 	virtual const std::vector<std::pair<std::pair<Area::id, Area::id>, BWAPI::WalkPosition>> & RawFrontier() const = 0;
@@ -249,43 +282,80 @@ inline const MiniTile & Map::GetTTile<BWAPI::WalkPosition>(const BWAPI::WalkPosi
 }
 
 
+namespace utils
+{
+
+// Per-thread buffers used by Map::BreadthFirstSearch
+template<class TPosition>
+struct SearchBuffers
+{
+	VisitedGrid					Visited;
+	RingQueue<TPosition>		ToVisit;
+	bool						inUse = false;		// guards against nested searches (from findCond or visitCond)
+};
+
+template<class TPosition>
+inline SearchBuffers<TPosition> & threadSearchBuffers()
+{
+	static thread_local SearchBuffers<TPosition> Buffers;
+	return Buffers;
+}
+
+} // namespace utils
+
+
 template<class TPosition, class Pred1, class Pred2>
 inline TPosition Map::BreadthFirstSearch(TPosition start, Pred1 findCond, Pred2 visitCond, bool connect8) const
 {
+	return connect8 ? BreadthFirstSearch<8>(start, findCond, visitCond)
+					: BreadthFirstSearch<4>(start, findCond, visitCond);
+}
+
+
+template<int Connectivity, class TPosition, class Pred1, class Pred2>
+inline TPosition Map::BreadthFirstSearch(TPosition start, Pred1 findCond, Pred2 visitCond) const
+{
+	static_assert((Connectivity == 4) || (Connectivity == 8), "BreadthFirstSearch: Connectivity must be 4 or 8");
 	typedef typename utils::TileOfPosition<TPosition>::type Tile_t;
 	if (findCond(GetTTile(start), start)) return start;
 
-	std::vector<TPosition> Visited;
-	std::queue<TPosition> ToVisit;
+	utils::SearchBuffers<TPosition> & ThreadBuffers = utils::threadSearchBuffers<TPosition>();
+	utils::SearchBuffers<TPosition> LocalBuffers;
+	utils::SearchBuffers<TPosition> & Buffers = ThreadBuffers.inUse ? LocalBuffers : ThreadBuffers;
+	struct Release { bool & inUse; ~Release() { inUse = false; } } release{Buffers.inUse};
+	Buffers.inUse = true;
+
+	const int width = std::is_same<TPosition, BWAPI::TilePosition>::value ? Size().x : WalkSize().x;
+	const int height = std::is_same<TPosition, BWAPI::TilePosition>::value ? Size().y : WalkSize().y;
+	utils::VisitedGrid & Visited = Buffers.Visited;
+	utils::RingQueue<TPosition> & ToVisit = Buffers.ToVisit;
+	Visited.Reset(width * height);
+	ToVisit.Clear();
 
-	ToVisit.push(start);
-	Visited.push_back(start);
+	ToVisit.Push(start);
+	Visited.SetVisited(start.y*width + start.x);
 
-	auto dir8 = {	TPosition(-1, -1), TPosition(0, -1), TPosition(+1, -1),
-					TPosition(-1,  0),                   TPosition(+1,  0),
-					TPosition(-1, +1), TPosition(0, +1), TPosition(+1, +1)};
+	static const TPosition dir8[] = {	TPosition(-1, -1), TPosition(0, -1), TPosition(+1, -1),
+										TPosition(-1,  0),                   TPosition(+1,  0),
+										TPosition(-1, +1), TPosition(0, +1), TPosition(+1, +1)};
 
-	auto dir4 = { TPosition(0, -1), TPosition(-1,  0), TPosition(+1,  0), TPosition(0, +1)};
+	static const TPosition dir4[] = { TPosition(0, -1), TPosition(-1,  0), TPosition(+1,  0), TPosition(0, +1)};
 
-	auto directions = connect8 ? dir8 : dir4;
+	const TPosition * directions = (Connectivity == 8) ? dir8 : dir4;
 
-	while (!ToVisit.empty())
+	while (!ToVisit.Empty())
 	{
-		TPosition current = ToVisit.front();
-		ToVisit.pop();
-		for (TPosition delta : directions)
+		TPosition current = ToVisit.Pop();
+		for (int d = 0 ; d < Connectivity ; ++d)
 		{
-			TPosition next = current + delta;
+			TPosition next = current + directions[d];
 			if (Valid(next))
 			{
 				const Tile_t & Next = GetTTile(next, utils::check_t::no_check); 
 				if (findCond(Next, next)) return next;
 
-				if (visitCond(Next, next) && !utils::contains(Visited, next))
-				{
-					ToVisit.push(next);
-					Visited.push_back(next);
-				}
+				if (visitCond(Next, next) && Visited.Visit(next.y*width + next.x))
+					ToVisit.Push(next);
 			}
 		}
 	}
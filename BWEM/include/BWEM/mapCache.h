@@ -0,0 +1,165 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This file is part of the BWEM Library.
+// BWEM is free software, licensed under the MIT/X11 License. 
+// A copy of the license is provided with the library in the LICENSE file.
+// Copyright (c) 2015, 2017, Igor Dimitrijevic
+//
+//////////////////////////////////////////////////////////////////////////
+
+
+#ifndef BWEM_MAP_CACHE_H
+#define BWEM_MAP_CACHE_H
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <type_traits>
+#include "utils.h"
+#include "defs.h"
+
+
+namespace BWEM {
+namespace utils {
+
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                          //
+//                                  class Fingerprint
+//                                                                                          //
+//////////////////////////////////////////////////////////////////////////////////////////////
+//
+// 64 bits FNV-1a like hash, processing the data by words of 8 bytes.
+// Used to identify a Map by its terrain and its Neutrals, and to checksum the content of a map cache file.
+//
+
+class Fingerprint
+{
+public:
+	void					Add(const void * data, size_t size);
+
+	template<class T>
+	void					Add(const T & value)			{ static_assert(std::is_trivially_copyable<T>::value, "Fingerprint::Add requires a trivially copyable type"); Add(&value, sizeof(T)); }
+
+	uint64_t				Value() const					{ return m_hash; }
+
+private:
+	uint64_t				m_hash = 14695981039346656037ULL;
+};
+
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                          //
+//                                  class MappedFile
+//                                                                                          //
+//////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Read-only memory mapping of a whole file.
+// If the file cannot be opened or mapped, Data() returns nullptr.
+//
+
+class MappedFile
+{
+public:
+							MappedFile(const std::string & fileName);
+							~MappedFile();
+
+							MappedFile(const MappedFile &) = delete;
+	MappedFile &			operator=(const MappedFile &) = delete;
+
+	const char *			Data() const					{ return m_pData; }
+	size_t					Size() const					{ return m_size; }
+
+private:
+	const char *			m_pData = nullptr;
+	size_t					m_size = 0;
+	void *					m_hFile = nullptr;				// only used under Windows
+	void *					m_hMapping = nullptr;			// only used under Windows
+};
+
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                          //
+//                                  class CacheWriter
+//                                                                                          //
+//////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Serializes trivially copyable values into a memory buffer (native endianness and layout).
+// The content of a map cache is only intended to be read back by the same build of the library:
+// see detail::map_cache_version.
+//
+
+class CacheWriter
+{
+public:
+	template<class T>
+	void					Write(const T & value)						{ WriteArray(&value, 1); }
+
+	template<class T>
+	void					WriteArray(const T * p, size_t n)			{ static_assert(std::is_trivially_copyable<T>::value, "CacheWriter requires a trivially copyable type");
+																		  const char * bytes = reinterpret_cast<const char *>(p); m_Buffer.insert(m_Buffer.end(), bytes, bytes + n*sizeof(T)); }
+
+	template<class T>
+	void					WriteVector(const std::vector<T> & v)		{ Write(uint32_t(v.size())); WriteArray(v.data(), v.size()); }
+
+	const std::vector<char> &	Buffer() const							{ return m_Buffer; }
+
+private:
+	std::vector<char>		m_Buffer;
+};
+
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                          //
+//                                  class CacheReader
+//                                                                                          //
+//////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Reads back what a CacheWriter wrote, directly from a memory area (typically a MappedFile).
+// Any attempt to read beyond the end of the memory area throws a BWEM::Exception.
+//
+
+class CacheReader
+{
+public:
+							CacheReader(const char * data, size_t size) : m_pCurrent(data), m_pEnd(data + size) {}
+
+	template<class T>
+	T						Read()										{ T value; ReadArray(&value, 1); return value; }
+
+	template<class T>
+	void					ReadArray(T * p, size_t n)					{ static_assert(std::is_trivially_copyable<T>::value, "CacheReader requires a trivially copyable type");
+																		  if (n) std::memcpy(p, Skip(n*sizeof(T)), n*sizeof(T)); }
+
+	template<class T>
+	void					ReadVector(std::vector<T> & v)				{ v.resize(Read<uint32_t>()); ReadArray(v.data(), v.size()); }
+
+	// Returns the current position and advances it by size bytes.
+	const char *			Skip(size_t size);
+
+	size_t					Remaining() const							{ return m_pEnd - m_pCurrent; }
+
+private:
+	const char *			m_pCurrent;
+	const char * const		m_pEnd;
+};
+
+
+
+// Used to validate the content of a map cache: unlike bwem_assert_throw, does not assert, as a bad file is not a bug.
+inline void checkCacheData(bool condition)
+{
+	if (!condition) throw Exception("map cache: inconsistent data");
+}
+
+
+
+}} // namespace BWEM::utils
+
+
+#endif
+
@@ -15,6 +15,8 @@
 #include "graph.h"
 #include "map.h"
 #include "tiles.h"
+#include "mapCache.h"
+#include "threadPool.h"
 #include <queue>
 #include <memory>
 #include "utils.h"
@@ -60,9 +62,22 @@ public:
 
 	void						Initialize() override;
 
+	void						EnableAnalysisCache(const string & readDirectory, const string & writeDirectory) override
+																						{ m_cacheReadDirectory = readDirectory; m_cacheWriteDirectory = writeDirectory; }
+
+	void						EnableParallelAnalysis(int threadCount) override;
+
+	void						SetPhaseObserver(function<void (const char * phase)> observer) override
+																						{ m_phaseObserver = move(observer); }
+
+	// Returns nullptr unless EnableParallelAnalysis was called.
+	ThreadPool *				GetThreadPool() const									{ return m_pThreadPool.get(); }
+
 	bool						AutomaticPathUpdate() const override					{ return m_automaticPathUpdate; }
 	void						EnableAutomaticPathAnalysis() const override			{ m_automaticPathUpdate = true; }
 
+	int							PathsVersion() const override							{ return GetGraph().PathsVersion(); }
+
 	bool						FindBasesForStartingLocations() override;
 
 	altitude_t					MaxAltitude() const override							{ return m_maxAltitude; }
@@ -101,7 +116,7 @@ public:
 	Area *						GetNearestArea(BWAPI::TilePosition t)					{ return m_Graph.GetNearestArea(t); }
 
 
-	const CPPath &				GetPath(const BWAPI::Position & a, const BWAPI::Position & b, int * pLength = nullptr) const override { return m_Graph.GetPath(a, b, pLength); }
+	CPPath						GetPath(const BWAPI::Position & a, const BWAPI::Position & b, int * pLength = nullptr) const override { return m_Graph.GetPath(a, b, pLength); }
 
 	const class Graph &			GetGraph() const										{ return m_Graph; }
 	class Graph &				GetGraph()												{ return m_Graph; }
@@ -115,12 +130,16 @@ public:
 	void						OnBlockingNeutralDestroyed(const Neutral * pBlocking);
 
 private:
+	bool						Initialize(bool readCache);
+	void						Phase(const char * name) const							{ if (m_phaseObserver) m_phaseObserver(name); }
 	void						ReplaceAreaIds(BWAPI::WalkPosition p, Area::id newAreaId);
 
 	void						InitializeNeutrals();
 	void						LoadData();
 	void						DecideSeasOrLakes();
 	void						ComputeAltitude();
+	void						ComputeAltitudeFromSeaSides();
+	vector<altitude_t>			ComputeAltitudesByDistanceTransform() const;
 	void						ProcessBlockingNeutrals();
 	void						ComputeAreas();
 	vector<pair<BWAPI::WalkPosition, MiniTile *>>
@@ -130,6 +149,11 @@ private:
 	void						SetAreaIdInTiles();
 	void						SetAreaIdInTile(BWAPI::TilePosition t);
 	void						SetAltitudeInTile(BWAPI::TilePosition t);
+	void						UpdatePaths(const Neutral * pBlocking, const vector<const ChokePoint *> & UnblockedCPs);
+	uint64_t					ComputeFingerprint() const;
+	vector<Neutral *>			NeutralsInCacheOrder() const;
+	void						LoadFromCache(CacheReader & reader);
+	void						SaveToCache(uint64_t fingerprint) const;
 
 
 	altitude_t							m_maxAltitude;
@@ -143,6 +167,11 @@ private:
 	vector<BWAPI::TilePosition>			m_StartingLocations;
 
 	vector<pair<pair<Area::id, Area::id>, BWAPI::WalkPosition>>	m_RawFrontier;
+
+	string								m_cacheReadDirectory;
+	string								m_cacheWriteDirectory;
+	unique_ptr<ThreadPool>				m_pThreadPool;
+	function<void (const char *)>		m_phaseObserver;
 };
 
 
@@ -105,6 +105,7 @@ public:
 //	Details: The functions below are used by the BWEM's internals
 
 	void							SetBlocking(const std::vector<BWAPI::WalkPosition> & blockedAreas);
+	const std::vector<BWAPI::WalkPosition> &	BlockedAreasPositions() const	{ return m_blockedAreas; }
 
 protected:
 									Neutral(BWAPI::Unit u, Map * pMap);
@@ -0,0 +1,93 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This file is part of the BWEM Library.
+// BWEM is free software, licensed under the MIT/X11 License. 
+// A copy of the license is provided with the library in the LICENSE file.
+// Copyright (c) 2015, 2017, Igor Dimitrijevic
+//
+//////////////////////////////////////////////////////////////////////////
+
+
+#ifndef BWEM_THREAD_POOL_H
+#define BWEM_THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "defs.h"
+
+
+namespace BWEM {
+namespace utils {
+
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                          //
+//                                  class ThreadPool
+//                                                                                          //
+//////////////////////////////////////////////////////////////////////////////////////////////
+//
+// A minimal pool of worker threads, only providing a parallel for loop.
+// The thread calling ParallelFor takes part in the job, so a pool of n threads starts n-1 workers.
+// Used by the analysis of the Map, when enabled (Cf. Map::EnableParallelAnalysis).
+//
+
+class ThreadPool
+{
+public:
+	explicit				ThreadPool(int threadCount);
+							~ThreadPool();
+
+							ThreadPool(const ThreadPool &) = delete;
+	ThreadPool &			operator=(const ThreadPool &) = delete;
+
+	// Number of threads taking part in ParallelFor, including the calling one.
+	int						ThreadCount() const				{ return (int)m_Workers.size() + 1; }
+
+	// Calls f(i) for each i in [begin, end), spreading the calls among the threads, and returns once they are all done.
+	// The calls for distinct values of i must be independent of each other.
+	// If some call throws, the first exception caught is rethrown.
+	// Not reentrant: f must not call ParallelFor.
+	void					ParallelFor(int begin, int end, const std::function<void(int)> & f);
+
+private:
+	void					WorkerLoop();
+	void					RunCalls();
+
+	std::vector<std::thread>				m_Workers;
+	std::mutex								m_mutex;
+	std::condition_variable					m_jobAvailable;
+	std::condition_variable					m_jobDone;
+	const std::function<void(int)> *		m_pJob = nullptr;
+	std::atomic<int>						m_next;
+	int										m_end = 0;
+	int										m_generation = 0;
+	int										m_busyWorkers = 0;
+	bool									m_stopping = false;
+	std::exception_ptr						m_exception;
+};
+
+
+// Same as pPool->ParallelFor(begin, end, f), or a simple loop if pPool == nullptr.
+template<class F>
+void parallelFor(ThreadPool * pPool, int begin, int end, F f)
+{
+	if (pPool && (pPool->ThreadCount() > 1) && (end - begin > 1))
+		pPool->ParallelFor(begin, end, f);
+	else
+		for (int i = begin ; i < end ; ++i)
+			f(i);
+}
+
+
+
+}} // namespace BWEM::utils
+
+
+#endif
+
@@ -28,6 +28,7 @@ namespace BWEM {
 
 namespace utils {
 
+class ThreadPool;
 
 
 //extern std::ofstream Log;
@@ -67,6 +68,14 @@ inline int scalar_product(int ax, int ay, int bx, int by)
 bool intersect(int ax, int ay, int bx, int by, int cx, int cy, int dx, int dy);
 
 
+// Exact squared euclidean distance transform of a width x height grid stored row by row (Meijster et al. algorithm, linear time).
+// On entry, the cells equal to 0 are the sources and the other ones must be > 0.
+// On return, each cell holds the squared distance to the nearest source.
+// Assumes each column contains at least one source.
+// If pPool != nullptr, the work is spread among its threads.
+void squaredDistanceTransform(std::vector<int> & Grid, int width, int height, ThreadPool * pPool = nullptr);
+
+
 template<class T>
 std::string my_to_string(const T & value)
 {
@@ -225,6 +234,129 @@ Mark Markable<Derived, Mark>::m_currentMark = 0;
 
 
 
+//////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                          //
+//                                  class VisitedGrid
+//                                                                                          //
+//////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Visited marks over the cells of a grid, reusable from one search to another.
+//  Each search gets a new stamp, so that Reset is O(1) most of the time.
+//
+//  Usage: Visited.Reset(cellCount);  if (Visited.Visit(i)) { ...first visit of i... }
+//
+//  Note: unlike Markable, this holds no static data, so that distinct instances can be used concurrently.
+//
+
+class VisitedGrid
+{
+public:
+	void					Reset(int size)				{ if (size != (int)m_Stamps.size()) { m_Stamps.assign(size, 0); m_stamp = 0; }
+														  if (++m_stamp == 0) { std::fill(m_Stamps.begin(), m_Stamps.end(), 0); m_stamp = 1; } }
+
+	bool					Visited(int i) const		{ return m_Stamps[i] == m_stamp; }
+	void					SetVisited(int i)			{ m_Stamps[i] = m_stamp; }
+
+	// Marks i as visited. Returns false if it already was.
+	bool					Visit(int i)				{ if (Visited(i)) return false; SetVisited(i); return true; }
+
+private:
+	std::vector<uint16_t>	m_Stamps;
+	uint16_t				m_stamp = 0;
+};
+
+
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                          //
+//                                  class RingQueue
+//                                                                                          //
+//////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  FIFO queue stored in a circular buffer that only grows (by doubling its capacity).
+//  Unlike std::queue, it allocates nothing once large enough, so that a same instance can be reused by several searches.
+//
+
+template<class T>
+class RingQueue
+{
+public:
+	bool					Empty() const				{ return m_size == 0; }
+	int						Size() const				{ return m_size; }
+	void					Clear()						{ m_head = 0; m_size = 0; }
+
+	void					Push(const T & e)			{ if (m_size == (int)m_Buffer.size()) Grow(); m_Buffer[(m_head + m_size) & Mask()] = e; ++m_size; }
+	T						Pop()						{ bwem_assert(!Empty()); T e = m_Buffer[m_head]; m_head = (m_head + 1) & Mask(); --m_size; return e; }
+
+private:
+	int						Mask() const				{ return (int)m_Buffer.size() - 1; }
+	void					Grow()						{ std::vector<T> Buffer(std::max<size_t>(64, 2*m_Buffer.size()));
+														  for (int i = 0 ; i < m_size ; ++i) Buffer[i] = m_Buffer[(m_head + i) & Mask()];
+														  m_Buffer.swap(Buffer); m_head = 0; }
+
+	std::vector<T>			m_Buffer;				// size is always 0 or a power of 2
+	int						m_head = 0;
+	int						m_size = 0;
+};
+
+
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                          //
+//                                  class SummedAreaTable
+//                                                                                          //
+//////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  2D prefix sums (integral image) of an integer grid covering the rectangle [x0, x0+width) x [y0, y0+height).
+//  Once built in O(width*height), the sum over any rectangle inside it is O(1).
+//
+//  Usage: Table.Build(x0, y0, width, height, [](int x, int y) { return value(x, y); });  Table.Sum(x, y, w, h);
+//
+
+class SummedAreaTable
+{
+public:
+	// value(x, y) gives the value of the cell (x, y), for each cell of the rectangle.
+	template<class F>
+	void					Build(int x0, int y0, int width, int height, F value)
+	{
+		bwem_assert((width >= 0) && (height >= 0));
+		m_x0 = x0; m_y0 = y0; m_width = width; m_height = height;
+		m_Sums.assign((width+1)*(height+1), 0);
+		for (int y = 0 ; y < height ; ++y)
+		{
+			int rowSum = 0;
+			for (int x = 0 ; x < width ; ++x)
+			{
+				rowSum += value(x0 + x, y0 + y);
+				m_Sums[(y+1)*(width+1) + x+1] = m_Sums[y*(width+1) + x+1] + rowSum;
+			}
+		}
+	}
+
+	// Returns the sum of the cells of the rectangle [x, x+w) x [y, y+h), which must be inside the table.
+	int						Sum(int x, int y, int w, int h) const
+	{
+		x -= m_x0; y -= m_y0;
+		bwem_assert((0 <= x) && (0 <= w) && (x + w <= m_width) && (0 <= y) && (0 <= h) && (y + h <= m_height));
+		return At(x + w, y + h) - At(x, y + h) - At(x + w, y) + At(x, y);
+	}
+
+private:
+	int						At(int x, int y) const		{ return m_Sums[y*(m_width+1) + x]; }
+
+	std::vector<int>		m_Sums;						// (m_width+1) x (m_height+1), with a first row and a first column of 0
+	int						m_x0 = 0;
+	int						m_y0 = 0;
+	int						m_width = 0;
+	int						m_height = 0;
+};
+
+
+
+
 //////////////////////////////////////////////////////////////////////////////////////////////
 //                                                                                          //
 //                                  class UserData
@@ -12,6 +12,7 @@
 #include "mapImpl.h"
 #include "graph.h"
 #include "neutral.h"
+#include "indexedHeap.h"
 #include "winutils.h"
 #include <map>
 
@@ -135,6 +136,34 @@ vector<int> Area::ComputeDistances(const ChokePoint * pStartCP, const vector<con
 }
 
 
+namespace
+{
+
+// Per-thread state of Area::ComputeDistances(TilePosition start, ...)
+// Unlike Tile::InternalData and Tile::Markable, this allows several Areas to be processed concurrently (see Map::EnableParallelAnalysis).
+// The stamps avoid clearing the buffers between two searches.
+class TileSearchState
+{
+public:
+	void				Reset(int size)					{ ToVisit.Clear(); ToVisit.Reserve(size);
+														  if ((int)m_Closed.size() != size) { m_Closed.assign(size, 0); m_epoch = 0; }
+														  if (++m_epoch == 0) { fill(m_Closed.begin(), m_Closed.end(), 0); m_epoch = 1; } }
+
+	bool				Closed(int i) const				{ return m_Closed[i] == m_epoch; }
+	void				SetClosed(int i)				{ m_Closed[i] = m_epoch; }
+
+	IndexedHeap<int>	ToVisit;						// the tiles to visit (indexed by tile index) ordered by their distance to start.
+
+private:
+	vector<unsigned>	m_Closed;
+	unsigned			m_epoch = 0;
+};
+
+thread_local TileSearchState tileSearchState;
+
+}
+
+
 // Returns Distances such that Distances[i] == ground_distance(start, Targets[i]) in pixels
 // Note: same algorithm than Graph::ComputeDistances (derived from Dijkstra)
 vector<int> Area::ComputeDistances(TilePosition start, const vector<TilePosition> & Targets) const
@@ -142,21 +171,19 @@ vector<int> Area::ComputeDistances(TilePosition start, const vector<TilePosition
 	const Map * pMap = GetMap();
 	vector<int> Distances(Targets.size());
 
-	Tile::UnmarkAll();
+	TileSearchState & State = tileSearchState;
+	State.Reset(pMap->Size().x * pMap->Size().y);
+	auto index = [pMap](const TilePosition & t) { return t.y * pMap->Size().x + t.x; };
 
-	multimap<int, TilePosition> ToVisit;	// a priority queue holding the tiles to visit ordered by their distance to start.
-	ToVisit.emplace(0, start);
+	IndexedHeap<int> & ToVisit = State.ToVisit;
+	ToVisit.Push(index(start), 0);
 
 	int remainingTargets = Targets.size();
-	while (!ToVisit.empty())
+	while (!ToVisit.Empty())
 	{
-		int currentDist = ToVisit.begin()->first;
-		TilePosition current = ToVisit.begin()->second;
-		const Tile & currentTile = pMap->GetTile(current, check_t::no_check);
-		bwem_assert(currentTile.InternalData() == currentDist);
-		ToVisit.erase(ToVisit.begin());
-		currentTile.SetInternalData(0);										// resets Tile::m_internalData for future usage
-		currentTile.SetMarked();
+		int currentDist = ToVisit.TopKey();
+		TilePosition current(ToVisit.Top() % pMap->Size().x, ToVisit.Top() / pMap->Size().x);
+		State.SetClosed(ToVisit.Pop());
 
 		for (int i = 0 ; i < (int)Targets.size() ; ++i)
 			if (current == Targets[i])
@@ -176,29 +203,19 @@ vector<int> Area::ComputeDistances(TilePosition start, const vector<TilePosition
 			TilePosition next = current + delta;
 			if (pMap->Valid(next))
 			{
-				const Tile & nextTile = pMap->GetTile(next, check_t::no_check); 
-				if (!nextTile.Marked())
+				const int iNext = index(next);
+				if (!State.Closed(iNext))
 				{
-					if (nextTile.InternalData())	// next already in ToVisit
+					if (ToVisit.Contains(iNext))	// next already in ToVisit
 					{
-						if (newNextDist < nextTile.InternalData())		// nextNewDist < nextOldDist
-						{	// To update next's distance, we need to remove-insert it from ToVisit:
-							auto range = ToVisit.equal_range(nextTile.InternalData());
-							auto iNext = find_if(range.first, range.second, [next]
-								(const pair<int, TilePosition> & e) { return e.second == next; });
-							bwem_assert(iNext != range.second);
-
-							ToVisit.erase(iNext);
-							nextTile.SetInternalData(newNextDist);
-						//	nextTile.SetPtr(const_cast<Tile *>(&currentTile));		// note: we won't use this backward trace
-							ToVisit.emplace(newNextDist, next);
-						}
+						if (newNextDist < ToVisit.KeyOf(iNext))		// nextNewDist < nextOldDist
+							ToVisit.DecreaseKey(iNext, newNextDist);
 					}
-					else if ((nextTile.AreaId() == Id()) || (nextTile.AreaId() == -1))
+					else
 					{
-						nextTile.SetInternalData(newNextDist);
-					//	nextTile.SetPtr(const_cast<Tile *>(&currentTile));			// note: we won't use this backward trace
-						ToVisit.emplace(newNextDist, next);
+						const Tile & nextTile = pMap->GetTile(next, check_t::no_check);
+						if ((nextTile.AreaId() == Id()) || (nextTile.AreaId() == -1))
+							ToVisit.Push(iNext, newNextDist);
 					}
 				}
 			}
@@ -206,10 +223,6 @@ vector<int> Area::ComputeDistances(TilePosition start, const vector<TilePosition
 	}
 
 	bwem_assert(!remainingTargets);
-
-	// Reset Tile::m_internalData for future usage
-	for (auto e : ToVisit)
-		pMap->GetTile(e.second, check_t::no_check).SetInternalData(0);	
 	
 	return Distances;
 }
@@ -249,39 +262,45 @@ void Area::PostCollectInformation()
 
 // Calculates the score >= 0 corresponding to the placement of a Base Command Center at 'location'.
 // The more there are ressources nearby, the higher the score is.
-// The function assumes the distance to the nearby ressources has already been computed (in InternalData()) for each tile around.
-// The job is therefore made easier : just need to sum the InternalData() values.
+// The function assumes the distance to the nearby ressources has already been computed for each tile around (Cf. CreateBases).
+// The job is therefore made easier : just need to sum these values, which the summed area tables do in O(1):
+//  - Potentials holds the potential fields (>= 0).
+//  - Reserved counts the Tiles with the special value -1, meaning there is some ressource at maximum 3 tiles, which Starcraft rules forbid.
+//    Unfortunately, this is guaranteed only for the ressources in this Area, which is the very reason of ValidateBaseLocation
+//  - Unbuildable counts the Tiles where no Command Center can be placed: not buildable, not in this Area, or occupied by a static building.
 // Returns -1 if the location is impossible.
-
-int Area::ComputeBaseLocationScore(TilePosition location) const
+int Area::ComputeBaseLocationScore(TilePosition location, const SummedAreaTable & Potentials, const SummedAreaTable & Reserved, const SummedAreaTable & Unbuildable) const
 {
-	const Map * pMap = GetMap();
 	const TilePosition dimCC = UnitType(Terran_Command_Center).tileSize();
 
-	int sumScore = 0;
-	for (int dy = 0 ; dy < dimCC.y ; ++dy)
-	for (int dx = 0 ; dx < dimCC.x ; ++dx)
-	{
-		const Tile & tile = pMap->GetTile(location + TilePosition(dx, dy), check_t::no_check);
-		if (!tile.Buildable()) return -1;
-		if (tile.InternalData() == -1) return -1;		// The special value InternalData() == -1 means there is some ressource at maximum 3 tiles, which Starcraft rules forbid.
-												// Unfortunately, this is guaranteed only for the ressources in this Area, which is the very reason of ValidateBaseLocation
-		if (tile.AreaId() != Id()) return -1;
-		if (tile.GetNeutral() && tile.GetNeutral()->IsStaticBuilding()) return -1;
-
-		sumScore += tile.InternalData();
-	}
+	if (Unbuildable.Sum(location.x, location.y, dimCC.x, dimCC.y)) return -1;
+	if (Reserved.Sum(location.x, location.y, dimCC.x, dimCC.y)) return -1;
 
-	return sumScore;
+	return Potentials.Sum(location.x, location.y, dimCC.x, dimCC.y);
 }
 
 
 // Checks if 'location' is a valid location for the placement of a Base Command Center.
-// If the location is valid except for the presence of Mineral patches of less than 9 (see Andromeda.scx),
-// the function returns true, and these Minerals are reported in BlockingMinerals
+// Obstructing counts the Tiles occupied by a Geyser or by a Mineral of more than 8 (Mineral patches of less than 9 do not invalidate the location,
+// see Andromeda.scx and CollectBlockingMinerals).
 // The function is intended to be called after ComputeBaseLocationScore, as it is more expensive.
 // See also the comments inside ComputeBaseLocationScore.
-bool Area::ValidateBaseLocation(TilePosition location, vector<Mineral *> & BlockingMinerals) const
+bool Area::ValidateBaseLocation(TilePosition location, const SummedAreaTable & Obstructing) const
+{
+	const TilePosition dimCC = UnitType(Terran_Command_Center).tileSize();
+
+	if (Obstructing.Sum(location.x - 3, location.y - 3, dimCC.x + 6, dimCC.y + 6)) return false;
+
+	// checks the distance to the Bases already created:
+	for (const Base & base : Bases())
+		if (roundedDist(base.Location(), location) < min_tiles_between_Bases) return false;
+
+	return true;
+}
+
+
+// Reports in BlockingMinerals the Mineral patches of less than 9 around a location accepted by ValidateBaseLocation.
+void Area::CollectBlockingMinerals(TilePosition location, vector<Mineral *> & BlockingMinerals) const
 {
 	const Map * pMap = GetMap();
 	const TilePosition dimCC = UnitType(Terran_Command_Center).tileSize();
@@ -293,23 +312,13 @@ bool Area::ValidateBaseLocation(TilePosition location, vector<Mineral *> & Block
 	{
 		TilePosition t = location + TilePosition(dx, dy);
 		if (pMap->Valid(t))
-		{
-			const Tile & tile = pMap->GetTile(t, check_t::no_check);
-			if (Neutral * n = tile.GetNeutral())
-			{
-				if (n->IsGeyser()) return false;
+			if (Neutral * n = pMap->GetTile(t, check_t::no_check).GetNeutral())
 				if (Mineral * m = n->IsMineral())
-					if (m->InitialAmount() <= 8) BlockingMinerals.push_back(m);
-					else return false;
-			}
-		}
+				{
+					bwem_assert(m->InitialAmount() <= 8);
+					BlockingMinerals.push_back(m);
+				}
 	}
-
-	// checks the distance to the Bases already created:
-	for (const Base & base : Bases())
-		if (roundedDist(base.Location(), location) < min_tiles_between_Bases) return false;
-
-	return true;
 }
 
 
@@ -317,7 +326,8 @@ bool Area::ValidateBaseLocation(TilePosition location, vector<Mineral *> & Block
 // The algorithm repeatedly searches the best possible location L (near ressources)
 // When it finds one, the nearby ressources are assigned to L, which makes the remaining ressources decrease.
 // This causes the algorithm to always terminate due to the lack of remaining ressources.
-// To efficiently compute the distances to the ressources, with use Potiential Fields in the InternalData() value of the Tiles.
+// To efficiently compute the distances to the ressources, with use Potiential Fields.
+// Each candidate location is then evaluated in O(1), using summed area tables (Cf. ComputeBaseLocationScore and ValidateBaseLocation).
 void Area::CreateBases()
 {
 	const TilePosition dimCC = UnitType(Terran_Command_Center).tileSize();
@@ -329,8 +339,42 @@ void Area::CreateBases()
 	for (Mineral * m : Minerals())	if ((m->InitialAmount() >= 40) && !m->Blocking()) RemainingRessources.push_back(m);
 	for (Geyser * g : Geysers())	if ((g->InitialAmount() >= 300) && !g->Blocking()) RemainingRessources.push_back(g);
 
+	if (RemainingRessources.empty()) return;
+
 	m_Bases.reserve(min(100, (int)RemainingRessources.size()));
 
+	// The Potential Fields are stored locally rather than in Tile::InternalData, so that several Areas can be processed concurrently
+	// (see Map::EnableParallelAnalysis). They only need to cover the bounding box of this Area, as any candidate location lies inside it.
+	// Tiles outside this Area always get a score of -1 anyway (see ComputeBaseLocationScore).
+	const TilePosition boxSize = BoundingBoxSize();
+	vector<int> PotentialFields(boxSize.x * boxSize.y);
+	auto insideBoundingBox = [this](const TilePosition & t) { return (TopLeft().x <= t.x) && (t.x <= BottomRight().x) && (TopLeft().y <= t.y) && (t.y <= BottomRight().y); };
+	auto potentialField = [this, &PotentialFields, boxSize](const TilePosition & t) -> int & { return PotentialFields[(t.y - TopLeft().y)*boxSize.x + t.x - TopLeft().x]; };
+
+	// The summed area tables cover the bounding box plus a margin of 3 Tiles, which is the extent of ValidateBaseLocation around the Command Center.
+	const TilePosition tablesTopLeft = TopLeft() - 3;
+	const TilePosition tablesSize = boxSize + 6;
+
+	// Unbuildable and Obstructing only depend on the Tiles and on the Neutrals, so they are computed once:
+	SummedAreaTable Unbuildable, Obstructing;
+	Unbuildable.Build(tablesTopLeft.x, tablesTopLeft.y, tablesSize.x, tablesSize.y, [this, pMap](int x, int y)
+	{
+		if (!pMap->Valid(TilePosition(x, y))) return 1;
+		const Tile & tile = pMap->GetTile(TilePosition(x, y), check_t::no_check);
+		return (!tile.Buildable() || (tile.AreaId() != Id()) || (tile.GetNeutral() && tile.GetNeutral()->IsStaticBuilding())) ? 1 : 0;
+	});
+	Obstructing.Build(tablesTopLeft.x, tablesTopLeft.y, tablesSize.x, tablesSize.y, [pMap](int x, int y)
+	{
+		if (!pMap->Valid(TilePosition(x, y))) return 0;
+		const Neutral * n = pMap->GetTile(TilePosition(x, y), check_t::no_check).GetNeutral();
+		if (!n) return 0;
+		if (const Mineral * m = n->IsMineral()) return (m->InitialAmount() <= 8) ? 0 : 1;
+		return n->IsGeyser() ? 1 : 0;
+	});
+
+	SummedAreaTable Potentials, Reserved;
+	auto potentialFieldOrZero = [&insideBoundingBox, &potentialField](int x, int y) { return insideBoundingBox(TilePosition(x, y)) ? potentialField(TilePosition(x, y)) : 0; };
+
 	while (!RemainingRessources.empty())
 	{
 		// 1) Calculate the SearchBoundingBox (needless to search too far from the RemainingRessources):
@@ -349,18 +393,19 @@ void Area::CreateBases()
 		makePointFitToBoundingBox(bottomRightSearchBoundingBox, TopLeft(), BottomRight() - dimCC + 1);
 
 		// 2) Mark the Tiles with their distances from each remaining Ressource (Potential Fields >= 0)
+		fill(PotentialFields.begin(), PotentialFields.end(), 0);
 		for (const Ressource * r : RemainingRessources)
 			for (int dy = -dimCC.y-max_tiles_between_CommandCenter_and_ressources ; dy < r->Size().y + dimCC.y+max_tiles_between_CommandCenter_and_ressources ; ++dy)
 			for (int dx = -dimCC.x-max_tiles_between_CommandCenter_and_ressources ; dx < r->Size().x + dimCC.x+max_tiles_between_CommandCenter_and_ressources ; ++dx)
 			{
 				TilePosition t = r->TopLeft() + TilePosition(dx, dy);
-				if (pMap->Valid(t))
+				if (insideBoundingBox(t))
 				{
 					const Tile & tile = pMap->GetTile(t, check_t::no_check);
 					int dist = (distToRectangle(center(t), r->TopLeft(), r->Size())+16)/32;
 					int score = max(max_tiles_between_CommandCenter_and_ressources + 3 - dist, 0);
 					if (r->IsGeyser()) score *= 3;		// somewhat compensates for Geyser alone vs the several Minerals
-					if (tile.AreaId() == Id()) tile.SetInternalData(tile.InternalData() + score);	// note the additive effect (assume tile.InternalData() is 0 at the begining)
+					if (tile.AreaId() == Id()) potentialField(t) += score;	// note the additive effect
 				}
 			}
 
@@ -370,37 +415,30 @@ void Area::CreateBases()
 			for (int dx = -3 ; dx < r->Size().x + 3 ; ++dx)
 			{
 				TilePosition t = r->TopLeft() + TilePosition(dx, dy);
-				if (pMap->Valid(t))
-					pMap->GetTile(t, check_t::no_check).SetInternalData(-1);
+				if (insideBoundingBox(t))
+					potentialField(t) = -1;
 			}
 
+		Potentials.Build(tablesTopLeft.x, tablesTopLeft.y, tablesSize.x, tablesSize.y, [&potentialFieldOrZero](int x, int y) { return max(potentialFieldOrZero(x, y), 0); });
+		Reserved.Build(tablesTopLeft.x, tablesTopLeft.y, tablesSize.x, tablesSize.y, [&potentialFieldOrZero](int x, int y) { return (potentialFieldOrZero(x, y) == -1) ? 1 : 0; });
+
 
 		// 4) Search the best location inside the SearchBoundingBox:
 		TilePosition bestLocation;
 		int bestScore = 0;
-		vector<Mineral *> BlockingMinerals;
 
 		for (int y = topLeftSearchBoundingBox.y ; y <= bottomRightSearchBoundingBox.y ; ++y)
 		for (int x = topLeftSearchBoundingBox.x ; x <= bottomRightSearchBoundingBox.x ; ++x)
 		{
-			int score = ComputeBaseLocationScore(TilePosition(x, y));
+			int score = ComputeBaseLocationScore(TilePosition(x, y), Potentials, Reserved, Unbuildable);
 			if (score > bestScore)
-				if (ValidateBaseLocation(TilePosition(x, y), BlockingMinerals))
+				if (ValidateBaseLocation(TilePosition(x, y), Obstructing))
 				{
 					bestScore = score;
 					bestLocation = TilePosition(x, y);
 				}
 		}
 
-		// 5) Clear Tile::m_internalData (required due to our use of Potential Fields: see comments in 2))
-		for (const Ressource * r : RemainingRessources)
-			for (int dy = -dimCC.y-max_tiles_between_CommandCenter_and_ressources ; dy < r->Size().y + dimCC.y+max_tiles_between_CommandCenter_and_ressources ; ++dy)
-			for (int dx = -dimCC.x-max_tiles_between_CommandCenter_and_ressources ; dx < r->Size().x + dimCC.x+max_tiles_between_CommandCenter_and_ressources ; ++dx)
-			{
-				TilePosition t = r->TopLeft() + TilePosition(dx, dy);
-				if (pMap->Valid(t)) pMap->GetTile(t, check_t::no_check).SetInternalData(0);
-			}
-
 		if (!bestScore) break;
 
 		// 6) Create a new Base at bestLocation, assign to it the relevant ressources and remove them from RemainingRessources:
@@ -416,6 +454,9 @@ void Area::CreateBases()
 			break;
 		}
 
+		vector<Mineral *> BlockingMinerals;
+		CollectBlockingMinerals(bestLocation, BlockingMinerals);
+
 		m_Bases.emplace_back(this, bestLocation, AssignedRessources, BlockingMinerals);
 	}
 }
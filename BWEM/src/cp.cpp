@@ -91,7 +91,7 @@ int ChokePoint::DistanceFrom(const ChokePoint * cp) const
 }
 
 
-const CPPath & ChokePoint::GetPathTo(const ChokePoint * cp) const
+CPPath ChokePoint::GetPathTo(const ChokePoint * cp) const
 {
 	return GetGraph()->GetPath(this, cp);
 }
@@ -11,9 +11,11 @@
 #include "graph.h"
 #include "mapImpl.h"
 #include "neutral.h"
+#include "indexedHeap.h"
 #include "winutils.h"
 #include <map>
 #include <deque>
+#include <atomic>
 
 
 using namespace BWAPI;
@@ -190,6 +192,12 @@ void Graph::CreateChokePoints()
 		}
 
 	// 5) Set the references to the freshly created Chokepoints:
+	SetChokePointsReferences();
+}
+
+
+void Graph::SetChokePointsReferences()
+{
 	for (Area::id a = 1 ; a <= AreasCount() ; ++a)
 	for (Area::id b = 1 ; b < a ; ++b)
 		if (!GetChokePoints(a, b).empty())
@@ -200,20 +208,27 @@ void Graph::CreateChokePoints()
 			for (auto & cp : GetChokePoints(a, b))
 				m_ChokePointList.push_back(&cp);
 		}
+
+	// The matrices and the index-based searches rely on ChokePoints()[i]->Index() == i:
+	sort(m_ChokePointList.begin(), m_ChokePointList.end(), [](const ChokePoint * a, const ChokePoint * b){ return a->Index() < b->Index(); });
+	bwem_assert(m_ChokePointList.empty() || (m_ChokePointList.back()->Index() == (int)m_ChokePointList.size()-1));
 }
 
 
 void Graph::SetDistance(const ChokePoint * cpA, const ChokePoint * cpB, int value)
 {
-	m_ChokePointDistanceMatrix[cpA->Index()][cpB->Index()] =
-	m_ChokePointDistanceMatrix[cpB->Index()][cpA->Index()] = value;
+	m_ChokePointDistanceMatrix[MatrixIndex(cpA, cpB)] =
+	m_ChokePointDistanceMatrix[MatrixIndex(cpB, cpA)] = value;
 }
 
 
-void Graph::SetPath(const ChokePoint * cpA, const ChokePoint * cpB, const CPPath & PathAB)
+// Sets the path from cpA to cpB, and the reverse path, given the second and the next to last ChokePoints of the path from cpA to cpB.
+// The remaining of the path is given by the next hops from pAfterA to cpB (Cf. ChokePoint::Path).
+// This only works because the matrix ends up holding shortest paths: the path from pAfterA to cpB is then as short as the rest of the path from cpA to cpB.
+void Graph::SetNextHops(const ChokePoint * cpA, const ChokePoint * cpB, const ChokePoint * pAfterA, const ChokePoint * pBeforeB)
 {
-	m_PathsBetweenChokePoints[cpA->Index()][cpB->Index()] = PathAB;
-	m_PathsBetweenChokePoints[cpB->Index()][cpA->Index()].assign(PathAB.rbegin(), PathAB.rend());
+	m_ChokePointNextHops[MatrixIndex(cpA, cpB)] = pAfterA->Index();
+	m_ChokePointNextHops[MatrixIndex(cpB, cpA)] = pBeforeB->Index();
 }
 
 
@@ -238,58 +253,72 @@ void Graph::ComputeChokePointDistances(const Context * pContext)
 
 		auto DistanceToTargets = pContext->ComputeDistances(pStart, Targets);
 
-		for (int i = 0 ; i < (int)Targets.size() ; ++i)
-		{
-			int newDist = DistanceToTargets[i];
-			int existingDist = Distance(pStart, Targets[i]);
+		UpdateChokePointDistances(pStart, Targets, DistanceToTargets, (void *)(pContext) == (void *)(this));	// tests (Context == Graph) without warning about constant condition
+	}
 
-			if (newDist && ((existingDist == -1) || (newDist < existingDist)))
-			{
-				SetDistance(pStart, Targets[i], newDist);
+///	for (auto & line : trace) { Log << line.first; for (auto e : line.second) Log << " " << e; Log << endl; }
 
-				// Build the path from pStart to Targets[i]:
+}
+
+template void Graph::ComputeChokePointDistances<Graph>(const Graph * pContext);
+template void Graph::ComputeChokePointDistances<Area>(const Area * pContext);
 
-				CPPath Path {pStart, Targets[i]};
 
-				// if (Context == Graph), there may be intermediate ChokePoints. They have been set by ComputeDistances,
-				// so we just have to collect them (in the reverse order) and insert them into Path:
-				if ((void *)(pContext) == (void *)(this))	// tests (Context == Graph) without warning about constant condition
-					for (const ChokePoint * pPrev = Targets[i]->PathBackTrace() ; pPrev != pStart ; pPrev = pPrev->PathBackTrace())
-						Path.insert(Path.begin()+1, pPrev);
+// Updates the distances and the paths from pStart to each of the Targets, given the DistanceToTargets computed by some Context
+// (Cf. ComputeChokePointDistances). If throughGraph, there may be intermediate ChokePoints, which are collected from ChokePoint::PathBackTrace.
+void Graph::UpdateChokePointDistances(const ChokePoint * pStart, const vector<const ChokePoint *> & Targets, const vector<int> & DistanceToTargets, bool throughGraph)
+{
+	for (int i = 0 ; i < (int)Targets.size() ; ++i)
+	{
+		int newDist = DistanceToTargets[i];
+		int existingDist = Distance(pStart, Targets[i]);
 
-				SetPath(pStart, Targets[i], Path);
+		if (newDist && ((existingDist == -1) || (newDist < existingDist)))
+		{
+			SetDistance(pStart, Targets[i], newDist);
 
-			///	vector<WalkPosition> PathTrace;
-			///	for (auto e : Path) PathTrace.push_back(e->Center());
-			///	trace.emplace(int(0.5 + DistanceToTargets[i]/8.0), PathTrace);
+			// The path from pStart to Targets[i] is direct, unless (Context == Graph): then there may be intermediate ChokePoints.
+			// They have been set by ComputeDistances, so we just have to follow them (in the reverse order) to find both ends of the path:
+			const ChokePoint * pAfterStart = Targets[i];
+			const ChokePoint * pBeforeTarget = pStart;
+			if (throughGraph)
+			{
+				pBeforeTarget = Targets[i]->PathBackTrace();
+				while (pAfterStart->PathBackTrace() != pStart)
+					pAfterStart = pAfterStart->PathBackTrace();
 			}
+
+			SetNextHops(pStart, Targets[i], pAfterStart, pBeforeTarget);
 		}
 	}
-
-///	for (auto & line : trace) { Log << line.first; for (auto e : line.second) Log << " " << e; Log << endl; }
-
 }
 
-template void Graph::ComputeChokePointDistances<Graph>(const Graph * pContext);
-template void Graph::ComputeChokePointDistances<Area>(const Area * pContext);
-
 
 void Graph::ComputeChokePointDistanceMatrix()
 {
-	// 1) Size the matrix
-	m_ChokePointDistanceMatrix.clear();
-	m_ChokePointDistanceMatrix.resize(m_ChokePointList.size());
-	for (auto & line : m_ChokePointDistanceMatrix)
-		line.resize(m_ChokePointList.size(), -1);
-
-	m_PathsBetweenChokePoints.clear();
-	m_PathsBetweenChokePoints.resize(m_ChokePointList.size());
-	for (auto & line : m_PathsBetweenChokePoints)
-		line.resize(m_ChokePointList.size());
+	// 1) Size the matrices
+	m_ChokePointDistanceMatrix.assign(m_ChokePointList.size() * m_ChokePointList.size(), -1);
+	m_ChokePointNextHops.assign(m_ChokePointList.size() * m_ChokePointList.size(), -1);
 
 	// 2) Compute distances inside each Area
-	for (const Area & area : Areas())
-		ComputeChokePointDistances(&area);
+	//    This is the same as invoking ComputeChokePointDistances(&area) for each Area, except that the Areas are processed
+	//    independently (in parallel if enabled) before their results are applied, in the same order.
+	vector<vector<vector<int>>> AreaDistances(m_Areas.size());
+	parallelFor(GetMap()->GetThreadPool(), 0, AreasCount(), [this, &AreaDistances](int i)
+	{
+		const Area & area = m_Areas[i];
+		for (int k = 0 ; k < (int)area.ChokePoints().size() ; ++k)
+			AreaDistances[i].push_back(area.ComputeDistances(area.ChokePoints()[k],
+								vector<const ChokePoint *>(area.ChokePoints().begin(), area.ChokePoints().begin() + k)));	// breaks symmetry
+	});
+
+	for (int i = 0 ; i < AreasCount() ; ++i)
+	{
+		const Area & area = m_Areas[i];
+		for (int k = 0 ; k < (int)area.ChokePoints().size() ; ++k)
+			UpdateChokePointDistances(area.ChokePoints()[k],
+								vector<const ChokePoint *>(area.ChokePoints().begin(), area.ChokePoints().begin() + k), AreaDistances[i][k], false);
+	}
 
 	// 3) Compute distances through connected Areas
 	ComputeChokePointDistances(this);
@@ -297,7 +326,7 @@ void Graph::ComputeChokePointDistanceMatrix()
 	for (const ChokePoint * cp : ChokePoints())
 	{
 		SetDistance(cp, cp, 0);
-		SetPath(cp, cp, CPPath{cp});
+		SetNextHops(cp, cp, cp, cp);
 	}
 
 	// 4) Update Area::m_AccessibleNeighbours for each Area
@@ -306,6 +335,8 @@ void Graph::ComputeChokePointDistanceMatrix()
 
 	// 5)  Update Area::m_groupId for each Area
 	UpdateGroupIds();
+
+	OnPathsChanged();
 }
 
 
@@ -317,24 +348,18 @@ void Graph::ComputeChokePointDistanceMatrix()
 // Note: same algo than Area::ComputeDistances (derived from Dijkstra)
 vector<int> Graph::ComputeDistances(const ChokePoint * start, const vector<const ChokePoint *> & Targets) const
 {
-	const MapImpl * pMap = GetMap();
 	vector<int> Distances(Targets.size());
 
-	Tile::UnmarkAll();
-
-	multimap<int, const ChokePoint *> ToVisit;	// a priority queue holding the GetChokePoints to visit ordered by their distance to start.
-	ToVisit.emplace(0, start);
+	IndexedHeap<int> ToVisit(ChokePoints().size());	// a priority queue holding the ChokePoints to visit (by index) ordered by their distance to start.
+	vector<char> Visited(ChokePoints().size(), 0);
+	ToVisit.Push(start->Index(), 0);
 
 	int remainingTargets = Targets.size();
-	while (!ToVisit.empty())
+	while (!ToVisit.Empty())
 	{
-		int currentDist = ToVisit.begin()->first;
-		const ChokePoint * current = ToVisit.begin()->second;
-		const Tile & currentTile = pMap->GetTile(TilePosition(current->Center()), check_t::no_check);
-		bwem_assert(currentTile.InternalData() == currentDist);
-		ToVisit.erase(ToVisit.begin());
-		currentTile.SetInternalData(0);										// resets Tile::m_internalData for future usage
-		currentTile.SetMarked();
+		int currentDist = ToVisit.TopKey();
+		const ChokePoint * current = ChokePoints()[ToVisit.Pop()];
+		Visited[current->Index()] = 1;
 
 		for (int i = 0 ; i < (int)Targets.size() ; ++i)
 			if (current == Targets[i])
@@ -348,48 +373,21 @@ vector<int> Graph::ComputeDistances(const ChokePoint * start, const vector<const
 
 		for (const Area * pArea : {current->GetAreas().first, current->GetAreas().second})
 			for (const ChokePoint * next : pArea->ChokePoints())
-				if (next != current)
+				if ((next != current) && !Visited[next->Index()])
 				{
 					const int newNextDist = currentDist + Distance(current, next);
-					const Tile & nextTile = pMap->GetTile(TilePosition(next->Center()), check_t::no_check); 
-					if (!nextTile.Marked())
-					{
-						if (nextTile.InternalData())	// next already in ToVisit
-						{
-							if (newNextDist < nextTile.InternalData())		// nextNewDist < nextOldDist
-							{	// To update next's distance, we need to remove-insert it from ToVisit:
-								auto range = ToVisit.equal_range(nextTile.InternalData());
-								auto iNext = find_if(range.first, range.second, [next]
-									(const pair<int, const ChokePoint *> & e) { return e.second == next; });
-								bwem_assert(iNext != range.second);
-
-								ToVisit.erase(iNext);
-								nextTile.SetInternalData(newNextDist);
-								next->SetPathBackTrace(current);
-								ToVisit.emplace(newNextDist, next);
-							}
-						}
-						else
-						{
-							nextTile.SetInternalData(newNextDist);
-							next->SetPathBackTrace(current);
-							ToVisit.emplace(newNextDist, next);
-						}
-					}
+					if (ToVisit.PushOrDecrease(next->Index(), newNextDist))	// next not yet in ToVisit, or nextNewDist < nextOldDist
+						next->SetPathBackTrace(current);
 				}
 	}
 
 //	bwem_assert(!remainingTargets);
-
-	// Reset Tile::m_internalData for future usage
-	for (auto e : ToVisit)
-		pMap->GetTile(TilePosition(e.second->Center()), check_t::no_check).SetInternalData(0);	
 	
 	return Distances;
 }
 
 
-const CPPath & Graph::GetPath(const Position & a, const Position & b, int * pLength) const
+CPPath Graph::GetPath(const Position & a, const Position & b, int * pLength) const
 {
 	const Area * pAreaA = GetNearestArea(WalkPosition(a));
 	const Area * pAreaB = GetNearestArea(WalkPosition(b));
@@ -397,13 +395,13 @@ const CPPath & Graph::GetPath(const Position & a, const Position & b, int * pLen
 	if (pAreaA == pAreaB)
 	{
 		if (pLength) *pLength = a.getApproxDistance(b);
-		return m_EmptyPath;
+		return CPPath();
 	};
 		
 	if (!pAreaA->AccessibleFrom(pAreaB))
 	{
 		if (pLength) *pLength = -1;
-		return m_EmptyPath;
+		return CPPath();
 	};
 
 	int minDist_A_B = numeric_limits<int>::max();
@@ -429,17 +427,16 @@ const CPPath & Graph::GetPath(const Position & a, const Position & b, int * pLen
 
 	bwem_assert(minDist_A_B != numeric_limits<int>::max());
 
-	const CPPath & Path = GetPath(pBestCpA, pBestCpB);
+	const CPPath Path = GetPath(pBestCpA, pBestCpB);
 
 	if (pLength)
 	{
-		bwem_assert(Path.size() >= 1);
+		bwem_assert(!Path.empty());
 
 		*pLength = minDist_A_B;
 
-		if (Path.size() == 1)
+		if (pBestCpA == pBestCpB)
 		{
-			bwem_assert(pBestCpA == pBestCpB);
 			const ChokePoint * cp = pBestCpA;
 
 			Position cpEnd1 = center(cp->Pos(ChokePoint::end1));
@@ -456,7 +453,7 @@ const CPPath & Graph::GetPath(const Position & a, const Position & b, int * pLen
 		}
 	}
 
-	return GetPath(pBestCpA, pBestCpB);
+	return Path;
 }
 
 
@@ -487,6 +484,90 @@ void Graph::UpdateGroupIds()
 }
 
 
+// Updates the distances and the paths between the ChokePoints after some blocking Neutral was destroyed,
+// without recomputing everything (Cf. ComputeChokePointDistanceMatrix):
+//  - UnblockedCPs are the ChokePoints that got unblocked.
+//  - ModifiedAreas are the Areas whose Tiles changed. Only their inner distances are recomputed.
+// As such a destruction can only shorten the distances, the shortest paths of the matrix are just repaired
+// using the new paths through each unblocked ChokePoint, then through each shortened inner path (Cf. RelaxChokePointDistances).
+void Graph::UpdateChokePointDistanceMatrix(const vector<const ChokePoint *> & UnblockedCPs, const vector<const Area *> & ModifiedAreas)
+{
+	// 1) The unblocked ChokePoints can now be crossed
+	for (const ChokePoint * cp : UnblockedCPs)
+		RelaxChokePointDistances(cp, cp, 0);
+
+	// 2) Recompute distances inside each modified Area
+	for (const Area * pArea : ModifiedAreas)
+		for (int k = 0 ; k < (int)pArea->ChokePoints().size() ; ++k)
+		{
+			const ChokePoint * pStart = pArea->ChokePoints()[k];
+			const vector<const ChokePoint *> Targets(pArea->ChokePoints().begin(), pArea->ChokePoints().begin() + k);	// breaks symmetry
+			const vector<int> DistanceToTargets = pArea->ComputeDistances(pStart, Targets);
+
+			for (int i = 0 ; i < (int)Targets.size() ; ++i)
+			{
+				const int newDist = DistanceToTargets[i];
+				const int existingDist = Distance(pStart, Targets[i]);
+				if (newDist && ((existingDist == -1) || (newDist < existingDist)))
+					RelaxChokePointDistances(pStart, Targets[i], newDist);
+			}
+		}
+
+	// 3) Same as steps 4) and 5) in ComputeChokePointDistanceMatrix
+	for (Area & area : Areas())
+		area.UpdateAccessibleNeighbours();
+
+	UpdateGroupIds();
+
+	OnPathsChanged();
+}
+
+
+// Updates the distances and the paths between each pair of ChokePoints (s, t), considering the walks s -> u -> v -> t and s -> v -> u -> t,
+// where u -> v is a path of length uv (or u == v and uv == 0, when u has just been unblocked).
+// Assumes the matrix holds the shortest distances before the change, that is that the shortest new walk uses u -> v at most once.
+// As everywhere else, a blocked ChokePoint can only be the first or the last ChokePoint of a path.
+void Graph::RelaxChokePointDistances(const ChokePoint * u, const ChokePoint * v, int uv)
+{
+	const int n = (int)ChokePoints().size();
+
+	// Former distances from u and v, with -1 when u or v cannot be crossed, and former next hops towards u and v:
+	vector<int> Dist_u(n), Dist_v(n);
+	vector<ChokePoint::index> NextHopTo_u(n), NextHopTo_v(n);
+	for (int i = 0 ; i < n ; ++i)
+	{
+		Dist_u[i] = (i == u->Index()) ? 0 : u->Blocked() ? -1 : Distance(u, ChokePoints()[i]);
+		Dist_v[i] = (i == v->Index()) ? 0 : v->Blocked() ? -1 : Distance(v, ChokePoints()[i]);
+		NextHopTo_u[i] = m_ChokePointNextHops[MatrixIndex(ChokePoints()[i], u)];
+		NextHopTo_v[i] = m_ChokePointNextHops[MatrixIndex(ChokePoints()[i], v)];
+	}
+
+	for (int s = 0 ; s < n ; ++s)
+	for (int t = 0 ; t < s ; ++t)
+		for (int direction = 0 ; direction < ((u == v) ? 1 : 2) ; ++direction)
+		{	// direction 0: s -> u -> v -> t    direction 1: s -> v -> u -> t
+			const ChokePoint * a = direction ? v : u;
+			const ChokePoint * b = direction ? u : v;
+			const vector<int> & Dist_a = direction ? Dist_v : Dist_u;
+			const vector<int> & Dist_b = direction ? Dist_u : Dist_v;
+			if ((Dist_a[s] == -1) || (Dist_b[t] == -1)) continue;
+
+			const int newDist = Dist_a[s] + uv + Dist_b[t];
+			const int existingDist = m_ChokePointDistanceMatrix[MatrixIndex(ChokePoints()[s], ChokePoints()[t])];
+			if ((existingDist != -1) && (newDist >= existingDist)) continue;
+
+			// Path = (s -> a) + (b -> t), without repeating u if u == v.
+			// As the path through u alone cannot be shorter from u itself, s == a implies a != b (and t == b implies a != b).
+			bwem_assert(((s != a->Index()) && (t != b->Index())) || (a != b));
+			const ChokePoint::index afterS = (s != a->Index()) ? (direction ? NextHopTo_v[s] : NextHopTo_u[s]) : b->Index();
+			const ChokePoint::index beforeT = (t != b->Index()) ? (direction ? NextHopTo_u[t] : NextHopTo_v[t]) : a->Index();
+
+			SetDistance(ChokePoints()[s], ChokePoints()[t], newDist);
+			SetNextHops(ChokePoints()[s], ChokePoints()[t], ChokePoints()[afterS], ChokePoints()[beforeT]);
+		}
+}
+
+
 void Graph::CollectInformation()
 {
 	// 1) Process the whole Map:
@@ -516,10 +597,306 @@ void Graph::CollectInformation()
 
 void Graph::CreateBases()
 {
+	// The Areas are independent (in parallel if enabled):
+	parallelFor(GetMap()->GetThreadPool(), 0, AreasCount(), [this](int i) { m_Areas[i].CreateBases(); });
+
+	m_baseCount = 0;
+	for (const Area & area : m_Areas)
+		m_baseCount += area.Bases().size();
+}
+
+
+void Graph::ComputeNearestAreas()
+{
+	m_NearestMiniTileAreas.Compute(GetMap());
+	m_NearestTileAreas.Compute(GetMap());
+	OnPathsChanged();
+}
+
+
+void Graph::UpdateNearestAreas(const vector<WalkPosition> & ChangedMiniTiles, const vector<TilePosition> & ChangedTiles)
+{
+	m_NearestMiniTileAreas.Update(GetMap(), ChangedMiniTiles);
+	m_NearestTileAreas.Update(GetMap(), ChangedTiles);
+	OnPathsChanged();
+}
+
+
+// Gives a new value to PathsVersion(), unique among all the Graph instances.
+void Graph::OnPathsChanged()
+{
+	static atomic<int> lastPathsVersion(0);
+	m_pathsVersion = ++lastPathsVersion;
+}
+
+
+template<class TPosition>
+void NearestAreaGrid<TPosition>::Compute(const MapImpl * pMap)
+{
+	const bool tiles = is_same<TPosition, TilePosition>::value;
+	m_width = tiles ? pMap->Size().x : pMap->WalkSize().x;
+	const int height = tiles ? pMap->Size().y : pMap->WalkSize().y;
+
+	m_Ids.assign(m_width * height, 0);
+	m_Distances.assign(m_width * height, numeric_limits<uint16_t>::max());
+
+	RingQueue<TPosition> ToVisit;
+	for (int y = 0 ; y < height ; ++y)
+	for (int x = 0 ; x < m_width ; ++x)
+	{
+		const TPosition p(x, y);
+		const Area::id id = pMap->GetTTile(p, check_t::no_check).AreaId();
+		if (id > 0)
+		{
+			m_Ids[y*m_width + x] = id;
+			m_Distances[y*m_width + x] = 0;
+			ToVisit.Push(p);
+		}
+	}
+
+	Flood(pMap, ToVisit);
+}
+
+
+template<class TPosition>
+void NearestAreaGrid<TPosition>::Update(const MapImpl * pMap, const vector<TPosition> & Changed)
+{
+	if (!Computed()) return;
+
+	RingQueue<TPosition> ToVisit;
+	for (const TPosition & p : Changed)
+	{
+		const int i = p.y*m_width + p.x;
+		const Area::id id = pMap->GetTTile(p, check_t::no_check).AreaId();
+		if ((m_Distances[i] == 0) && (id != m_Ids[i]))
+		{	// Some Area lost p: distances may increase, which the incremental flood cannot handle.
+			Compute(pMap);
+			return;
+		}
+
+		if ((id > 0) && (m_Distances[i] != 0))
+		{
+			m_Ids[i] = id;
+			m_Distances[i] = 0;
+			ToVisit.Push(p);
+		}
+	}
+
+	Flood(pMap, ToVisit);
+}
+
+
+// Breadth first search from the positions in ToVisit, assuming their entries in the grid are up to date.
+// Any position found closer to them than recorded gets updated and visited in turn.
+template<class TPosition>
+void NearestAreaGrid<TPosition>::Flood(const MapImpl * pMap, RingQueue<TPosition> & ToVisit)
+{
+	while (!ToVisit.Empty())
+	{
+		const TPosition current = ToVisit.Pop();
+		const int iCurrent = current.y*m_width + current.x;
+		const uint16_t nextDist = m_Distances[iCurrent] + 1;
+
+		for (TPosition delta : {	TPosition(-1, -1), TPosition(0, -1), TPosition(+1, -1),
+									TPosition(-1,  0),                   TPosition(+1,  0),
+									TPosition(-1, +1), TPosition(0, +1), TPosition(+1, +1)})
+		{
+			const TPosition next = current + delta;
+			if (pMap->Valid(next))
+			{
+				const int iNext = next.y*m_width + next.x;
+				if (nextDist < m_Distances[iNext])
+				{
+					m_Ids[iNext] = m_Ids[iCurrent];
+					m_Distances[iNext] = nextDist;
+					ToVisit.Push(next);
+				}
+			}
+		}
+	}
+}
+
+
+template class NearestAreaGrid<WalkPosition>;
+template class NearestAreaGrid<TilePosition>;
+
+
+static uint32_t cacheIndex(const map<const Neutral *, uint32_t> & NeutralIndexes, const Neutral * pNeutral)
+{
+	auto it = NeutralIndexes.find(pNeutral);
+	bwem_assert_throw(it != NeutralIndexes.end());
+	return it->second;
+}
+
+
+static Neutral * cachedNeutral(const vector<Neutral *> & Neutrals, uint32_t index)
+{
+	checkCacheData(index < Neutrals.size());
+	return Neutrals[index];
+}
+
+
+void Graph::SaveToCache(CacheWriter & writer, const vector<Neutral *> & Neutrals) const
+{
+	map<const Neutral *, uint32_t> NeutralIndexes;
+	for (uint32_t i = 0 ; i < Neutrals.size() ; ++i)
+		NeutralIndexes[Neutrals[i]] = i;
+
+	// 1) Areas
+	writer.Write(uint32_t(m_Areas.size()));
+	for (const Area & area : m_Areas)
+	{
+		writer.Write(area.Top());
+		writer.Write(int32_t(area.MiniTiles()));
+	}
+
+	// 2) ChokePoints, in the order of their indexes
+	vector<const ChokePoint *> ChokePointsByIndex(m_ChokePointList.size());
+	for (const ChokePoint * cp : m_ChokePointList)
+		ChokePointsByIndex[cp->Index()] = cp;
+
+	writer.Write(uint32_t(ChokePointsByIndex.size()));
+	for (const ChokePoint * cp : ChokePointsByIndex)
+	{
+		bwem_assert(cp->IsPseudo() == (cp->BlockingNeutral() != nullptr));
+		writer.Write(cp->GetAreas().first->Id());
+		writer.Write(cp->GetAreas().second->Id());
+		writer.Write(cp->IsPseudo() ? int32_t(cacheIndex(NeutralIndexes, cp->BlockingNeutral())) : int32_t(-1));
+		writer.WriteVector(vector<WalkPosition>(cp->Geometry().begin(), cp->Geometry().end()));
+	}
+
+	// 3) Distances and paths
+	bwem_assert_throw(ChokePointsByIndex.size() <= numeric_limits<uint16_t>::max());
+	writer.WriteArray(m_ChokePointDistanceMatrix.data(), m_ChokePointDistanceMatrix.size());
+	writer.WriteArray(m_ChokePointNextHops.data(), m_ChokePointNextHops.size());
+
+	// 4) Bases
+	for (const Area & area : m_Areas)
+	{
+		writer.Write(uint32_t(area.Bases().size()));
+		for (const Base & base : area.Bases())
+		{
+			vector<uint32_t> AssignedRessources;
+			for (const Mineral * m : base.Minerals())	AssignedRessources.push_back(cacheIndex(NeutralIndexes, m));
+			for (const Geyser * g : base.Geysers())		AssignedRessources.push_back(cacheIndex(NeutralIndexes, g));
+
+			vector<uint32_t> BlockingMinerals;
+			for (const Mineral * m : base.BlockingMinerals())	BlockingMinerals.push_back(cacheIndex(NeutralIndexes, m));
+
+			writer.Write(base.Location());
+			writer.WriteVector(AssignedRessources);
+			writer.WriteVector(BlockingMinerals);
+		}
+	}
+}
+
+
+// Assumes the MiniTiles and the Tiles have already been restored.
+// Does the same job as CreateAreas, CreateChokePoints, ComputeChokePointDistanceMatrix, CollectInformation and CreateBases,
+// using the data saved by SaveToCache instead of recomputing it.
+void Graph::LoadFromCache(CacheReader & reader, const vector<Neutral *> & Neutrals)
+{
+	// 1) Areas
+	vector<pair<WalkPosition, int>> AreasList(reader.Read<uint32_t>());
+	for (Area::id id = 1 ; id <= (Area::id)AreasList.size() ; ++id)
+	{
+		WalkPosition top = reader.Read<WalkPosition>();
+		int miniTiles = reader.Read<int32_t>();
+		checkCacheData(GetMap()->Valid(top) && (GetMap()->GetMiniTile(top).AreaId() == id));
+
+		AreasList[id-1] = make_pair(top, miniTiles);
+	}
+
+	CreateAreas(AreasList);
+
+	// 2) ChokePoints
+	struct CachedChokePoint { Area::id a; Area::id b; Neutral * pBlockingNeutral; deque<WalkPosition> Geometry; };
+	vector<CachedChokePoint> CachedChokePoints(reader.Read<uint32_t>());
+	map<pair<Area::id, Area::id>, int> ChokePointsByAreaPair;
+	for (CachedChokePoint & cp : CachedChokePoints)
+	{
+		cp.a = reader.Read<Area::id>();
+		cp.b = reader.Read<Area::id>();
+		checkCacheData(Valid(cp.a) && Valid(cp.b) && (cp.a != cp.b));
+
+		int32_t blockingNeutral = reader.Read<int32_t>();
+		cp.pBlockingNeutral = (blockingNeutral >= 0) ? cachedNeutral(Neutrals, blockingNeutral) : nullptr;
+
+		vector<WalkPosition> Geometry;
+		reader.ReadVector(Geometry);
+		checkCacheData(!Geometry.empty() && all_of(Geometry.begin(), Geometry.end(), [this](WalkPosition w){ return GetMap()->Valid(w); }));
+		cp.Geometry.assign(Geometry.begin(), Geometry.end());
+
+		++ChokePointsByAreaPair[make_pair(min(cp.a, cp.b), max(cp.a, cp.b))];
+	}
+
+	m_ChokePointsMatrix.resize(AreasCount() + 1);
+	for (Area::id id = 1 ; id <= AreasCount() ; ++id)
+		m_ChokePointsMatrix[id].resize(id);			// triangular matrix
+
+	for (const auto & pair_count : ChokePointsByAreaPair)		// the addresses of the ChokePoints must remain unchanged
+		GetChokePoints(pair_count.first.first, pair_count.first.second).reserve(pair_count.second);
+
+	for (ChokePoint::index i = 0 ; i < (ChokePoint::index)CachedChokePoints.size() ; ++i)
+	{
+		const CachedChokePoint & cp = CachedChokePoints[i];
+		GetChokePoints(cp.a, cp.b).emplace_back(this, i, GetArea(cp.a), GetArea(cp.b), cp.Geometry, cp.pBlockingNeutral);
+	}
+
+	SetChokePointsReferences();
+
+	// 3) Distances and paths
+	const size_t n = m_ChokePointList.size();
+	vector<const ChokePoint *> ChokePointsByIndex(n);
+	for (const ChokePoint * cp : m_ChokePointList)
+		ChokePointsByIndex[cp->Index()] = cp;
+
+	m_ChokePointDistanceMatrix.resize(n*n);
+	reader.ReadArray(m_ChokePointDistanceMatrix.data(), m_ChokePointDistanceMatrix.size());
+
+	m_ChokePointNextHops.resize(n*n);
+	reader.ReadArray(m_ChokePointNextHops.data(), m_ChokePointNextHops.size());
+	for (ChokePoint::index i : m_ChokePointNextHops)
+		checkCacheData((-1 <= i) && (i < (int)n));
+
+	for (Area & area : Areas())
+		area.UpdateAccessibleNeighbours();
+
+	UpdateGroupIds();
+
+	// 4) Information and Bases
+	CollectInformation();
+
 	m_baseCount = 0;
 	for (Area & area : m_Areas)
 	{
-		area.CreateBases();
+		const uint32_t baseCount = reader.Read<uint32_t>();
+		area.Bases().reserve(baseCount);					// the addresses of the Bases must remain unchanged
+		for (uint32_t i = 0 ; i < baseCount ; ++i)
+		{
+			TilePosition location = reader.Read<TilePosition>();
+			vector<uint32_t> AssignedIndexes, BlockingIndexes;
+			reader.ReadVector(AssignedIndexes);
+			reader.ReadVector(BlockingIndexes);
+			checkCacheData(GetMap()->Valid(location) && !AssignedIndexes.empty());
+
+			vector<Ressource *> AssignedRessources;
+			for (uint32_t index : AssignedIndexes)
+			{
+				AssignedRessources.push_back(cachedNeutral(Neutrals, index)->IsRessource());
+				checkCacheData(AssignedRessources.back());
+			}
+
+			vector<Mineral *> BlockingMinerals;
+			for (uint32_t index : BlockingIndexes)
+			{
+				BlockingMinerals.push_back(cachedNeutral(Neutrals, index)->IsMineral());
+				checkCacheData(BlockingMinerals.back());
+			}
+
+			area.Bases().emplace_back(&area, location, AssignedRessources, BlockingMinerals);
+		}
+
 		m_baseCount += area.Bases().size();
 	}
 }
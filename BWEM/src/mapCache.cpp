@@ -0,0 +1,139 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This file is part of the BWEM Library.
+// BWEM is free software, licensed under the MIT/X11 License. 
+// A copy of the license is provided with the library in the LICENSE file.
+// Copyright (c) 2015, 2017, Igor Dimitrijevic
+//
+//////////////////////////////////////////////////////////////////////////
+
+
+#include "mapCache.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+using namespace std;
+
+
+namespace BWEM {
+namespace utils {
+
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                          //
+//                                  class Fingerprint
+//                                                                                          //
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+
+void Fingerprint::Add(const void * data, size_t size)
+{
+	const uint64_t prime = 1099511628211ULL;
+	const char * bytes = static_cast<const char *>(data);
+
+	for ( ; size >= sizeof(uint64_t) ; size -= sizeof(uint64_t), bytes += sizeof(uint64_t))
+	{
+		uint64_t word;
+		memcpy(&word, bytes, sizeof(uint64_t));
+		m_hash = (m_hash ^ word) * prime;
+	}
+
+	for ( ; size ; --size, ++bytes)
+		m_hash = (m_hash ^ uint8_t(*bytes)) * prime;
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                          //
+//                                  class MappedFile
+//                                                                                          //
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const string & fileName)
+{
+	HANDLE hFile = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (hFile == INVALID_HANDLE_VALUE) return;
+	m_hFile = hFile;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(hFile, &size) || (size.QuadPart == 0)) return;
+
+	HANDLE hMapping = CreateFileMappingA(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!hMapping) return;
+	m_hMapping = hMapping;
+
+	m_pData = static_cast<const char *>(MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0));
+	if (m_pData) m_size = size_t(size.QuadPart);
+}
+
+
+MappedFile::~MappedFile()
+{
+	if (m_pData)	UnmapViewOfFile(m_pData);
+	if (m_hMapping)	CloseHandle(static_cast<HANDLE>(m_hMapping));
+	if (m_hFile)	CloseHandle(static_cast<HANDLE>(m_hFile));
+}
+
+#else
+
+MappedFile::MappedFile(const string & fileName)
+{
+	int fd = open(fileName.c_str(), O_RDONLY);
+	if (fd == -1) return;
+
+	struct stat st;
+	if ((fstat(fd, &st) == 0) && (st.st_size > 0))
+	{
+		void * p = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+		if (p != MAP_FAILED)
+		{
+			m_pData = static_cast<const char *>(p);
+			m_size = size_t(st.st_size);
+		}
+	}
+
+	close(fd);		// the mapping remains valid
+}
+
+
+MappedFile::~MappedFile()
+{
+	if (m_pData) munmap(const_cast<char *>(m_pData), m_size);
+}
+
+#endif
+
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                          //
+//                                  class CacheReader
+//                                                                                          //
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+
+const char * CacheReader::Skip(size_t size)
+{
+	if (size > Remaining()) throw Exception("map cache: unexpected end of data");
+
+	const char * p = m_pCurrent;
+	m_pCurrent += size;
+	return p;
+}
+
+
+
+}} // namespace BWEM::utils
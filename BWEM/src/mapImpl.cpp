@@ -12,6 +12,11 @@
 #include "neutral.h"
 #include "bwapiExt.h"
 #include "winutils.h"
+#include <array>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
 
 
 using namespace BWAPI;
@@ -46,6 +51,65 @@ static bool adjoins8SomeLakeOrNeutral(WalkPosition p, const MapImpl * pMap)
 
 
 
+//////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                          //
+//                                  map cache files
+//                                                                                          //
+//////////////////////////////////////////////////////////////////////////////////////////////
+//
+// A map cache file consists of a MapCacheHeader followed by the payload written by MapImpl::SaveToCache.
+// Only the files matching the header's fields, including the checksum of the payload, are used.
+
+const uint32_t map_cache_magic = 0x4D455742;		// "BWEM"
+
+struct MapCacheHeader
+{
+	uint32_t	magic;
+	uint32_t	version;
+	uint32_t	miniTileSize;
+	uint32_t	positionSize;
+	uint64_t	fingerprint;
+	uint64_t	payloadSize;
+	uint64_t	checksum;
+};
+
+
+static string cacheFileName(string directory, uint64_t fingerprint)
+{
+	if (!directory.empty() && (directory.back() != '/') && (directory.back() != '\\'))
+		directory += '/';
+
+	ostringstream oss;
+	oss << directory << "bwem_" << hex << setfill('0') << setw(16) << fingerprint << ".bin";
+	return oss.str();
+}
+
+
+// If File is a valid map cache file for fingerprint, returns its payload (and sets payloadSize). Otherwise, returns nullptr.
+static const char * cachePayload(const MappedFile & File, uint64_t fingerprint, size_t & payloadSize)
+{
+	if (!File.Data() || (File.Size() < sizeof(MapCacheHeader))) return nullptr;
+
+	CacheReader reader(File.Data(), File.Size());
+	const MapCacheHeader header = reader.Read<MapCacheHeader>();
+	if ((header.magic != map_cache_magic) ||
+		(header.version != map_cache_version) ||
+		(header.miniTileSize != sizeof(MiniTile)) ||
+		(header.positionSize != sizeof(WalkPosition)) ||
+		(header.fingerprint != fingerprint) ||
+		(header.payloadSize != reader.Remaining()))
+		return nullptr;
+
+	payloadSize = reader.Remaining();
+	const char * pPayload = reader.Skip(payloadSize);
+
+	Fingerprint checksum;
+	checksum.Add(pPayload, payloadSize);
+	return (checksum.Value() == header.checksum) ? pPayload : nullptr;
+}
+
+
+
 //////////////////////////////////////////////////////////////////////////////////////////////
 //                                                                                          //
 //                                  class MapImpl
@@ -67,12 +131,29 @@ MapImpl::~MapImpl()
 
 void MapImpl::Initialize()
 {
+	if (!Initialize(true))		// some cache file was found but turned out to be unusable
+		Initialize(false);
+}
+
+
+// Returns false if readCache == true and the analysis could not be restored from some valid-looking cache file.
+// In this case, the Map is left in an incomplete state and the caller has to Initialize it again, ignoring the cache files.
+bool MapImpl::Initialize(bool readCache)
+{
+	const string cacheReadDirectory = m_cacheReadDirectory;
+	const string cacheWriteDirectory = m_cacheWriteDirectory;
+	unique_ptr<ThreadPool> pThreadPool = move(m_pThreadPool);
+	function<void (const char *)> phaseObserver = move(m_phaseObserver);
+
 	this->~MapImpl();
     new (this) MapImpl();
 
-///	Timer overallTimer;
-///	Timer timer;
+	m_cacheReadDirectory = cacheReadDirectory;
+	m_cacheWriteDirectory = cacheWriteDirectory;
+	m_pThreadPool = move(pThreadPool);
+	m_phaseObserver = move(phaseObserver);
 
+	Phase("Resize");
 	m_Size = TilePosition(bw->mapWidth(), bw->mapHeight());
 	m_size = Size().x * Size().y;
 	m_Tiles.resize(m_size);
@@ -86,128 +167,233 @@ void MapImpl::Initialize()
 	for (TilePosition t : bw->getStartLocations())
 		m_StartingLocations.push_back(t);
 
-///	bw << "Map::Initialize-resize: " << timer.ElapsedMilliseconds() << " ms" << endl; timer.Reset();
-	
+	Phase("LoadData");
 	LoadData();
-///	bw << "Map::LoadData: " << timer.ElapsedMilliseconds() << " ms" << endl; timer.Reset();
-	
+
+	const bool cacheEnabled = !m_cacheReadDirectory.empty() || !m_cacheWriteDirectory.empty();
+	const uint64_t fingerprint = cacheEnabled ? ComputeFingerprint() : 0;
+
+	if (cacheEnabled && readCache)
+		for (const string & directory : {m_cacheReadDirectory, m_cacheWriteDirectory})
+			if (!directory.empty())
+			{
+				MappedFile File(cacheFileName(directory, fingerprint));
+				size_t payloadSize;
+				if (const char * pPayload = cachePayload(File, fingerprint, payloadSize))
+				{
+					Phase("LoadFromCache");
+					try
+					{
+						CacheReader reader(pPayload, payloadSize);
+						LoadFromCache(reader);
+						checkCacheData(reader.Remaining() == 0);
+					}
+					catch (const Exception &)
+					{
+						Phase(nullptr);
+						return false;
+					}
+
+					Phase("ComputeNearestAreas");
+					GetGraph().ComputeNearestAreas();
+					Phase(nullptr);
+					return true;
+				}
+			}
+
+	Phase("DecideSeasOrLakes");
 	DecideSeasOrLakes();
-///	bw << "Map::DecideSeasOrLakes: " << timer.ElapsedMilliseconds() << " ms" << endl; timer.Reset();
 
+	Phase("InitializeNeutrals");
 	InitializeNeutrals();
-///	bw << "Map::InitializeNeutrals: " << timer.ElapsedMilliseconds() << " ms" << endl; timer.Reset();
 
+	Phase("ComputeAltitude");
 	ComputeAltitude();
-///	bw << "Map::ComputeAltitude: " << timer.ElapsedMilliseconds() << " ms" << endl; timer.Reset();
 
+	Phase("ProcessBlockingNeutrals");
 	ProcessBlockingNeutrals();
-///	bw << "Map::ProcessBlockingNeutrals: " << timer.ElapsedMilliseconds() << " ms" << endl; timer.Reset();
 
+	Phase("ComputeAreas");
 	ComputeAreas();
-///	bw << "Map::ComputeAreas: " << timer.ElapsedMilliseconds() << " ms" << endl; timer.Reset();
 
+	Phase("CreateChokePoints");
 	GetGraph().CreateChokePoints();
-///	bw << "Graph::CreateChokePoints: " << timer.ElapsedMilliseconds() << " ms" << endl; timer.Reset();
 
+	Phase("ComputeChokePointDistanceMatrix");
 	GetGraph().ComputeChokePointDistanceMatrix();
-///	bw << "Graph::ComputeChokePointDistanceMatrix: " << timer.ElapsedMilliseconds() << " ms" << endl; timer.Reset();
 
+	Phase("CollectInformation");
 	GetGraph().CollectInformation();
-///	bw << "Graph::CollectInformation: " << timer.ElapsedMilliseconds() << " ms" << endl; timer.Reset();
 
+	Phase("CreateBases");
 	GetGraph().CreateBases();
-///	bw << "Graph::CreateBases: " << timer.ElapsedMilliseconds() << " ms" << endl; timer.Reset();
 
-///	bw << "Map::Initialize: " << overallTimer.ElapsedMilliseconds() << " ms" << endl;
+	Phase("ComputeNearestAreas");
+	GetGraph().ComputeNearestAreas();
+
+	if (!m_cacheWriteDirectory.empty())
+	{
+		Phase("SaveToCache");
+		SaveToCache(fingerprint);
+	}
+
+	Phase(nullptr);
+	return true;
+}
+
+
+void MapImpl::EnableParallelAnalysis(int threadCount)
+{
+	if (threadCount <= 0) threadCount = max(1, (int)thread::hardware_concurrency());
+
+	m_pThreadPool = make_unique<ThreadPool>(threadCount);
 }
 
 
 // Computes walkability, buildability and groundHeight and doodad information, using BWAPI corresponding functions
+// BWAPI is only queried from the calling thread. The rest of the work is done row by row (in parallel if enabled).
 void MapImpl::LoadData()
 {
-	// Mark unwalkable minitiles (minitiles are walkable by default)
+	vector<char> BwapiWalkable(m_walkSize);
 	for (int y = 0 ; y < WalkSize().y ; ++y)
 	for (int x = 0 ; x < WalkSize().x ; ++x)
-		if (!bw->isWalkable(x, y))						// For each unwalkable minitile, we also mark its 8 neighbours as not walkable.
-			for (int dy = -1 ; dy <= +1 ; ++dy)			// According to some tests, this prevents from wrongly pretending one Marine can go by some thin path.
-			for (int dx = -1 ; dx <= +1 ; ++dx)
+		BwapiWalkable[y*WalkSize().x + x] = bw->isWalkable(x, y);
+
+	vector<char> BwapiBuildable(m_size);
+	vector<int> BwapiGroundHeight(m_size);
+	for (int y = 0 ; y < Size().y ; ++y)
+	for (int x = 0 ; x < Size().x ; ++x)
+	{
+		BwapiBuildable[y*Size().x + x] = bw->isBuildable(TilePosition(x, y));
+		BwapiGroundHeight[y*Size().x + x] = bw->getGroundHeight(TilePosition(x, y));
+	}
+
+	// Mark unwalkable minitiles (minitiles are walkable by default)
+	parallelFor(GetThreadPool(), 0, WalkSize().y, [this, &BwapiWalkable](int y)
+	{
+		for (int x = 0 ; x < WalkSize().x ; ++x)
+		{
+			bool walkable = true;
+			for (int dy = -1 ; dy <= +1 ; ++dy)			// For each unwalkable minitile, we also mark its 8 neighbours as not walkable.
+			for (int dx = -1 ; dx <= +1 ; ++dx)			// According to some tests, this prevents from wrongly pretending one Marine can go by some thin path.
 			{
 				WalkPosition w(x+dx, y+dy);
-				if (Valid(w))
-					GetMiniTile_(w, check_t::no_check).SetWalkable(false);
+				if (Valid(w) && !BwapiWalkable[w.y*WalkSize().x + w.x])
+					walkable = false;
 			}
 
+			if (!walkable)
+				GetMiniTile_(WalkPosition(x, y), check_t::no_check).SetWalkable(false);
+		}
+	});
+
 	// Mark buildable tiles (tiles are unbuildable by default)
-	for (int y = 0 ; y < Size().y ; ++y)
-	for (int x = 0 ; x < Size().x ; ++x)
+	parallelFor(GetThreadPool(), 0, Size().y, [this, &BwapiBuildable, &BwapiGroundHeight](int y)
 	{
-		TilePosition t(x, y);
-		if (bw->isBuildable(t))
+		for (int x = 0 ; x < Size().x ; ++x)
 		{
-			GetTile_(t).SetBuildable();
+			TilePosition t(x, y);
+			if (BwapiBuildable[y*Size().x + x])
+			{
+				GetTile_(t).SetBuildable();
 
-			// Ensures buildable ==> walkable:
-			for (int dy = 0 ; dy < 4 ; ++dy)
-			for (int dx = 0 ; dx < 4 ; ++dx)
-				GetMiniTile_(WalkPosition(t) + WalkPosition(dx, dy), check_t::no_check).SetWalkable(true);
-		}
+				// Ensures buildable ==> walkable:
+				for (int dy = 0 ; dy < 4 ; ++dy)
+				for (int dx = 0 ; dx < 4 ; ++dx)
+					GetMiniTile_(WalkPosition(t) + WalkPosition(dx, dy), check_t::no_check).SetWalkable(true);
+			}
 
-		// Add groundHeight and doodad information:
-		int bwapiGroundHeight = bw->getGroundHeight(t);
-		GetTile_(t).SetGroundHeight(bwapiGroundHeight / 2);
-		if (bwapiGroundHeight % 2)
-			GetTile_(t).SetDoodad();
-	}
+			// Add groundHeight and doodad information:
+			int bwapiGroundHeight = BwapiGroundHeight[y*Size().x + x];
+			GetTile_(t).SetGroundHeight(bwapiGroundHeight / 2);
+			if (bwapiGroundHeight % 2)
+				GetTile_(t).SetDoodad();
+		}
+	});
 }
 
 
+// Each 4-connected set of SeaOrLake MiniTiles becomes either a Lake (if small enough and away from the border of the Map) or a Sea.
+// The sets are computed with a union-find labeling: the strips of rows are labeled independently (in parallel if enabled),
+// then merged together.
 void MapImpl::DecideSeasOrLakes()
 {
-	for (int y = 0 ; y < WalkSize().y ; ++y)
-	for (int x = 0 ; x < WalkSize().x ; ++x)
+	const int width = WalkSize().x;
+	const int height = WalkSize().y;
+
+	// Parent[i] == -1 for the MiniTiles that are not SeaOrLake.
+	// Parent[i] <= i always holds, so that the root of each set is its first MiniTile (in raster order).
+	vector<int> Parent(m_walkSize, -1);
+	auto root = [&Parent](int i) { while (Parent[i] != i) i = Parent[i] = Parent[Parent[i]]; return i; };
+	auto unite = [&Parent, &root](int a, int b) { a = root(a); b = root(b); if (a < b) Parent[b] = a; else if (b < a) Parent[a] = b; };
+
+	// 1) Label each strip of rows
+	const int strips = GetThreadPool() ? min(height, 4 * GetThreadPool()->ThreadCount()) : 1;
+	auto stripBegin = [height, strips](int s) { return s * height / strips; };
+
+	parallelFor(GetThreadPool(), 0, strips, [&](int s)
 	{
-		WalkPosition origin = WalkPosition(x, y);
-		MiniTile & Origin = GetMiniTile_(origin, check_t::no_check);
-		if (Origin.SeaOrLake())
+		for (int y = stripBegin(s) ; y < stripBegin(s+1) ; ++y)
+		for (int x = 0 ; x < width ; ++x)
 		{
-			vector<WalkPosition> ToSearch{origin};
-			vector<MiniTile *> SeaExtent{&Origin};
-			Origin.SetSea();
-			WalkPosition topLeft = origin;
-			WalkPosition bottomRight = origin;
-			while (!ToSearch.empty())
+			const int i = y*width + x;
+			if (m_MiniTiles[i].SeaOrLake())
 			{
-				WalkPosition current = ToSearch.back();
-				if (current.x < topLeft.x) topLeft.x = current.x;
-				if (current.y < topLeft.y) topLeft.y = current.y;
-				if (current.x > bottomRight.x) bottomRight.x = current.x;
-				if (current.y > bottomRight.y) bottomRight.y = current.y;
-
-				ToSearch.pop_back();
-				for (WalkPosition delta : {WalkPosition(0, -1), WalkPosition(-1, 0), WalkPosition(+1, 0), WalkPosition(0, +1)})
-				{
-					WalkPosition next = current + delta;
-					if (Valid(next))
-					{
-						MiniTile & Next = GetMiniTile_(next, check_t::no_check);
-						if (Next.SeaOrLake())
-						{
-							ToSearch.push_back(next);
-							if (SeaExtent.size() <= lake_max_miniTiles) SeaExtent.push_back(&Next);
-							Next.SetSea();
-						}
-					}
-				}
+				Parent[i] = i;
+				if ((x > 0) && (Parent[i-1] != -1)) unite(i-1, i);
+				if ((y > stripBegin(s)) && (Parent[i-width] != -1)) unite(i-width, i);
 			}
-
-			if ((SeaExtent.size() <= lake_max_miniTiles) &&
-				(bottomRight.x - topLeft.x <= lake_max_width_in_miniTiles) &&
-				(bottomRight.y - topLeft.y <= lake_max_width_in_miniTiles) &&
-				(topLeft.x >= 2) && (topLeft.y >= 2) && (bottomRight.x < WalkSize().x-2) && (bottomRight.y < WalkSize().y-2))
-				for (MiniTile * pSea : SeaExtent)
-					pSea->SetLake();
 		}
+	});
+
+	// 2) Merge the strips
+	for (int s = 1 ; s < strips ; ++s)
+	for (int x = 0 ; x < width ; ++x)
+	{
+		const int i = stripBegin(s)*width + x;
+		if ((Parent[i] != -1) && (Parent[i-width] != -1)) unite(i-width, i);
 	}
+
+	// 3) Number the sets and compute their size and bounding box.
+	//    Because Parent[i] < i for any non root, the root of Parent[i] is always known when i is reached.
+	struct SeaExtent { int size; WalkPosition topLeft; WalkPosition bottomRight; };
+	vector<SeaExtent> SeaExtents;
+	vector<int> SeaExtentIndex(m_walkSize);
+	for (int i = 0 ; i < m_walkSize ; ++i)
+		if (Parent[i] != -1)
+		{
+			const WalkPosition w(i % width, i / width);
+			if (Parent[i] == i)
+			{
+				SeaExtentIndex[i] = (int)SeaExtents.size();
+				SeaExtents.push_back(SeaExtent{0, w, w});
+			}
+			else
+				SeaExtentIndex[i] = SeaExtentIndex[Parent[i]];
+
+			SeaExtent & extent = SeaExtents[SeaExtentIndex[i]];
+			++extent.size;
+			makeBoundingBoxIncludePoint(extent.topLeft, extent.bottomRight, w);
+		}
+
+	vector<char> Lake;
+	for (const SeaExtent & extent : SeaExtents)
+		Lake.push_back(
+			(extent.size <= lake_max_miniTiles) &&
+			(extent.bottomRight.x - extent.topLeft.x <= lake_max_width_in_miniTiles) &&
+			(extent.bottomRight.y - extent.topLeft.y <= lake_max_width_in_miniTiles) &&
+			(extent.topLeft.x >= 2) && (extent.topLeft.y >= 2) && (extent.bottomRight.x < WalkSize().x-2) && (extent.bottomRight.y < WalkSize().y-2));
+
+	// 4) Apply
+	parallelFor(GetThreadPool(), 0, height, [&](int y)
+	{
+		for (int i = y*width ; i < (y+1)*width ; ++i)
+			if (Parent[i] != -1)
+			{
+				m_MiniTiles[i].SetSea();
+				if (Lake[SeaExtentIndex[i]]) m_MiniTiles[i].SetLake();
+			}
+	});
 }
 
 
@@ -287,14 +473,87 @@ void MapImpl::ReplaceAreaIds(BWAPI::WalkPosition p, Area::id newAreaId)
 }
 
 
+const int altitude_scale = 8;	// 8 provides a pixel definition for altitude_t, since altitudes are computed from miniTiles which are 8x8 pixels
+
+
 // Assigns MiniTile::m_altitude foar each miniTile having AltitudeMissing()
 // Cf. MiniTile::Altitude() for meaning of altitude_t.
-// Altitudes are computed using the straightforward Dijkstra's algorithm : the lower ones are computed first, starting from the seaside-miniTiles neighbours.
-// The point here is to precompute all possible altitudes for all possible tiles, and sort them.
+// Two engines are available (Cf. BWEM_USE_DISTANCE_TRANSFORM and BWEM_CHECK_DISTANCE_TRANSFORM in defs.h).
 void MapImpl::ComputeAltitude()
 {
-	const int altitude_scale = 8;	// 8 provides a pixel definition for altitude_t, since altitudes are computed from miniTiles which are 8x8 pixels
+#if BWEM_CHECK_DISTANCE_TRANSFORM
+
+	const vector<altitude_t> Altitudes = ComputeAltitudesByDistanceTransform();
+	ComputeAltitudeFromSeaSides();
+
+	int mismatches = 0;
+	int maxDifference = 0;
+	for (int i = 0 ; i < m_walkSize ; ++i)
+		if (Altitudes[i] != m_MiniTiles[i].Altitude())
+		{
+			++mismatches;
+			maxDifference = max(maxDifference, abs(Altitudes[i] - m_MiniTiles[i].Altitude()));
+		}
+
+	if (mismatches)
+		bw << "Map::ComputeAltitude: " << mismatches << " altitude mismatches between the 2 engines (max difference: " << maxDifference << ")" << endl;
+
+#elif BWEM_USE_DISTANCE_TRANSFORM
+
+	const vector<altitude_t> Altitudes = ComputeAltitudesByDistanceTransform();
+
+	altitude_t maxAltitude = 0;
+	for (int i = 0 ; i < m_walkSize ; ++i)
+		if (m_MiniTiles[i].AltitudeMissing())
+		{
+			m_MiniTiles[i].SetAltitude(Altitudes[i]);
+			maxAltitude = max(maxAltitude, Altitudes[i]);
+		}
+
+	m_maxAltitude = maxAltitude;
+
+#else
+
+	ComputeAltitudeFromSeaSides();
+
+#endif
+}
+
+
+// Altitudes are computed as the exact distance to the nearest Sea-MiniTile, the border of the Map being considered as Sea.
+// Cf. utils::squaredDistanceTransform: the complexity is linear in the number of MiniTiles.
+// Returns the altitude of each MiniTile (0 for Sea-MiniTiles).
+// This is not always the altitude computed by ComputeAltitudeFromSeaSides: the former engine stops expanding a seaside MiniTile
+// once it has not generated any altitude over 2 MiniTiles, so a few MiniTiles far from the Sea get their altitude from a farther
+// seaside MiniTile than the nearest one (1 more than here on the test maps). As the Areas are computed from the altitudes,
+// they can come out differently on some maps.
+vector<altitude_t> MapImpl::ComputeAltitudesByDistanceTransform() const
+{
+	const int width = WalkSize().x + 2;
+	const int height = WalkSize().y + 2;
 
+	vector<int> Grid(width * height, 0);		// the extra border-MiniTiles remain 0 (Sea)
+	for (int y = 0 ; y < WalkSize().y ; ++y)
+	for (int x = 0 ; x < WalkSize().x ; ++x)
+		Grid[(y+1)*width + x+1] = GetMiniTile(WalkPosition(x, y), check_t::no_check).Sea() ? 0 : 1;
+
+	squaredDistanceTransform(Grid, width, height, GetThreadPool());
+
+	vector<altitude_t> Altitudes(m_walkSize);
+	parallelFor(GetThreadPool(), 0, WalkSize().y, [this, &Grid, &Altitudes, width](int y)
+	{
+		for (int x = 0 ; x < WalkSize().x ; ++x)
+			Altitudes[y*WalkSize().x + x] = altitude_t(0.5 + sqrt(Grid[(y+1)*width + x+1]) * altitude_scale);
+	});
+
+	return Altitudes;
+}
+
+
+// Altitudes are computed using the straightforward Dijkstra's algorithm : the lower ones are computed first, starting from the seaside-miniTiles neighbours.
+// The point here is to precompute all possible altitudes for all possible tiles, and sort them.
+void MapImpl::ComputeAltitudeFromSeaSides()
+{
 	// 1) Fill in and sort DeltasByAscendingAltitude
 	const int range = max(WalkSize().x, WalkSize().y) / 2 + 3;		// should suffice for maps with no Sea.
 	
@@ -720,31 +979,268 @@ void MapImpl::OnBlockingNeutralDestroyed(const Neutral * pBlocking)
 {
 	bwem_assert(pBlocking && pBlocking->Blocking());
 
+	vector<const ChokePoint *> UnblockedCPs;
 	for (const Area * pArea : pBlocking->BlockedAreas())
 		for (const ChokePoint * cp : pArea->ChokePoints())
+		{
+			const bool blocked = cp->Blocked();
 			const_cast<ChokePoint *>(cp)->OnBlockingNeutralDestroyed(pBlocking);
+			if (blocked && !cp->Blocked() && !contains(UnblockedCPs, cp)) UnblockedCPs.push_back(cp);
+		}
 
 	if (GetTile(pBlocking->TopLeft()).GetNeutral()) return;		// there remains some blocking Neutrals at the same location
 
 	// Unblock the miniTiles of pBlocking:
 	Area::id newId = pBlocking->BlockedAreas().front()->Id();
+	vector<WalkPosition> ChangedMiniTiles;
 	for (int dy = 0 ; dy < WalkPosition(pBlocking->Size()).y ; ++dy)
 	for (int dx = 0 ; dx < WalkPosition(pBlocking->Size()).x ; ++dx)
 	{
-		auto & miniTile = GetMiniTile_(WalkPosition(pBlocking->TopLeft()) + WalkPosition(dx, dy));
-		if (miniTile.Walkable()) miniTile.ReplaceBlockedAreaId(newId);
+		const WalkPosition w = WalkPosition(pBlocking->TopLeft()) + WalkPosition(dx, dy);
+		auto & miniTile = GetMiniTile_(w);
+		if (miniTile.Walkable())
+		{
+			miniTile.ReplaceBlockedAreaId(newId);
+			ChangedMiniTiles.push_back(w);
+		}
 	}
 
 	// Unblock the Tiles of pBlocking:
+	vector<TilePosition> ChangedTiles;
 	for (int dy = 0 ; dy < pBlocking->Size().y ; ++dy)
 	for (int dx = 0 ; dx < pBlocking->Size().x ; ++dx)
 	{
 		GetTile_(pBlocking->TopLeft() + TilePosition(dx, dy)).ResetAreaId();
 		SetAreaIdInTile(pBlocking->TopLeft() + TilePosition(dx, dy));
+		ChangedTiles.push_back(pBlocking->TopLeft() + TilePosition(dx, dy));
 	}
 
+	GetGraph().UpdateNearestAreas(ChangedMiniTiles, ChangedTiles);
+
 	if (AutomaticPathUpdate())
-		GetGraph().ComputeChokePointDistanceMatrix();
+		UpdatePaths(pBlocking, UnblockedCPs);
+}
+
+
+// Updates the paths between the ChokePoints after the destruction of pBlocking.
+// Two engines are available (Cf. BWEM_INCREMENTAL_PATH_UPDATE and BWEM_CHECK_INCREMENTAL_PATH_UPDATE in defs.h).
+void MapImpl::UpdatePaths(const Neutral * pBlocking, const vector<const ChokePoint *> & UnblockedCPs)
+{
+#if BWEM_INCREMENTAL_PATH_UPDATE || BWEM_CHECK_INCREMENTAL_PATH_UPDATE
+	// Only the Areas around pBlocking can walk through its former Tiles:
+	vector<const Area *> ModifiedAreas = pBlocking->BlockedAreas();
+	for (int dy = -1 ; dy <= pBlocking->Size().y ; ++dy)
+	for (int dx = -1 ; dx <= pBlocking->Size().x ; ++dx)
+	{
+		const TilePosition t = pBlocking->TopLeft() + TilePosition(dx, dy);
+		if (Valid(t))
+			if (const Area * pArea = GetArea(t))
+				if (!contains(ModifiedAreas, pArea)) ModifiedAreas.push_back(pArea);
+	}
+
+	GetGraph().UpdateChokePointDistanceMatrix(UnblockedCPs, ModifiedAreas);
+#endif
+
+#if BWEM_CHECK_INCREMENTAL_PATH_UPDATE
+
+	vector<vector<int>> IncrementalDistances;
+	for (const ChokePoint * cpA : GetGraph().ChokePoints())
+	{
+		IncrementalDistances.emplace_back();
+		for (const ChokePoint * cpB : GetGraph().ChokePoints())
+			IncrementalDistances.back().push_back(GetGraph().Distance(cpA, cpB));
+	}
+
+	GetGraph().ComputeChokePointDistanceMatrix();
+
+	int mismatches = 0;
+	for (const ChokePoint * cpA : GetGraph().ChokePoints())
+		for (const ChokePoint * cpB : GetGraph().ChokePoints())
+			if (IncrementalDistances[cpA->Index()][cpB->Index()] != GetGraph().Distance(cpA, cpB))
+				++mismatches;
+
+	if (mismatches)
+		bw << "Map::UpdatePaths: " << mismatches << " distance mismatches between the incremental update and the full recomputation" << endl;
+
+#elif !BWEM_INCREMENTAL_PATH_UPDATE
+
+	utils::unused(pBlocking);
+	utils::unused(UnblockedCPs);
+	GetGraph().ComputeChokePointDistanceMatrix();
+
+#endif
+}
+
+
+// Identifies the Map by its terrain (as computed by LoadData), its starting Locations and its static neutral units.
+uint64_t MapImpl::ComputeFingerprint() const
+{
+	Fingerprint fingerprint;
+
+	fingerprint.Add(Size());
+	for (const TilePosition & t : StartingLocations())
+		fingerprint.Add(t);
+
+	fingerprint.Add(MiniTiles().data(), MiniTiles().size() * sizeof(MiniTile));
+
+	vector<uint8_t> TileBits;
+	TileBits.reserve(Tiles().size());
+	for (const Tile & tile : Tiles())
+		TileBits.push_back(uint8_t(tile.Buildable() | (tile.GroundHeight() << 1) | (tile.Doodad() << 3)));
+	fingerprint.Add(TileBits.data(), TileBits.size());
+
+	// The static neutral units are sorted, so that the fingerprint does not depend on the order BWAPI provides them.
+	vector<array<int, 4>> Neutrals;
+	for (auto n : bw->getStaticNeutralUnits())
+		Neutrals.push_back({{n->getType().getID(), n->getInitialTilePosition().x, n->getInitialTilePosition().y, n->getInitialResources()}});
+
+	sort(Neutrals.begin(), Neutrals.end());
+	for (const auto & n : Neutrals)
+		fingerprint.Add(n);
+
+	return fingerprint.Value();
+}
+
+
+// Returns all the Neutrals, in an order that only depends on the Map:
+// the Tiles are scanned row by row, and the stacked Neutrals are taken from the bottom one.
+vector<Neutral *> MapImpl::NeutralsInCacheOrder() const
+{
+	vector<Neutral *> Neutrals;
+
+	for (int y = 0 ; y < Size().y ; ++y)
+	for (int x = 0 ; x < Size().x ; ++x)
+	{
+		const TilePosition t(x, y);
+		for (Neutral * pNeutral = GetTile(t, check_t::no_check).GetNeutral() ; pNeutral ; pNeutral = pNeutral->NextStacked())
+			if (pNeutral->TopLeft() == t)
+				Neutrals.push_back(pNeutral);
+	}
+
+	bwem_assert(Neutrals.size() == Minerals().size() + Geysers().size() + StaticBuildings().size());
+	return Neutrals;
+}
+
+
+// Replaces the whole analysis that follows LoadData in Initialize.
+// Only the Neutrals are recreated (they wrap BWAPI::Units), then everything else is restored from reader.
+void MapImpl::LoadFromCache(CacheReader & reader)
+{
+	InitializeNeutrals();
+	const vector<Neutral *> Neutrals = NeutralsInCacheOrder();
+
+	// 1) MiniTiles and Tiles
+	m_maxAltitude = reader.Read<altitude_t>();
+	reader.ReadArray(m_MiniTiles.data(), m_MiniTiles.size());
+
+	vector<Area::id> TileAreaIds(m_Tiles.size());
+	vector<altitude_t> TileMinAltitudes(m_Tiles.size());
+	reader.ReadArray(TileAreaIds.data(), TileAreaIds.size());
+	reader.ReadArray(TileMinAltitudes.data(), TileMinAltitudes.size());
+	for (size_t i = 0 ; i < m_Tiles.size() ; ++i)
+	{
+		checkCacheData(TileMinAltitudes[i] >= 0);
+		if (TileAreaIds[i]) m_Tiles[i].SetAreaId(TileAreaIds[i]);
+		m_Tiles[i].SetMinAltitude(TileMinAltitudes[i]);
+	}
+
+	// 2) Raw frontier
+	m_RawFrontier.resize(reader.Read<uint32_t>());
+	for (auto & f : m_RawFrontier)
+	{
+		f.first.first = reader.Read<Area::id>();
+		f.first.second = reader.Read<Area::id>();
+		f.second = reader.Read<WalkPosition>();
+	}
+
+	// 3) Areas, ChokePoints, paths and Bases
+	GetGraph().LoadFromCache(reader, Neutrals);
+
+	// 4) Blocking Neutrals (done last, so that any failure above leaves no blocking Neutral referring to missing Areas)
+	for (uint32_t n = reader.Read<uint32_t>() ; n ; --n)
+	{
+		const uint32_t index = reader.Read<uint32_t>();
+		checkCacheData(index < Neutrals.size());
+
+		vector<WalkPosition> BlockedAreasPositions;
+		reader.ReadVector(BlockedAreasPositions);
+		checkCacheData(!BlockedAreasPositions.empty() && !Neutrals[index]->Blocking());
+		for (WalkPosition w : BlockedAreasPositions)
+			checkCacheData(Valid(w) && GetArea(w));
+
+		Neutrals[index]->SetBlocking(BlockedAreasPositions);
+	}
+}
+
+
+// Saves the result of the analysis into the write directory (Cf. LoadFromCache and Map::EnableAnalysisCache).
+// The file is first written under a temporary name, so that a partially written file is never used.
+// Failures are silently ignored, as the cache is only an optimization.
+void MapImpl::SaveToCache(uint64_t fingerprint) const
+{
+	const vector<Neutral *> Neutrals = NeutralsInCacheOrder();
+
+	CacheWriter writer;
+
+	// 1) MiniTiles and Tiles
+	writer.Write(m_maxAltitude);
+	writer.WriteArray(m_MiniTiles.data(), m_MiniTiles.size());
+
+	vector<Area::id> TileAreaIds;
+	vector<altitude_t> TileMinAltitudes;
+	for (const Tile & tile : m_Tiles)
+	{
+		TileAreaIds.push_back(tile.AreaId());
+		TileMinAltitudes.push_back(tile.MinAltitude());
+	}
+	writer.WriteArray(TileAreaIds.data(), TileAreaIds.size());
+	writer.WriteArray(TileMinAltitudes.data(), TileMinAltitudes.size());
+
+	// 2) Raw frontier
+	writer.Write(uint32_t(m_RawFrontier.size()));
+	for (const auto & f : m_RawFrontier)
+	{
+		writer.Write(f.first.first);
+		writer.Write(f.first.second);
+		writer.Write(f.second);
+	}
+
+	// 3) Areas, ChokePoints, paths and Bases
+	GetGraph().SaveToCache(writer, Neutrals);
+
+	// 4) Blocking Neutrals
+	writer.Write(uint32_t(count_if(Neutrals.begin(), Neutrals.end(), [](const Neutral * n){ return n->Blocking(); })));
+	for (uint32_t index = 0 ; index < Neutrals.size() ; ++index)
+		if (Neutrals[index]->Blocking())
+		{
+			writer.Write(index);
+			writer.WriteVector(Neutrals[index]->BlockedAreasPositions());
+		}
+
+	const vector<char> & Payload = writer.Buffer();
+	Fingerprint checksum;
+	checksum.Add(Payload.data(), Payload.size());
+
+	const MapCacheHeader header = {map_cache_magic, map_cache_version, sizeof(MiniTile), sizeof(WalkPosition),
+									fingerprint, Payload.size(), checksum.Value()};
+
+	const string fileName = cacheFileName(m_cacheWriteDirectory, fingerprint);
+	const string tmpFileName = fileName + ".tmp";
+	{
+		ofstream out(tmpFileName, ios::binary | ios::trunc);
+		out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+		out.write(Payload.data(), Payload.size());
+		if (!out)
+		{
+			out.close();
+			remove(tmpFileName.c_str());
+			return;
+		}
+	}
+
+	remove(fileName.c_str());		// rename fails under Windows if the destination exists
+	if (rename(tmpFileName.c_str(), fileName.c_str()) != 0)
+		remove(tmpFileName.c_str());
 }
 
 
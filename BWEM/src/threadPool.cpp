@@ -0,0 +1,118 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This file is part of the BWEM Library.
+// BWEM is free software, licensed under the MIT/X11 License. 
+// A copy of the license is provided with the library in the LICENSE file.
+// Copyright (c) 2015, 2017, Igor Dimitrijevic
+//
+//////////////////////////////////////////////////////////////////////////
+
+
+#include "threadPool.h"
+
+
+using namespace std;
+
+
+namespace BWEM {
+namespace utils {
+
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                          //
+//                                  class ThreadPool
+//                                                                                          //
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+
+ThreadPool::ThreadPool(int threadCount)
+: m_next(0)
+{
+	for (int i = 1 ; i < threadCount ; ++i)
+		m_Workers.emplace_back([this](){ WorkerLoop(); });
+}
+
+
+ThreadPool::~ThreadPool()
+{
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_jobAvailable.notify_all();
+
+	for (thread & worker : m_Workers)
+		worker.join();
+}
+
+
+void ThreadPool::ParallelFor(int begin, int end, const function<void(int)> & f)
+{
+	{
+		lock_guard<mutex> lock(m_mutex);
+		bwem_assert(!m_pJob);
+		m_pJob = &f;
+		m_next = begin;
+		m_end = end;
+		m_exception = nullptr;
+		m_busyWorkers = (int)m_Workers.size();
+		++m_generation;
+	}
+	m_jobAvailable.notify_all();
+
+	RunCalls();
+
+	exception_ptr pException;
+	{
+		unique_lock<mutex> lock(m_mutex);
+		m_jobDone.wait(lock, [this](){ return m_busyWorkers == 0; });
+		m_pJob = nullptr;
+		pException = m_exception;
+	}
+
+	if (pException) rethrow_exception(pException);
+}
+
+
+void ThreadPool::WorkerLoop()
+{
+	int lastGeneration = 0;
+	for (;;)
+	{
+		{
+			unique_lock<mutex> lock(m_mutex);
+			m_jobAvailable.wait(lock, [this, lastGeneration](){ return m_stopping || (m_generation != lastGeneration); });
+			if (m_stopping) return;
+			lastGeneration = m_generation;
+		}
+
+		RunCalls();
+
+		{
+			lock_guard<mutex> lock(m_mutex);
+			--m_busyWorkers;
+		}
+		m_jobDone.notify_one();
+	}
+}
+
+
+// Grabs the remaining values of i one by one, until there are none left.
+void ThreadPool::RunCalls()
+{
+	for (int i = m_next++ ; i < m_end ; i = m_next++)
+		try
+		{
+			(*m_pJob)(i);
+		}
+		catch (...)
+		{
+			lock_guard<mutex> lock(m_mutex);
+			if (!m_exception) m_exception = current_exception();
+		}
+}
+
+
+
+}} // namespace BWEM::utils
@@ -11,6 +11,7 @@
 
 
 #include "utils.h"
+#include "threadPool.h"
 #include <assert.h>
 
 using namespace std;
@@ -65,5 +66,88 @@ bool intersect(int ax, int ay, int bx, int by, int cx, int cy, int dx, int dy)
 }
 
 
+// Integer division rounded down, as required by the separator of the Meijster algorithm.
+static int floorDiv(int a, int b)
+{
+	assert(b > 0);
+	return (a >= 0) ? a / b : -((-a + b - 1) / b);
+}
+
+
+void squaredDistanceTransform(vector<int> & Grid, int width, int height, ThreadPool * pPool)
+{
+	assert((int)Grid.size() == width * height);
+	const int infinity = width + height;
+
+	// 1) Distance to the nearest source in the same column.
+	//    The columns are processed by blocks. Inside a block, both passes process whole rows, so that the inner loops can be vectorized.
+	const int columns_per_block = 64;
+	parallelFor(pPool, 0, (width + columns_per_block - 1) / columns_per_block, [&Grid, width, height, infinity, columns_per_block](int block)
+	{
+		const int xBegin = block * columns_per_block;
+		const int xEnd = min(width, xBegin + columns_per_block);
+
+		for (int x = xBegin ; x < xEnd ; ++x)
+			Grid[x] = Grid[x] ? infinity : 0;
+
+		for (int y = 1 ; y < height ; ++y)
+		{
+			const int * prev = &Grid[(y-1)*width];
+			int * row = &Grid[y*width];
+			for (int x = xBegin ; x < xEnd ; ++x)
+				row[x] = row[x] ? prev[x] + 1 : 0;
+		}
+
+		for (int y = height-2 ; y >= 0 ; --y)
+		{
+			const int * next = &Grid[(y+1)*width];
+			int * row = &Grid[y*width];
+			for (int x = xBegin ; x < xEnd ; ++x)
+				row[x] = min(row[x], next[x] + 1);
+		}
+	});
+
+	// 2) For each row, lower envelope of the parabolas (x - i)^2 + g(i)^2, where g is the result of 1)
+	parallelFor(pPool, 0, height, [&Grid, width](int y)
+	{
+		vector<int> s(width), t(width), Result(width);
+		int * g = &Grid[y*width];
+		auto f = [g](int x, int i) { return (x-i)*(x-i) + g[i]*g[i]; };
+		auto sep = [g](int i, int u) { return floorDiv(u*u - i*i + g[u]*g[u] - g[i]*g[i], 2*(u-i)); };
+
+		int q = 0;
+		s[0] = t[0] = 0;
+		for (int u = 1 ; u < width ; ++u)
+		{
+			while ((q >= 0) && (f(t[q], s[q]) > f(t[q], u))) --q;
+
+			if (q < 0)
+			{
+				q = 0;
+				s[0] = u;
+			}
+			else
+			{
+				const int w = 1 + sep(s[q], u);
+				if (w < width)
+				{
+					++q;
+					s[q] = u;
+					t[q] = w;
+				}
+			}
+		}
+
+		for (int u = width-1 ; u >= 0 ; --u)
+		{
+			Result[u] = f(u, s[q]);
+			if (u == t[q]) --q;
+		}
+
+		copy(Result.begin(), Result.end(), g);
+	});
+}
+
+
 }} // namespace BWEM::utils
 
@@ -1,6 +1,8 @@
 #include "Base.h"
 
 #include "KBot.h"
+#include "Profiler.h"
+#include "Watchdog.h"
 #include "utils.h"
 #include <algorithm>
 #include <cmath>
@@ -10,34 +12,18 @@
 #include <type_traits>
 #include <vector>
 
-namespace {
-
-// A merged version of std::min_element and std::find_if.
-template <typename ForwardIt, typename UnaryPredicate, typename Compare>
-ForwardIt min_element_if(ForwardIt first, ForwardIt last, UnaryPredicate p, Compare comp) {
-    while (first != last && !p(*first))
-        ++first;
-    if (first == last)
-        return last;
-
-    ForwardIt smallest = first;
-    ++first;
-    for (; first != last; ++first) {
-        if (p(*first) && comp(*first, *smallest)) {
-            smallest = first;
-        }
-    }
-    return smallest;
-}
-
-} // namespace
-
 namespace KBot {
 
 using namespace BWAPI;
 
 Base::Base(Manager &manager, TilePosition position)
-    : m_manager(&manager), m_position(std::move(position)) {
+    : m_manager(&manager), m_position(std::move(position)),
+      m_timing(manager.periodic().add(PeriodicTasks::Kind::base)) {
+    auto &registry = m_manager->registry();
+    m_mineralWorkers =
+        registry.createGroup(UnitRegistry::Owner::base, UnitRegistry::Role::mineralWorker);
+    m_otherUnits = registry.createGroup(UnitRegistry::Owner::base, UnitRegistry::Role::other);
+
     const auto center =
         Position(m_position) + Position(UnitTypes::Terran_Command_Center.tileSize()) / 2;
     m_mineralPatches = Broodwar->getUnitsInRadius(
@@ -47,102 +33,113 @@ Base::Base(Manager &manager, TilePosition position)
         center, catchmentRadius,
         Filter::GetType == UnitTypes::Resource_Vespene_Geyser || Filter::IsRefinery);
     for (const auto &gas : gases)
-        m_gasesAndWorkers.emplace_back(gas, Unitset());
+        m_gasesAndWorkers.emplace_back(
+            gas, registry.createGroup(UnitRegistry::Owner::base, UnitRegistry::Role::gasWorker));
     // TODO: Handling of enemy refineries?
 }
 
 void Base::update() {
+    KBOT_PROFILE("Base::update");
+
+    const auto &snapshot = m_manager->snapshot();
+    auto &      registry = m_manager->registry();
+
     // Display debug information
-    const auto center =
-        Position(m_position) + Position(UnitTypes::Terran_Command_Center.tileSize()) / 2;
-    Broodwar->drawCircleMap(center, catchmentRadius, Colors::Green);
-    Broodwar->drawBoxMap(Position(m_position),
-                         Position(m_position + UnitTypes::Terran_Command_Center.tileSize()),
-                         Colors::Green);
-
-    // Show membership
-    for (const auto &worker : m_mineralWorkers) {
-        Broodwar->drawLineMap(center, worker->getPosition(), Colors::Cyan);
-    }
-    for (const auto &gasAndWorkers : m_gasesAndWorkers) {
-        for (const auto &worker : gasAndWorkers.second) {
-            Broodwar->drawLineMap(center, worker->getPosition(), Colors::Green);
+    if (Watchdog::instance().drawDebug()) {
+        const auto center =
+            Position(m_position) + Position(UnitTypes::Terran_Command_Center.tileSize()) / 2;
+        Broodwar->drawCircleMap(center, catchmentRadius, Colors::Green);
+        Broodwar->drawBoxMap(Position(m_position),
+                             Position(m_position + UnitTypes::Terran_Command_Center.tileSize()),
+                             Colors::Green);
+
+        // Show membership
+        for (const auto &worker : registry.members(m_mineralWorkers)) {
+            Broodwar->drawLineMap(center, snapshot.position(worker), Colors::Cyan);
+        }
+        for (const auto &gasAndWorkers : m_gasesAndWorkers) {
+            for (const auto &worker : registry.members(gasAndWorkers.second)) {
+                Broodwar->drawLineMap(center, snapshot.position(worker), Colors::Green);
+            }
+        }
+        for (const auto &unit : registry.members(m_otherUnits)) // buildings and unassigned workers
+            Broodwar->drawLineMap(center, snapshot.position(unit), Colors::Grey);
+
+        // Print resource information
+        Broodwar->drawTextMap(center, "Minerals: %d / %d",
+                              registry.members(m_mineralWorkers).size(), targetMineralWorkers());
+        Broodwar->drawTextMap(center + Position(0, 10), "Workers needed: %d", workersLeftToBuild());
+        for (const auto &gasAndWorkers : m_gasesAndWorkers) {
+            if (snapshot.gasAvailable(gasAndWorkers.first))
+                Broodwar->drawTextMap(snapshot.position(gasAndWorkers.first), "Gas: %d / %d",
+                                      registry.members(gasAndWorkers.second).size(),
+                                      (int) gasWorkerRatio);
+            else
+                Broodwar->drawTextMap(snapshot.position(gasAndWorkers.first), "Unavailable Gas");
         }
-    }
-    for (const auto &unit : m_otherUnits) // buildings and unassigned workers
-        Broodwar->drawLineMap(center, unit->getPosition(), Colors::Grey);
-
-    // Print resource information
-    Broodwar->drawTextMap(center, "Minerals: %d / %d", m_mineralWorkers.size(),
-                          targetMineralWorkers());
-    Broodwar->drawTextMap(center + Position(0, 10), "Workers needed: %d", workersLeftToBuild());
-    for (const auto &gasAndWorkers : m_gasesAndWorkers) {
-        if (gasAvailable(gasAndWorkers.first))
-            Broodwar->drawTextMap(gasAndWorkers.first->getPosition(), "Gas: %d / %d",
-                                  gasAndWorkers.second.size(), (int) gasWorkerRatio);
-        else
-            Broodwar->drawTextMap(gasAndWorkers.first->getPosition(), "Unavailable Gas");
     }
 
     // ----- Prevent spamming -----------------------------------------------
     // Everything below is executed only occasionally and not on every frame.
-    if (Broodwar->getFrameCount() % Broodwar->getLatencyFrames() != 0)
+    if (!m_manager->periodic().due(m_timing))
         return;
 
     // Move workers between groups. One at a time should be fine.
     {
-        const int minWorkers = m_mineralWorkers.size();
+        const int minWorkers = registry.members(m_mineralWorkers).size();
         const int targetMinW = targetMineralWorkers();
-        const int gasWorkers =
-            std::accumulate(m_gasesAndWorkers.begin(), m_gasesAndWorkers.end(), 0,
-                            [](int sum, const auto &p) { return sum + p.second.size(); });
+        const int gasWorkers = this->gasWorkers();
         const int targetGasW = targetGasWorkers();
 
-        const auto gasWithFewestWorkers = std::min_element(
-            m_gasesAndWorkers.begin(), m_gasesAndWorkers.end(),
-            [](const auto &p1, const auto &p2) { return p1.second.size() < p2.second.size(); });
-        const auto gasWithMostWorkers = std::max_element(
-            m_gasesAndWorkers.begin(), m_gasesAndWorkers.end(),
-            [](const auto &p1, const auto &p2) { return p1.second.size() < p2.second.size(); });
+        const auto fewerWorkers = [&registry](const auto &p1, const auto &p2) {
+            return registry.members(p1.second).size() < registry.members(p2.second).size();
+        };
+        const auto gasWithFewestWorkers =
+            std::min_element(m_gasesAndWorkers.begin(), m_gasesAndWorkers.end(), fewerWorkers);
+        const auto gasWithMostWorkers =
+            std::max_element(m_gasesAndWorkers.begin(), m_gasesAndWorkers.end(), fewerWorkers);
 
         // If minerals or gas are over-saturated, pull workers. Pull only workers that are ready to
         // accept orders. Just to make sure the "stop" command is considered.
+        const auto ready = [&snapshot](const Unit &unit) {
+            return snapshot.readyToAcceptOrders(unit);
+        };
         if (minWorkers > targetMinW) {
-            assert(!m_mineralWorkers.empty());
-            const auto pulled =
-                std::find_if(m_mineralWorkers.begin(), m_mineralWorkers.end(), readyToAcceptOrders);
-            if (pulled != m_mineralWorkers.end()) {
-                m_otherUnits.insert(*pulled);
-                (*pulled)->stop();
-                m_mineralWorkers.erase(pulled);
+            const auto &group = registry.members(m_mineralWorkers);
+            assert(!group.empty());
+            const auto pulled = std::find_if(group.begin(), group.end(), ready);
+            if (pulled != group.end()) {
+                const auto worker = *pulled;
+                registry.assign(worker, m_otherUnits);
+                worker->stop();
             }
         }
         if (gasWorkers > targetGasW) {
             assert(gasWithMostWorkers != m_gasesAndWorkers.end());
-            auto &     group = gasWithMostWorkers->second;
-            const auto pulled = std::find_if(group.begin(), group.end(), readyToAcceptOrders);
+            const auto &group = registry.members(gasWithMostWorkers->second);
+            const auto  pulled = std::find_if(group.begin(), group.end(), ready);
             if (pulled != group.end()) {
-                m_otherUnits.insert(*pulled);
-                (*pulled)->stop();
-                group.erase(pulled);
+                const auto worker = *pulled;
+                registry.assign(worker, m_otherUnits);
+                worker->stop();
             }
         }
 
         // If there is an unassigned worker, saturate minerals and gas.
-        const auto unassignedWorker =
-            std::find_if(m_otherUnits.begin(), m_otherUnits.end(), [](const Unit &unit) {
-                return unit->getType().isWorker() && unit->isIdle();
+        const auto &otherUnits = registry.members(m_otherUnits);
+        const auto  unassignedWorker =
+            std::find_if(otherUnits.begin(), otherUnits.end(), [&snapshot](const Unit &unit) {
+                return snapshot.type(unit).isWorker() && snapshot.isIdle(unit);
             });
 
-        if (unassignedWorker != m_otherUnits.end()) {
+        if (unassignedWorker != otherUnits.end()) {
+            const auto worker = *unassignedWorker;
             // Fill gas first
             if (gasWorkers < targetGasW) {
                 assert(gasWithFewestWorkers != m_gasesAndWorkers.end());
-                gasWithFewestWorkers->second.insert(*unassignedWorker);
-                m_otherUnits.erase(unassignedWorker);
+                registry.assign(worker, gasWithFewestWorkers->second, gasWithFewestWorkers->first);
             } else if (minWorkers < targetMinW) {
-                m_mineralWorkers.insert(*unassignedWorker);
-                m_otherUnits.erase(unassignedWorker);
+                registry.assign(worker, m_mineralWorkers);
             } else {
                 // TODO: Transfer unit to another base?
             }
@@ -153,74 +150,54 @@ void Base::update() {
     static std::default_random_engine generator;
     if (!m_mineralPatches.empty()) {
         std::uniform_int_distribution<int> dist(0, m_mineralPatches.size() - 1);
-        for (const auto &worker : m_mineralWorkers) {
-            if (worker->isIdle()) {
+        for (const auto &worker : registry.members(m_mineralWorkers)) {
+            if (snapshot.isIdle(worker)) {
                 const bool r =
                     worker->gather(*std::next(m_mineralPatches.begin(), dist(generator)));
                 assert(r);
+                (void) r; // only checked by the assert
             }
         }
     }
 
     for (const auto &gasAndWorkers : m_gasesAndWorkers) {
-        if (gasAvailable(gasAndWorkers.first)) {
-            for (const auto &worker : gasAndWorkers.second) {
-                if (worker->isIdle()) {
-                    const bool r = worker->gather(gasAndWorkers.first);
+        if (snapshot.gasAvailable(gasAndWorkers.first)) {
+            for (const auto &worker : registry.members(gasAndWorkers.second)) {
+                if (snapshot.isIdle(worker)) {
+                    // The refinery the worker has been assigned to, see update().
+                    const bool r = worker->gather(registry.assignment(worker));
                     assert(r);
+                    (void) r; // only checked by the assert
                 }
             }
         }
     }
 }
 
-void Base::giveOwnership(const Unit &unit) { m_otherUnits.insert(unit); }
-
-void Base::takeOwnership(const Unit &unit) {
-    m_mineralWorkers.erase(unit);
-
-    for (auto &gasAndWorkers : m_gasesAndWorkers)
-        gasAndWorkers.second.erase(unit);
-
-    m_otherUnits.erase(unit);
-}
-
-Unit Base::findWorker(const UnitType &workerType, const Position &nearPosition) const {
-    auto pred = [&workerType](const Unit &u) { return u->getType() == workerType; };
-    auto comp = [&nearPosition](const Unit &a, const Unit &b) {
-        return distance(nearPosition, a->getPosition()) < distance(nearPosition, b->getPosition());
-    };
-
-    // Prefer "other units" over mineral workers over gas workers.
-    std::vector<const Unitset *> unitsets = {&m_otherUnits, &m_mineralWorkers};
-    for (const auto &gasAndWorkers : m_gasesAndWorkers)
-        unitsets.push_back(&gasAndWorkers.second);
-
-    for (const auto &set : unitsets) {
-        const auto worker = min_element_if(set->begin(), set->end(), pred, comp);
-        if (worker != set->end())
-            return *worker;
-    }
-
-    // No worker found.
-    return nullptr;
-}
+void Base::giveOwnership(const Unit &unit) { m_manager->registry().assign(unit, m_otherUnits); }
 
 int Base::targetMineralWorkers() const {
     return (int) std::ceil(mineralWorkerRatio * m_mineralPatches.size());
 }
 
 int Base::targetGasWorkers() const {
-    const auto refineries = std::count_if(m_gasesAndWorkers.begin(), m_gasesAndWorkers.end(),
-                                          [&](const auto &gas) { return gasAvailable(gas.first); });
+    const auto &snapshot = m_manager->snapshot();
+    const auto  refineries =
+        std::count_if(m_gasesAndWorkers.begin(), m_gasesAndWorkers.end(),
+                      [&](const auto &gas) { return snapshot.gasAvailable(gas.first); });
     return (int) std::ceil(gasWorkerRatio * refineries);
 }
 
 int Base::workersLeftToBuild() const {
-    const auto gasWorkers =
-        std::accumulate(m_gasesAndWorkers.begin(), m_gasesAndWorkers.end(), 0,
-                        [](int sum, const auto &p) { return sum + p.second.size(); });
-    return targetMineralWorkers() - m_mineralWorkers.size() + targetGasWorkers() - gasWorkers;
+    const int mineralWorkers = m_manager->registry().members(m_mineralWorkers).size();
+    return targetMineralWorkers() - mineralWorkers + targetGasWorkers() - gasWorkers();
+}
+
+int Base::gasWorkers() const {
+    const auto &registry = m_manager->registry();
+    return std::accumulate(
+        m_gasesAndWorkers.begin(), m_gasesAndWorkers.end(), 0,
+        [&registry](int sum, const auto &p) { return sum + registry.members(p.second).size(); });
 }
 
 } // namespace
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "PeriodicTasks.h"
+#include "UnitRegistry.h"
 #include <BWAPI.h>
 #include <vector>
 
@@ -20,17 +22,10 @@ public:
 
     const BWAPI::TilePosition &getPosition() const { return m_position; }
 
-    // Transfer ownership of a unit to base.
+    // Transfer ownership of a unit to base. Taking ownership from base is done by assigning the
+    // unit to another group of the UnitRegistry (or releasing it).
     void giveOwnership(const BWAPI::Unit &unit);
 
-    // Take ownership of a unit from base (forcibly).
-    void takeOwnership(const BWAPI::Unit &unit);
-
-    // Returns the closest matching unit in this base or nullptr, if none has been found. This
-    // method does not transfer the unit's ownership so takeOwnership() has to be called explicitly.
-    BWAPI::Unit findWorker(const BWAPI::UnitType &workerType,
-                           const BWAPI::Position &nearPosition) const;
-
 private:
     // Returns the total amount of workers this base should have to mine minerals.
     int targetMineralWorkers() const;
@@ -42,15 +37,19 @@ private:
     // DEBUG only?
     int workersLeftToBuild() const;
 
-    Manager *           m_manager;
-    BWAPI::TilePosition m_position;
+    // Returns the total amount of workers assigned to gas.
+    int gasWorkers() const;
+
+    Manager *             m_manager;
+    BWAPI::TilePosition   m_position;
+    PeriodicTasks::Timing m_timing;
 
-    // Units owned by this base.
-    BWAPI::Unitset m_mineralPatches;
-    BWAPI::Unitset m_mineralWorkers;
-    std::vector<std::pair<BWAPI::Unit, BWAPI::Unitset>>
-                   m_gasesAndWorkers; // refineries and assigned workers
-    BWAPI::Unitset m_otherUnits;      // buildings and unassigned workers
+    // Units owned by this base. The workers and other units are groups of the UnitRegistry.
+    BWAPI::Unitset      m_mineralPatches;
+    UnitRegistry::Group m_mineralWorkers;
+    std::vector<std::pair<BWAPI::Unit, UnitRegistry::Group>>
+                        m_gasesAndWorkers; // refineries and assigned workers
+    UnitRegistry::Group m_otherUnits;      // buildings and unassigned workers
 };
 
 } // namespace
@@ -1,6 +1,8 @@
 #include "BuildTask.h"
 
 #include "Manager.h"
+#include "Profiler.h"
+#include "Watchdog.h"
 #include <cassert>
 #include <stdexcept>
 #include <type_traits>
@@ -12,12 +14,15 @@ using namespace BWAPI;
 BuildTask::BuildTask(Manager &manager, UnitType toBuild, Priority priority, TilePosition position,
                      bool exactPosition)
     : m_manager(&manager), m_toBuild(std::move(toBuild)), m_priority(priority),
-      m_position(std::move(position)), m_exactPosition(exactPosition) {}
+      m_position(std::move(position)), m_exactPosition(exactPosition),
+      m_timing(manager.periodic().add(PeriodicTasks::Kind::buildTask)) {}
 
 void BuildTask::update() {
+    KBOT_PROFILE("BuildTask::update");
+
     // ----- Prevent spamming -----------------------------------------------
     // Everything below is executed only occasionally and not on every frame.
-    if (Broodwar->getFrameCount() % Broodwar->getLatencyFrames() != 0)
+    if (!m_manager->periodic().due(m_timing))
         return;
 
     switch (m_state) {
@@ -32,6 +37,7 @@ void BuildTask::update() {
     case State::acquireWorker:
         m_worker = m_manager->acquireWorker(m_toBuild.whatBuilds().first, Position(m_position));
         if (m_worker != nullptr) {
+            m_manager->watchUnit(m_worker, *this);
             // Go to next state
             if (m_toBuild.isBuilding())
                 m_state = State::moveToPosition;
@@ -41,8 +47,11 @@ void BuildTask::update() {
         break;
     case State::moveToPosition: {
         if (!m_allocatedBuildPosition) {
-            m_buildPosition =
-                m_exactPosition ? m_position : Broodwar->getBuildLocation(m_toBuild, m_position);
+            auto &placer = m_manager->placer();
+            m_buildPosition = m_exactPosition ? m_position : placer.find(m_toBuild, m_position);
+            if (!m_buildPosition.isValid())
+                break; // no location, try again later
+            placer.reserve(m_toBuild, m_buildPosition);
             m_allocatedBuildPosition = true;
         }
         assert(m_worker != nullptr);
@@ -50,12 +59,13 @@ void BuildTask::update() {
             Position(m_buildPosition) + Position(m_toBuild.tileSize()) / 2;
 
         // DEBUG
-        Broodwar->registerEvent([worker = m_worker, movePosition](Game *) {
-            Broodwar->drawLineMap(worker->getPosition(), movePosition, Colors::Purple);
-            Broodwar->drawTextMap(worker->getPosition(), "Distance: %d",
-                                  worker->getDistance(movePosition));
-        },
-                                nullptr, Broodwar->getLatencyFrames());
+        if (Watchdog::instance().drawDebug())
+            Broodwar->registerEvent([worker = m_worker, movePosition](Game *) {
+                Broodwar->drawLineMap(worker->getPosition(), movePosition, Colors::Purple);
+                Broodwar->drawTextMap(worker->getPosition(), "Distance: %d",
+                                      worker->getDistance(movePosition));
+            },
+                                    nullptr, m_timing.period);
 
         if (m_worker->getOrder() != Orders::Move ||
             m_worker->getOrderTargetPosition() != movePosition)
@@ -68,30 +78,28 @@ void BuildTask::update() {
         if (m_toBuild.isBuilding()) {
             // Construct building
             if (Broodwar->canBuildHere(m_buildPosition, m_toBuild, m_worker)) {
-                if (m_worker->build(m_toBuild, m_buildPosition))
+                if (m_worker->build(m_toBuild, m_buildPosition)) {
+                    m_manager->awaitUnit(m_toBuild, *this);
+                    m_manager->periodic().remove(m_timing);
                     m_state = State::waitForUnit; // go to next state
+                }
             } else {
+                m_manager->placer().release(m_toBuild, m_buildPosition);
                 m_allocatedBuildPosition = false;
                 m_state = State::moveToPosition; // go back and try again
             }
         } else {
             // Train unit
-            if (m_worker->train(m_toBuild))
+            if (m_worker->train(m_toBuild)) {
+                m_manager->awaitUnit(m_toBuild, *this);
+                m_manager->periodic().remove(m_timing);
                 m_state = State::waitForUnit; // go to next state
+            }
         }
         break;
     case State::waitForUnit:
-        if (m_buildingUnit != nullptr) {
-            m_manager->releaseResources(m_toBuild.mineralPrice(), m_toBuild.gasPrice());
-            m_state = State::building; // go to next state
-        }
-        break;
     case State::building:
-        assert(m_buildingUnit != nullptr);
-        if (m_buildingUnit->isCompleted()) {
-            m_manager->releaseWorker(m_worker);
-            m_state = State::finalize; // go to next state
-        }
+        // Parked. See onUnitCreatedOrMorphed() and onUnitCompleted().
         break;
     case State::finalize:
         // At this state, this build task can be removed from the queue.
@@ -109,12 +117,31 @@ bool BuildTask::onUnitCreatedOrMorphed(const Unit &unit) {
     // Make sure we don't already have a unit and it's the right type.
     if (m_buildingUnit == nullptr && unit->getType() == m_toBuild) {
         m_buildingUnit = unit;
+        m_manager->watchUnit(m_buildingUnit, *this);
+        if (m_allocatedBuildPosition) {
+            // The building occupies its location now.
+            m_manager->placer().release(m_toBuild, m_buildPosition);
+            m_allocatedBuildPosition = false;
+        }
+        m_manager->releaseResources(m_toBuild.mineralPrice(), m_toBuild.gasPrice());
+        m_state = State::building; // go to next state
         return true;
     }
 
     return false;
 }
 
+bool BuildTask::onUnitCompleted(const Unit &unit) {
+    if (m_state != State::building || unit != m_buildingUnit)
+        return false;
+
+    m_manager->unwatchUnit(m_buildingUnit);
+    m_manager->unwatchUnit(m_worker);
+    m_manager->releaseWorker(m_worker);
+    m_state = State::finalize; // go to next state
+    return true;
+}
+
 bool BuildTask::onUnitDestroyed(const Unit &unit) {
     if (unit == m_worker) {
         // FIXME!
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "PeriodicTasks.h"
 #include <BWAPI.h>
 #include <string>
 
@@ -31,11 +32,16 @@ public:
               BWAPI::TilePosition position = BWAPI::Broodwar->self()->getStartLocation(),
               bool                exactPosition = false);
 
-    // Called every KBot::onFrame().
+    // Called every KBot::onFrame(), unless the task is parked.
     void update();
 
+    // Event handlers, called by the manager for the units the task awaits or watches.
     bool onUnitCreatedOrMorphed(const BWAPI::Unit &unit);
     bool onUnitDestroyed(const BWAPI::Unit &unit);
+    bool onUnitCompleted(const BWAPI::Unit &unit);
+
+    // Returns whether the task waits for an event and does not need to be updated.
+    bool isParked() const { return m_state == State::waitForUnit || m_state == State::building; }
 
     State       getState() const { return m_state; }
     Priority    getPriority() const { return m_priority; }
@@ -48,6 +54,9 @@ private:
     BWAPI::TilePosition m_position;
     bool                m_exactPosition;
 
+    // Registered until the task is parked. Copies of the task share it.
+    PeriodicTasks::Timing m_timing;
+
     State               m_state = State::initialize;
     BWAPI::Unit         m_worker = nullptr;
     bool                m_allocatedBuildPosition = false;
@@ -0,0 +1,208 @@
+#include "BuildingPlacer.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace KBot {
+
+using namespace BWAPI;
+
+void BuildingPlacer::reset(const BWEM::Map &map) {
+    m_map = &map;
+    m_width = map.Size().x;
+    m_height = map.Size().y;
+    for (auto grid : {&m_buildable, &m_occupied, &m_mining, &m_depots})
+        grid->reset(m_width, m_height);
+    m_reserved.assign(std::size_t(m_width) * m_height, 0);
+    m_footprints.clear();
+
+    for (int y = 0; y < m_height; ++y)
+        for (int x = 0; x < m_width; ++x)
+            m_buildable.set(x, y, map.GetTile(TilePosition(x, y)).Buildable());
+
+    // Keep the depot locations and the mining paths of all bases free, except for resource depots.
+    const auto depotSize = UnitTypes::Terran_Command_Center.tileSize();
+    for (const auto &area : map.Areas()) {
+        for (const auto &base : area.Bases()) {
+            const auto depot = base.Location();
+            fill(m_mining, depot, depotSize, true);
+            fill(m_depots, depot, depotSize, true);
+
+            const auto keepFree = [&](const BWEM::Ressource *ressource) {
+                const auto topLeft = TilePosition(std::min(depot.x, ressource->TopLeft().x),
+                                                  std::min(depot.y, ressource->TopLeft().y));
+                const auto bottomRight = TilePosition(
+                    std::max(depot.x + depotSize.x, ressource->TopLeft().x + ressource->Size().x),
+                    std::max(depot.y + depotSize.y, ressource->TopLeft().y + ressource->Size().y));
+                fill(m_mining, topLeft, bottomRight - topLeft, true);
+            };
+            for (const auto &mineral : base.Minerals())
+                keepFree(mineral);
+            for (const auto &geyser : base.Geysers())
+                keepFree(geyser);
+        }
+    }
+
+    // The neutrals are known to BWEM, even if they are not visible.
+    const auto occupy = [this](const BWEM::Neutral *neutral) {
+        fill(m_occupied, neutral->TopLeft(), neutral->Size(), true);
+        m_footprints[neutral->Unit()] = {neutral->TopLeft(), neutral->Type()};
+    };
+    for (const auto &mineral : map.Minerals())
+        occupy(mineral.get());
+    for (const auto &geyser : map.Geysers())
+        occupy(geyser.get());
+    for (const auto &building : map.StaticBuildings())
+        occupy(building.get());
+
+    for (const auto &unit : Broodwar->getAllUnits())
+        add(unit);
+}
+
+void BuildingPlacer::add(Unit unit) {
+    const auto type = unit->getType();
+    if (m_map == nullptr || !(type.isBuilding() || type.isResourceContainer()) || unit->isFlying())
+        return;
+
+    const auto position = unit->getTilePosition();
+    if (!position.isValid())
+        return;
+
+    remove(unit);
+    fill(m_occupied, position, type.tileSize(), true);
+    m_footprints[unit] = {position, type};
+}
+
+void BuildingPlacer::remove(Unit unit) {
+    const auto it = m_footprints.find(unit);
+    if (it == m_footprints.end())
+        return;
+
+    fill(m_occupied, it->second.first, it->second.second.tileSize(), false);
+    m_footprints.erase(it);
+}
+
+bool BuildingPlacer::canPlace(UnitType type, TilePosition position) const {
+    const auto size = footprint(type);
+    if (m_map == nullptr || position.x < 0 || position.y < 0 || position.x + size.x > m_width ||
+        position.y + size.y > m_height)
+        return false;
+
+    update();
+    const auto &blocked = type.isResourceDepot() ? m_blockedForDepots : m_blocked;
+    return blocked.Sum(position.x, position.y, size.x, size.y) == 0;
+}
+
+TilePosition BuildingPlacer::find(UnitType type, TilePosition desired, int maxRange) const {
+    if (m_map == nullptr || !m_map->Valid(desired))
+        return TilePositions::Invalid;
+
+    const auto squaredDistance = [&desired](const TilePosition &position) {
+        const auto d = position - desired;
+        return d.x * d.x + d.y * d.y;
+    };
+
+    // Refineries can only be built on vespene geysers.
+    if (type.isRefinery()) {
+        auto best = TilePositions::Invalid;
+        int  bestDistance = maxRange * maxRange + 1;
+        for (const auto &geyser : m_map->Geysers()) {
+            const auto position = geyser->TopLeft();
+            if (geyser->Unit()->getType() != UnitTypes::Resource_Vespene_Geyser ||
+                reserved(position.x, position.y))
+                continue;
+            if (squaredDistance(position) < bestDistance) {
+                best = position;
+                bestDistance = squaredDistance(position);
+            }
+        }
+        return best;
+    }
+
+    // Visit the rings of tiles around desired. Within the first ring that contains a location, the
+    // closest one wins.
+    const auto area = m_map->GetNearestArea(desired);
+    for (int r = 0; r <= maxRange; ++r) {
+        auto best = TilePositions::Invalid;
+        int  bestDistance = std::numeric_limits<int>::max();
+        const auto visit = [&](int dx, int dy) {
+            const auto position = desired + TilePosition(dx, dy);
+            if (squaredDistance(position) < bestDistance && canPlace(type, position) &&
+                m_map->GetNearestArea(position)->AccessibleFrom(area)) {
+                best = position;
+                bestDistance = squaredDistance(position);
+            }
+        };
+
+        for (int dx = -r; dx <= r; ++dx) {
+            visit(dx, -r);
+            if (r > 0)
+                visit(dx, r);
+        }
+        for (int dy = -r + 1; dy <= r - 1; ++dy) {
+            visit(-r, dy);
+            visit(r, dy);
+        }
+
+        if (best.isValid())
+            return best;
+    }
+    return TilePositions::Invalid;
+}
+
+void BuildingPlacer::reserve(UnitType type, TilePosition position) {
+    count(position, footprint(type), 1);
+}
+
+void BuildingPlacer::release(UnitType type, TilePosition position) {
+    count(position, footprint(type), -1);
+}
+
+TilePosition BuildingPlacer::footprint(UnitType type) {
+    // Addons are placed at the bottom right of the building.
+    return type.tileSize() + (type.canBuildAddon() ? TilePosition(2, 0) : TilePosition(0, 0));
+}
+
+void BuildingPlacer::fill(BitGrid &grid, TilePosition position, TilePosition size, bool value) {
+    const int x1 = std::max(position.x, 0);
+    const int y1 = std::max(position.y, 0);
+    const int x2 = std::min(position.x + size.x, m_width);
+    const int y2 = std::min(position.y + size.y, m_height);
+    for (int y = y1; y < y2; ++y)
+        for (int x = x1; x < x2; ++x)
+            grid.set(x, y, value);
+    m_dirty = true;
+}
+
+void BuildingPlacer::count(TilePosition position, TilePosition size, int delta) {
+    const int x1 = std::max(position.x, 0);
+    const int y1 = std::max(position.y, 0);
+    const int x2 = std::min(position.x + size.x, m_width);
+    const int y2 = std::min(position.y + size.y, m_height);
+    for (int y = y1; y < y2; ++y)
+        for (int x = x1; x < x2; ++x) {
+            auto &reservations = m_reserved[std::size_t(y) * m_width + x];
+            reservations = std::max(reservations + delta, 0);
+        }
+    m_dirty = true;
+}
+
+void BuildingPlacer::update() const {
+    if (!m_dirty)
+        return;
+
+    m_blocked.Build(0, 0, m_width, m_height, [this](int x, int y) {
+        const bool blocked = !m_buildable.get(x, y) || m_occupied.get(x, y) ||
+                             m_mining.get(x, y) || reserved(x, y);
+        return blocked ? 1 : 0;
+    });
+    // The depot locations themselves overlap the mining paths of their bases.
+    m_blockedForDepots.Build(0, 0, m_width, m_height, [this](int x, int y) {
+        const bool blocked = !m_buildable.get(x, y) || m_occupied.get(x, y) ||
+                             (m_mining.get(x, y) && !m_depots.get(x, y)) || reserved(x, y);
+        return blocked ? 1 : 0;
+    });
+    m_dirty = false;
+}
+
+} // namespace
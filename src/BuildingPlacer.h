@@ -0,0 +1,101 @@
+#pragma once
+
+#include <BWAPI.h>
+#include <BWEM/bwem.h>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace KBot {
+
+// Finds building locations on the tile grid of BWEM, replacing BWAPI::Game::getBuildLocation().
+//
+// A tile is free if it is buildable (BWEM::Tile::Buildable()), not occupied by a building or a
+// resource, not on the mining paths or the depot location of a BWEM::Base, and not reserved by a
+// build task, with one exception: resource depots may cover the depot locations. The blocked
+// tiles are summed in integral images, one for the resource depots and one for the other
+// buildings, which are rebuilt lazily after changes, so that checking the footprint of a building
+// at some location is O(1).
+class BuildingPlacer {
+public:
+    // (Re)builds the grids. The map must be initialized.
+    void reset(const BWEM::Map &map);
+
+    // Tracks the footprints of buildings and resources (onUnitShow, onUnitCreate, onUnitMorph).
+    // Other units are ignored.
+    void add(BWAPI::Unit unit);
+
+    // Frees the footprint of the unit, if it had one (onUnitDestroy).
+    void remove(BWAPI::Unit unit);
+
+    // Returns whether a building of type fits at position (top left tile). For the types that can
+    // build an addon, the addon space is included.
+    bool canPlace(BWAPI::UnitType type, BWAPI::TilePosition position) const;
+
+    // Returns the location (top left tile) closest to desired, within maxRange tiles, where a
+    // building of type fits and which is accessible from desired. For refineries, returns the
+    // closest free vespene geyser. Returns BWAPI::TilePositions::Invalid if there is none.
+    BWAPI::TilePosition find(BWAPI::UnitType type, BWAPI::TilePosition desired,
+                             int maxRange = 32) const;
+
+    // Reserves the footprint of a building of type at position for a build task, until released.
+    // Reservations may overlap: a tile stays reserved until all the reservations covering it are
+    // released.
+    void reserve(BWAPI::UnitType type, BWAPI::TilePosition position);
+    void release(BWAPI::UnitType type, BWAPI::TilePosition position);
+
+private:
+    // A grid of bits, one per tile, packed in rows of 64 bit words.
+    class BitGrid {
+    public:
+        void reset(int width, int height) {
+            m_words = (width + 63) / 64;
+            m_bits.assign(std::size_t(m_words) * height, 0);
+        }
+        bool get(int x, int y) const { return (m_bits[y * m_words + x / 64] >> (x % 64)) & 1; }
+        void set(int x, int y, bool value) {
+            const auto mask = std::uint64_t(1) << (x % 64);
+            auto &     word = m_bits[y * m_words + x / 64];
+            word = value ? word | mask : word & ~mask;
+        }
+
+    private:
+        int                        m_words = 0;
+        std::vector<std::uint64_t> m_bits;
+    };
+
+    // Footprint of a building of type, including the addon space.
+    static BWAPI::TilePosition footprint(BWAPI::UnitType type);
+
+    // Sets the bits of the rectangle [position, position + size), clipped to the map.
+    void fill(BitGrid &grid, BWAPI::TilePosition position, BWAPI::TilePosition size, bool value);
+
+    // Adds delta to the reservation counts of the rectangle [position, position + size), clipped to
+    // the map.
+    void count(BWAPI::TilePosition position, BWAPI::TilePosition size, int delta);
+
+    bool reserved(int x, int y) const { return m_reserved[std::size_t(y) * m_width + x] > 0; }
+
+    // Rebuilds the integral images of the blocked tiles, if the grids changed since.
+    void update() const;
+
+    const BWEM::Map *m_map = nullptr;
+    int              m_width = 0;
+    int              m_height = 0;
+
+    BitGrid m_buildable; // BWEM::Tile::Buildable()
+    BitGrid m_occupied;  // buildings and resources
+    BitGrid m_mining;    // between depot locations and their resources, and the depot locations
+    BitGrid m_depots;    // the depot locations
+
+    std::vector<int> m_reserved; // number of build tasks reserving each tile
+
+    std::unordered_map<BWAPI::Unit, std::pair<BWAPI::TilePosition, BWAPI::UnitType>> m_footprints;
+
+    mutable BWEM::utils::SummedAreaTable m_blocked;          // number of blocked tiles
+    mutable BWEM::utils::SummedAreaTable m_blockedForDepots; // same, for resource depots
+    mutable bool                         m_dirty = true;
+};
+
+} // namespace
@@ -0,0 +1,63 @@
+#include "DistanceOracle.h"
+
+#include "Profiler.h"
+#include <algorithm>
+
+namespace KBot {
+
+using namespace BWAPI;
+
+DistanceOracle &DistanceOracle::instance() {
+    static DistanceOracle oracle;
+    return oracle;
+}
+
+int DistanceOracle::distance(BWEM::Map &map, const Position &a, const Position &b) {
+    // Drop everything computed on another map or with outdated paths.
+    if (&map != m_map || map.PathsVersion() != m_pathsVersion) {
+        if (!m_distances.empty())
+            ++m_stats.invalidations;
+        m_distances.clear();
+        m_map = &map;
+        m_pathsVersion = map.PathsVersion();
+    }
+
+    // BWEM's distances are symmetric, so (a, b) and (b, a) share the same entry.
+    const auto walkA = WalkPosition(a).makeValid();
+    const auto walkB = WalkPosition(b).makeValid();
+    auto       keyA = (std::uint64_t(walkA.x) << 16) | std::uint64_t(walkA.y);
+    auto       keyB = (std::uint64_t(walkB.x) << 16) | std::uint64_t(walkB.y);
+    if (keyB < keyA)
+        std::swap(keyA, keyB);
+    const auto key = (keyA << 32) | keyB;
+
+    const auto it = m_distances.find(key);
+    if (it != m_distances.end()) {
+        ++m_stats.hits;
+        return it->second;
+    }
+    ++m_stats.misses;
+
+    if (m_distances.size() >= maxEntries) {
+        ++m_stats.invalidations;
+        m_distances.clear();
+    }
+
+    // Query both walk tile centers in the order of the key, so that the result does not depend on
+    // the order of a and b.
+    const auto center = [](std::uint64_t k) {
+        return Position(WalkPosition(int(k >> 16), int(k & 0xFFFF))) + Position(4, 4);
+    };
+    int length;
+    {
+        KBOT_PROFILE("BWEM::Map::GetPath");
+        map.GetPath(center(keyA), center(keyB), &length);
+    }
+
+    m_distances.emplace(key, length);
+    return length;
+}
+
+void DistanceOracle::clear() { m_distances.clear(); }
+
+} // namespace
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <BWAPI.h>
+#include <BWEM/bwem.h>
+#include <cstdint>
+#include <unordered_map>
+
+namespace KBot {
+
+// Memoizes BWEM ground distances. Positions are quantized to walk tiles (8x8 pixels), so that
+// the repeated queries of comparator loops (sort, min_element, ...) cost a single hash lookup.
+// The cache does not depend on the frame: it is only invalidated when BWEM's paths change (see
+// BWEM::Map::PathsVersion()).
+class DistanceOracle {
+    // Upper bound on the number of cached distances. The cache is cleared when it is reached.
+    static const std::size_t maxEntries = 1 << 20;
+
+public:
+    struct Stats {
+        std::uint64_t hits = 0;
+        std::uint64_t misses = 0;
+        std::uint64_t invalidations = 0; // times the cache was dropped (paths changed or full)
+
+        double hitRate() const {
+            return hits + misses > 0 ? (double) hits / (double) (hits + misses) : 0.0;
+        }
+    };
+
+    // The oracle used by KBot::distance().
+    static DistanceOracle &instance();
+
+    // Returns the ground distance between a and b in pixels (see BWEM::Map::GetPath), or -1 if
+    // b is not accessible from a. Both positions are rounded to the center of their walk tile.
+    int distance(BWEM::Map &map, const BWAPI::Position &a, const BWAPI::Position &b);
+
+    // Drops all cached distances. Counters are kept.
+    void clear();
+
+    const Stats &stats() const { return m_stats; }
+    std::size_t  size() const { return m_distances.size(); }
+
+private:
+    std::unordered_map<std::uint64_t, int> m_distances;
+    const BWEM::Map *                      m_map = nullptr;
+    int                                    m_pathsVersion = 0;
+    Stats                                  m_stats;
+};
+
+} // namespace
@@ -1,6 +1,7 @@
 #include "Enemy.h"
 
 #include "KBot.h"
+#include "Profiler.h"
 #include "utils.h"
 #include <algorithm>
 #include <random>
@@ -9,19 +10,19 @@ namespace KBot {
 
 using namespace BWAPI;
 
-Enemy::Enemy(KBot &kBot) : m_kBot(kBot) {}
+Enemy::Enemy(KBot &kBot)
+    : m_kBot(kBot), m_timing(kBot.periodic().add(PeriodicTasks::Kind::enemy)) {}
 
 void Enemy::update() {
+    KBOT_PROFILE("Enemy::update");
+
     // ----- Prevent spamming -----------------------------------------------
     // Everything below is executed only occasionally and not on every frame.
-    if (Broodwar->getFrameCount() % Broodwar->getLatencyFrames() != 0)
+    if (!m_kBot.periodic().due(m_timing))
         return;
 
-    // Delete enemy positions if there is no enemy (any more).
-    // TODO: Works for now, but can surely be improved?
-    while (!m_positions.empty() && Broodwar->isVisible(m_positions.front()) &&
-           Broodwar->getUnitsOnTile(m_positions.front(), Filter::IsEnemy).empty())
-        m_positions.erase(m_positions.begin());
+    m_kBot.scheduler().submit("Enemy: remove positions", Scheduler::Priority::low,
+                              [this] { return removePosition(); });
 }
 
 void Enemy::addPosition(const BWAPI::TilePosition &position) {
@@ -36,6 +37,34 @@ void Enemy::addPosition(const BWAPI::TilePosition &position) {
         m_positions.insert(it, position);
 }
 
+bool Enemy::removePosition() {
+    // Delete enemy positions if there is no enemy (any more).
+    // TODO: Works for now, but can surely be improved?
+    if (m_positions.empty() || !Broodwar->isVisible(m_positions.front()) ||
+        enemyOnTile(m_positions.front()))
+        return true;
+    m_positions.erase(m_positions.begin());
+    return false;
+}
+
+bool Enemy::enemyOnTile(const TilePosition &tile) const {
+    const auto &snapshot = m_kBot.snapshot();
+    const auto  topLeft = Position(tile);
+    const auto  bottomRight = Position(tile + TilePosition(1, 1));
+    for (Snapshot::Id id = 0; id < snapshot.size(); ++id) {
+        if (!snapshot.isEnemy(id))
+            continue;
+        const auto &position = snapshot.positions()[id];
+        const auto &type = snapshot.types()[id];
+        if (position.x - type.dimensionLeft() < bottomRight.x &&
+            position.x + type.dimensionRight() >= topLeft.x &&
+            position.y - type.dimensionUp() < bottomRight.y &&
+            position.y + type.dimensionDown() >= topLeft.y)
+            return true;
+    }
+    return false;
+}
+
 TilePosition Enemy::getClosestPosition() const {
     if (!m_positions.empty())
         return m_positions.front();
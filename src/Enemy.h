@@ -1,5 +1,6 @@
 #pragma once
 
+#include "PeriodicTasks.h"
 #include <BWAPI.h>
 #include <vector>
 
@@ -25,7 +26,16 @@ public:
     std::size_t         getPositionCount() const { return m_positions.size(); }
 
 private:
+    // Removes the closest position if it is visible and there is no enemy on it. Returns true if
+    // there is nothing left to remove. Run as a Scheduler job.
+    bool removePosition();
+
+    // Returns whether the bounding box of some enemy unit overlaps the tile (as
+    // BWAPI::Game::getUnitsOnTile), scanning the snapshot.
+    bool enemyOnTile(const BWAPI::TilePosition &tile) const;
+
     KBot &                           m_kBot;
+    PeriodicTasks::Timing            m_timing;
     std::vector<BWAPI::TilePosition> m_positions; // ordered!
 };
 
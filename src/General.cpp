@@ -1,6 +1,8 @@
 #include "General.h"
 
 #include "KBot.h"
+#include "Profiler.h"
+#include "Watchdog.h"
 #include "utils.h"
 #include <algorithm>
 #include <iterator>
@@ -10,22 +12,29 @@ namespace KBot {
 
 using namespace BWAPI;
 
-General::General(KBot &kBot) : m_kBot(kBot) {}
+General::General(KBot &kBot)
+    : m_kBot(kBot), m_timing(kBot.periodic().add(PeriodicTasks::Kind::general)),
+      m_army(kBot.registry().createGroup(UnitRegistry::Owner::general, UnitRegistry::Role::army)) {}
 
 void General::update() {
-    std::string squadSizes;
-    for (auto &squad : m_squads)
-        squadSizes += ", " + std::to_string(squad.size());
-    squadSizes = squadSizes.empty() ? "No squads" : squadSizes.substr(2);
+    KBOT_PROFILE("General::update");
 
     // TODO: Update to multiple base concept.
-    const auto enemiesNearBase = Broodwar->getUnitsInRadius(
-        Position(Broodwar->self()->getStartLocation()), 1000, Filter::IsEnemy);
+    // Computed once per frame and shared with the squads.
+    m_enemiesNearBase = m_kBot.units().inRadius(Position(Broodwar->self()->getStartLocation()),
+                                                1000, UnitIndex::isEnemy);
 
     // Display debug information
-    Broodwar->drawTextScreen(2, 100, "General: -");
-    Broodwar->drawTextScreen(2, 110, "Squad sizes: %s", squadSizes.c_str());
-    Broodwar->drawTextScreen(2, 120, "Enemies near base: %d", enemiesNearBase.size());
+    if (Watchdog::instance().drawDebug()) {
+        std::string squadSizes;
+        for (auto &squad : m_squads)
+            squadSizes += ", " + std::to_string(squad.size());
+        squadSizes = squadSizes.empty() ? "No squads" : squadSizes.substr(2);
+
+        Broodwar->drawTextScreen(2, 100, "General: -");
+        Broodwar->drawTextScreen(2, 110, "Squad sizes: %s", squadSizes.c_str());
+        Broodwar->drawTextScreen(2, 120, "Enemies near base: %d", m_enemiesNearBase.size());
+    }
 
     // Update squads
     for (auto &squad : m_squads)
@@ -33,53 +42,90 @@ void General::update() {
 
     // ----- Prevent spamming -----------------------------------------------
     // Everything below is executed only occasionally and not on every frame.
-    if (Broodwar->getFrameCount() % Broodwar->getLatencyFrames() != 0)
+    if (!m_kBot.periodic().due(m_timing))
         return;
 
+    m_kBot.scheduler().submit("General: merge squads", Scheduler::Priority::normal,
+                              [this] { return mergeSquads(); });
+
+    // The attacking units regroup along paths. Under time pressure, they use distances instead.
+    if (!Watchdog::instance().reducePathing() &&
+        m_kBot.scheduler().submit("General: refresh paths", Scheduler::Priority::normal,
+                                  [this] { return refreshPath(); })) {
+        m_pathQueue.clear();
+        for (const auto &squad : m_squads)
+            if (squad.getState() == Squad::State::attack)
+                for (const auto &unit : squad)
+                    if (m_kBot.snapshot().type(unit) == UnitTypes::Terran_Marine)
+                        m_pathQueue.push_back(unit);
+    }
+}
+
+bool General::mergeSquads() {
     // Remove empty squads
-    decltype(m_squads)::const_iterator it;
-    while ((it = std::find_if(m_squads.begin(), m_squads.end(),
-                              [](const Squad &squad) { return squad.empty(); })) != m_squads.end())
-        m_squads.erase(it);
+    for (auto it = m_squads.begin(); it != m_squads.end();) {
+        if (it->empty()) {
+            m_kBot.periodic().remove(it->getTiming());
+            it = m_squads.erase(it);
+        } else
+            ++it;
+    }
 
     // Merge nearby and defensive squads
-    bool merge = true;
-    while (merge) {
-        for (auto it = m_squads.begin(); it != m_squads.end(); ++it) {
-            auto hit = std::find_if(it + 1, m_squads.end(), [it](const Squad &squad) {
-                return (distance(it->getPosition(), squad.getPosition()) < 200) ||
-                       (distance(it->getPosition(), squad.getPosition()) < 500 &&
-                        it->getState() == Squad::State::defend &&
-                        squad.getState() == Squad::State::defend);
-            });
-
-            if (hit != m_squads.end()) {
-                // Hold all units as some of them might have old, invalid orders.
-                it->stop();
-                hit->stop();
-                // Merge squad *hit into *it.
-                std::copy(hit->begin(), hit->end(), std::inserter(*it, it->end()));
-                // Remove empty squad *hit.
-                m_squads.erase(hit);
-                // This invalidates all container iterators, so we have to start all over again!
-                break;
-            }
+    for (auto it = m_squads.begin(); it != m_squads.end(); ++it) {
+        auto hit = std::find_if(it + 1, m_squads.end(), [it](const Squad &squad) {
+            return (distance(it->getPosition(), squad.getPosition()) < 200) ||
+                   (distance(it->getPosition(), squad.getPosition()) < 500 &&
+                    it->getState() == Squad::State::defend &&
+                    squad.getState() == Squad::State::defend);
+        });
+
+        if (hit != m_squads.end()) {
+            // Hold all units as some of them might have old, invalid orders.
+            it->stop();
+            hit->stop();
+            // Merge squad *hit into *it.
+            std::copy(hit->begin(), hit->end(), std::inserter(*it, it->end()));
+            // Remove empty squad *hit.
+            m_kBot.periodic().remove(hit->getTiming());
+            m_squads.erase(hit);
+            // This invalidates all container iterators, so continue with the next step.
+            return false;
         }
-        // No more squads to merge.
-        merge = false;
     }
+
+    // No more squads to merge.
+    return true;
 }
 
-void General::giveOwnership(const Unit &unit) {
-    Broodwar->registerEvent(
-        [unit](Game *) {
-            Broodwar->drawTextMap(Position(unit->getPosition()), "General: %s",
-                                  unit->getType().c_str());
-        },
-        [unit](Game *) { return unit->exists(); }, 250);
+bool General::refreshPath() {
+    if (m_pathQueue.empty())
+        return true;
+    const auto unit = m_pathQueue.front();
+    m_pathQueue.pop_front();
+
+    // The unit may have died or changed squads since it was queued.
+    const auto squad = std::find_if(m_squads.begin(), m_squads.end(), [unit](const Squad &squad) {
+        return squad.count(unit) > 0;
+    });
+    if (squad != m_squads.end() && squad->getState() == Squad::State::attack)
+        squad->refreshPath(unit);
+    return m_pathQueue.empty();
+}
 
+void General::giveOwnership(const Unit &unit) {
+    if (Watchdog::instance().drawDebug())
+        Broodwar->registerEvent(
+            [unit](Game *) {
+                Broodwar->drawTextMap(Position(unit->getPosition()), "General: %s",
+                                      unit->getType().c_str());
+            },
+            [unit](Game *) { return unit->exists(); }, 250);
+    m_kBot.registry().assign(unit, m_army);
+
+    const auto position = m_kBot.snapshot().position(unit);
     for (auto &squad : m_squads) {
-        if (distance(unit->getPosition(), squad.getPosition()) < 400) {
+        if (distance(position, squad.getPosition()) < 400) {
             // Join squad
             squad.insert(unit);
             return;
@@ -93,6 +139,7 @@ void General::giveOwnership(const Unit &unit) {
 }
 
 void General::takeOwnership(const Unit &unit) {
+    m_kBot.registry().release(unit);
     for (auto &squad : m_squads)
         squad.erase(unit);
 }
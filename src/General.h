@@ -1,7 +1,10 @@
 #pragma once
 
+#include "PeriodicTasks.h"
 #include "Squad.h"
+#include "UnitRegistry.h"
 #include <BWAPI.h>
+#include <deque>
 #include <vector>
 
 namespace KBot {
@@ -27,9 +30,24 @@ public:
     // Take ownership of a unit from general (forcibly).
     void takeOwnership(const BWAPI::Unit &unit);
 
+    // Enemy units within 1000 pixels of the start location, as of the last update().
+    const std::vector<BWAPI::Unit> &enemiesNearBase() const { return m_enemiesNearBase; }
+
 private:
-    KBot &             m_kBot;
-    std::vector<Squad> m_squads;
+    // Removes the empty squads and merges one pair of nearby squads. Returns true if there is
+    // nothing left to merge. Run as a Scheduler job.
+    bool mergeSquads();
+
+    // Refreshes the path of the next attacking unit (see Squad::refreshPath()). Returns true if
+    // there is no unit left. Run as a Scheduler job.
+    bool refreshPath();
+
+    KBot &                   m_kBot;
+    PeriodicTasks::Timing    m_timing;
+    UnitRegistry::Group      m_army; // all units of the squads
+    std::vector<Squad>       m_squads;
+    std::deque<BWAPI::Unit>  m_pathQueue; // attacking units, whose paths refreshPath() refreshes
+    std::vector<BWAPI::Unit> m_enemiesNearBase;
 };
 
 } // namespace
@@ -1,7 +1,13 @@
 #include "KBot.h"
 
+#include "DistanceOracle.h"
+#include "Profiler.h"
 #include "Squad.h"
+#include "Terrain.h"
+#include "Watchdog.h"
 #include "utils.h"
+#include <algorithm>
+#include <fstream>
 #include <string>
 
 // Some ugly macro magic to get BUILDNUMBER as a string.
@@ -22,6 +28,9 @@ KBot::KBot() : m_manager(*this), m_general(*this), m_enemy(*this) {}
 void KBot::onStart() {
     if (Broodwar->isReplay() || Broodwar->self() == nullptr)
         return;
+#if KBOT_PROFILER
+    Profiler::instance().reset();
+#endif
 
     // Print build information
     Broodwar << "KBot build " << (buildNumber.empty() ? "local" : buildNumber) << std::endl;
@@ -41,11 +50,28 @@ void KBot::onStart() {
     // Set the command optimization level so that common commands can be grouped.
     Broodwar->setCommandOptimizationLevel(2);
 
-    // BWEM map initialization
-    m_map.Initialize();
+    // BWEM map initialization, reusing the analysis of previous games on the same map
+    // (on a cache miss, the analysis is spread among all the hardware threads).
+    m_map.EnableAnalysisCache("bwapi-data/read/", "bwapi-data/write/");
+    m_map.EnableParallelAnalysis();
+    {
+        KBOT_PROFILE("BWEM::Map::Initialize");
+        m_map.Initialize();
+    }
     m_map.EnableAutomaticPathAnalysis();
     const bool r = m_map.FindBasesForStartingLocations();
     assert(r);
+    (void) r; // only checked by the assert
+    DistanceOracle::instance().clear();
+    m_units.reset(m_map);
+    m_placer.reset(m_map);
+
+#if KBOT_TERRAIN_DUMP
+    // Dump the terrain once per map, for the headless backend in tools/headless.
+    const auto terrainPath = "bwapi-data/write/" + Broodwar->mapHash() + ".terrain";
+    if (!std::ifstream(terrainPath))
+        Terrain::capture().save(terrainPath);
+#endif
 
     // Test BuildTask, TODO: Replace hardcoded build order
     // http://wiki.teamliquid.net/starcraft/2_Rax_FE_(vs._Zerg)
@@ -67,29 +93,34 @@ void KBot::onStart() {
     for (const auto &unit : buildorder)
         m_manager.addBuildTask({m_manager, unit, (BuildTask::Priority) priority--});
 
+    // Start the game at full quality. The map analysis above does not count as a frame.
+    Watchdog::instance().reset();
+
     // Ready to go. Good luck, have fun!
     Broodwar->sendText("gl hf");
 }
 
 // Called once at the end of a game.
-void KBot::onEnd(bool /*isWinner*/) {}
+void KBot::onEnd(bool /*isWinner*/) {
+#if KBOT_PROFILER
+    Profiler::instance().writeReport("bwapi-data/write/KBot_profile.txt");
+#endif
+    Watchdog::instance().writeReport("bwapi-data/write/KBot_watchdog.txt");
+}
 
 // Called once for every execution of a logical frame in Broodwar.
 void KBot::onFrame() {
     // Return if the game is a replay or is paused
     if (Broodwar->isReplay() || Broodwar->isPaused() || Broodwar->self() == nullptr)
         return;
+    Watchdog::Frame frame;
+    KBOT_PROFILE("KBot::onFrame");
 
-    // Display some debug information
-    Broodwar->drawTextScreen(2, 0, "FPS: %d, APM: %d", Broodwar->getFPS(), Broodwar->getAPM());
-    Broodwar->drawTextScreen(2, 10, "Scouted enemy positions: %d", m_enemy.getPositionCount());
+    // Copy the unit state read by the modules below
+    m_snapshot.capture();
 
-    if (m_enemy.getPositionCount() > 0) {
-        const auto enemyPosition = m_enemy.getClosestPosition();
-        Broodwar->drawTextScreen(2, 20, "Next enemy position: (%d, %d)", enemyPosition.x,
-                                 enemyPosition.y);
-    } else
-        Broodwar->drawTextScreen(2, 20, "Next enemy position: Unknown");
+    // Update unit index
+    m_units.update(m_snapshot);
 
     // Update manager
     m_manager.update();
@@ -100,6 +131,47 @@ void KBot::onFrame() {
     // Update enemy
     m_enemy.update();
 
+    // Run the jobs submitted by the modules within the time budget that the frame has left. Under
+    // time pressure, they are postponed until the watchdog relaxes.
+    const auto &watchdog = Watchdog::instance();
+    if (!watchdog.postponeAnalysis())
+        m_scheduler.run(watchdog.frameStart());
+
+    // Display some debug information
+    if (watchdog.drawDebug()) {
+        Broodwar->drawTextScreen(2, 0, "FPS: %d, APM: %d", Broodwar->getFPS(), Broodwar->getAPM());
+        Broodwar->drawTextScreen(2, 10, "Scouted enemy positions: %d", m_enemy.getPositionCount());
+
+        if (m_enemy.getPositionCount() > 0) {
+            const auto enemyPosition = m_enemy.getClosestPosition();
+            Broodwar->drawTextScreen(2, 20, "Next enemy position: (%d, %d)", enemyPosition.x,
+                                     enemyPosition.y);
+        } else
+            Broodwar->drawTextScreen(2, 20, "Next enemy position: Unknown");
+
+        const auto &oracleStats = DistanceOracle::instance().stats();
+        Broodwar->drawTextScreen(2, 30, "Distance cache: %.1f%% hits, %u entries",
+                                 oracleStats.hitRate() * 100,
+                                 (unsigned) DistanceOracle::instance().size());
+
+        Broodwar->drawTextScreen(2, 40, "Scheduler: %u jobs pending, %d steps in %lld us",
+                                 (unsigned) m_scheduler.pending(), m_scheduler.lastSteps(),
+                                 (long long) m_scheduler.lastTime().count());
+
+        const int slot = Broodwar->getFrameCount() % PeriodicTasks::cycleFrames;
+        int       minLoad = m_periodic.load(0);
+        int       maxLoad = m_periodic.load(0);
+        for (int s = 1; s < PeriodicTasks::cycleFrames; ++s) {
+            minLoad = std::min(minLoad, m_periodic.load(s));
+            maxLoad = std::max(maxLoad, m_periodic.load(s));
+        }
+        Broodwar->drawTextScreen(2, 60, "Periodic load: %d - %d jobs per frame, %d this frame",
+                                 minLoad, maxLoad, m_periodic.runs(slot));
+
+        Broodwar->drawTextScreen(2, 70, "Frame time: %.1f ms mean, %.1f ms max, %d frames >= 55 ms",
+                                 watchdog.mean(), watchdog.max(), watchdog.overruns(0));
+    }
+
     // ----- Prevent spamming -----------------------------------------------
     // Everything below is executed only occasionally and not on every frame.
     if (Broodwar->getFrameCount() % Broodwar->getLatencyFrames() != 0)
@@ -119,14 +191,22 @@ void KBot::onPlayerLeft(BWAPI::Player /*player*/) {}
 void KBot::onNukeDetect(BWAPI::Position /*target*/) {}
 
 // Called when a Unit becomes accessible.
-void KBot::onUnitDiscover(BWAPI::Unit unit) { assert(unit->exists()); }
+void KBot::onUnitDiscover(BWAPI::Unit unit) {
+    assert(unit->exists());
+    (void) unit; // only checked by the assert
+}
 
 // Called when a Unit becomes inaccessible.
-void KBot::onUnitEvade(BWAPI::Unit unit) { assert(!unit->exists()); }
+void KBot::onUnitEvade(BWAPI::Unit unit) {
+    assert(!unit->exists());
+    (void) unit; // only checked by the assert
+}
 
 // Called when a previously invisible unit becomes visible.
 void KBot::onUnitShow(BWAPI::Unit unit) {
     assert(unit->exists());
+    m_units.add(unit);
+    m_placer.add(unit);
 
     // Update enemy positions
     if (Broodwar->self()->isEnemy(unit->getPlayer()) && unit->getType().isBuilding())
@@ -136,11 +216,14 @@ void KBot::onUnitShow(BWAPI::Unit unit) {
 // Called just as a visible unit is becoming invisible.
 void KBot::onUnitHide(BWAPI::Unit unit) {
     assert(!unit->exists()); // ???
+    m_units.remove(unit);
 }
 
 // Called when any unit is created.
 void KBot::onUnitCreate(BWAPI::Unit unit) {
     assert(unit->exists());
+    m_units.add(unit);
+    m_placer.add(unit);
 
     // My unit
     if (unit->getPlayer() == Broodwar->self()) {
@@ -152,25 +235,29 @@ void KBot::onUnitCreate(BWAPI::Unit unit) {
 // Called when a unit is removed from the game either through death or other means.
 void KBot::onUnitDestroy(BWAPI::Unit unit) {
     assert(!unit->exists());
+    m_units.remove(unit);
+    m_placer.remove(unit);
 
     // My unit
     if (unit->getPlayer() == Broodwar->self()) {
         // Notify build tasks
         m_manager.buildTaskOnUnitDestroyed(unit);
 
-        // Dispatch
-        if (unit->getType().isBuilding() || unit->getType().isWorker() ||
-            unit->getType().isMineralField())
-            m_manager.takeOwnership(unit);
-        else
+        // Dispatch to the owner of the unit
+        if (m_registry.owner(unit) == UnitRegistry::Owner::general)
             m_general.takeOwnership(unit);
+        else
+            m_manager.takeOwnership(unit);
     }
 
     // Update BWEM information
-    if (unit->getType().isMineralField())
+    if (unit->getType().isMineralField()) {
+        KBOT_PROFILE("BWEM::Map::OnMineralDestroyed");
         m_map.OnMineralDestroyed(unit);
-    else if (unit->getType().isSpecialBuilding())
+    } else if (unit->getType().isSpecialBuilding()) {
+        KBOT_PROFILE("BWEM::Map::OnStaticBuildingDestroyed");
         m_map.OnStaticBuildingDestroyed(unit);
+    }
 }
 
 // Called when a unit changes its UnitType.
@@ -178,6 +265,8 @@ void KBot::onUnitMorph(BWAPI::Unit unit) {
     // For example, when a Drone transforms into a Hatchery, a Siege Tank uses Siege Mode, or a
     // Vespene Geyser receives a Refinery.
     assert(unit->exists());
+    m_units.refresh(unit);
+    m_placer.add(unit);
 
     // My unit
     if (unit->getPlayer() == Broodwar->self()) {
@@ -187,9 +276,10 @@ void KBot::onUnitMorph(BWAPI::Unit unit) {
 }
 
 // Called when a unit changes ownership.
-void KBot::onUnitRenegade(BWAPI::Unit /*unit*/) {
+void KBot::onUnitRenegade(BWAPI::Unit unit) {
     // This occurs when the Protoss ability Mind Control is used, or if a unit changes ownership in
     // Use Map Settings.
+    m_units.refresh(unit);
     // TODO!
 }
 
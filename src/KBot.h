@@ -3,9 +3,15 @@
 #include <BWAPI.h>
 #include <BWEM/bwem.h>
 
+#include "BuildingPlacer.h"
 #include "Enemy.h"
 #include "General.h"
 #include "Manager.h"
+#include "PeriodicTasks.h"
+#include "Scheduler.h"
+#include "Snapshot.h"
+#include "UnitIndex.h"
+#include "UnitRegistry.h"
 
 namespace KBot {
 
@@ -39,20 +45,34 @@ public:
     void onUnitComplete(BWAPI::Unit unit) override;
 
     // Getter for members.
-    Manager &        manager() { return m_manager; }
-    const Manager &  manager() const { return m_manager; }
-    General &        general() { return m_general; }
-    const General &  general() const { return m_general; }
-    Enemy &          enemy() { return m_enemy; }
-    const Enemy &    enemy() const { return m_enemy; }
-    BWEM::Map &      map() { return m_map; };
-    const BWEM::Map &map() const { return m_map; };
+    Manager &             manager() { return m_manager; }
+    const Manager &       manager() const { return m_manager; }
+    General &             general() { return m_general; }
+    const General &       general() const { return m_general; }
+    Enemy &               enemy() { return m_enemy; }
+    const Enemy &         enemy() const { return m_enemy; }
+    const UnitIndex &     units() const { return m_units; }
+    const Snapshot &      snapshot() const { return m_snapshot; }
+    Scheduler &           scheduler() { return m_scheduler; }
+    PeriodicTasks &       periodic() { return m_periodic; }
+    BuildingPlacer &      placer() { return m_placer; }
+    const BuildingPlacer &placer() const { return m_placer; }
+    UnitRegistry &        registry() { return m_registry; }
+    const UnitRegistry &  registry() const { return m_registry; }
+    BWEM::Map &           map() { return m_map; };
+    const BWEM::Map &     map() const { return m_map; };
 
 private:
-    Manager    m_manager;
-    General    m_general;
-    Enemy      m_enemy;
-    BWEM::Map &m_map = BWEM::Map::Instance();
+    UnitRegistry   m_registry; // first, the modules below create their groups on construction
+    PeriodicTasks  m_periodic; // and register their periodic work
+    Manager        m_manager;
+    General        m_general;
+    Enemy          m_enemy;
+    UnitIndex      m_units;
+    Snapshot       m_snapshot;
+    BuildingPlacer m_placer;
+    Scheduler      m_scheduler;
+    BWEM::Map &    m_map = BWEM::Map::Instance();
 };
 
 } // namespace
@@ -1,6 +1,8 @@
 #include "Manager.h"
 
 #include "KBot.h"
+#include "Profiler.h"
+#include "Watchdog.h"
 #include "utils.h"
 #include <algorithm>
 
@@ -8,154 +10,184 @@ namespace KBot {
 
 using namespace BWAPI;
 
-Manager::Manager(KBot &kBot) : m_kBot(kBot) {
+Manager::Manager(KBot &kBot)
+    : m_kBot(kBot), m_timing(kBot.periodic().add(PeriodicTasks::Kind::manager)),
+      m_workers(kBot.registry().createGroup(UnitRegistry::Owner::manager,
+                                            UnitRegistry::Role::builder)) {
     // Create initial base
     m_bases.emplace_back(*this, Broodwar->self()->getStartLocation());
 }
 
 void Manager::update() {
-    // Display debug information
-    Broodwar->drawTextScreen(2, 50, "Manager: -");
-
-    // Display build tasks
-    const std::size_t maxBuildDisplay = 10;
-    Broodwar->drawTextScreen(200, 0, "Build queue:");
-    for (std::size_t i = 0; i < m_buildQueue.size() && i < maxBuildDisplay; ++i)
-        Broodwar->drawTextScreen(200, (i + 1) * 10, "%s", m_buildQueue[i].toString().c_str());
-    if (m_buildQueue.size() > maxBuildDisplay)
-        Broodwar->drawTextScreen(200, (maxBuildDisplay + 1) * 10, "and %d more...",
-                                 m_buildQueue.size() - maxBuildDisplay);
+    KBOT_PROFILE("Manager::update");
 
-    // Display available resources
-    Broodwar->drawTextScreen(450, 15, "(%d)", getAvailableMinerals());
-    Broodwar->drawTextScreen(518, 15, "(%d)", getAvailableGas());
+    // Display debug information
+    if (Watchdog::instance().drawDebug()) {
+        Broodwar->drawTextScreen(2, 50, "Manager: -");
+
+        // Display build tasks
+        const std::size_t maxBuildDisplay = 10;
+        Broodwar->drawTextScreen(200, 0, "Build queue:");
+        std::size_t line = 0;
+        for (auto it = m_buildQueue.begin(); it != m_buildQueue.end() && line < maxBuildDisplay;
+             ++it)
+            Broodwar->drawTextScreen(200, ++line * 10, "%s", it->toString().c_str());
+        if (m_buildQueue.size() > maxBuildDisplay)
+            Broodwar->drawTextScreen(200, (maxBuildDisplay + 1) * 10, "and %d more...",
+                                     m_buildQueue.size() - maxBuildDisplay);
+
+        // Display available resources
+        Broodwar->drawTextScreen(450, 15, "(%d)", getAvailableMinerals());
+        Broodwar->drawTextScreen(518, 15, "(%d)", getAvailableGas());
+    }
 
     // Update bases
     for (auto &base : m_bases)
         base.update();
 
-    // Update build tasks
-    for (auto &buildTask : m_buildQueue)
-        buildTask.update();
+    // Update build tasks. Parked tasks are woken up by events only.
+    for (auto &buildTask : m_buildQueue) {
+        if (!buildTask.isParked())
+            buildTask.update();
+    }
 
     // ----- Prevent spamming -----------------------------------------------
     // Everything below is executed only occasionally and not on every frame.
-    if (Broodwar->getFrameCount() % Broodwar->getLatencyFrames() != 0)
+    if (!periodic().due(m_timing))
         return;
 
-    // Cleanup finished build tasks.
-    for (auto it = m_buildQueue.begin(); it != m_buildQueue.end();) {
-        if (it->getState() == BuildTask::State::finalize)
-            it = m_buildQueue.erase(it);
-        else
-            ++it;
-    }
+    // Cleanup finished build tasks. They do not watch or await units any more.
+    m_buildQueue.remove_if([](const BuildTask &buildTask) {
+        return buildTask.getState() == BuildTask::State::finalize;
+    });
 }
 
 void Manager::giveOwnership(const Unit &unit) {
     // Assign unit to nearest base.
+    const auto position = snapshot().position(unit);
     const auto it =
-        std::min_element(m_bases.begin(), m_bases.end(), [&unit](const Base &a, const Base &b) {
-            return distance(unit->getPosition(), a.getPosition()) <
-                   distance(unit->getPosition(), b.getPosition());
+        std::min_element(m_bases.begin(), m_bases.end(), [&position](const Base &a, const Base &b) {
+            return distance(position, a.getPosition()) < distance(position, b.getPosition());
         });
     assert(it != m_bases.end());
     it->giveOwnership(unit);
 }
 
 void Manager::takeOwnership(const Unit &unit) {
-    // Remove unit from workers
-    m_workers.erase(std::remove(m_workers.begin(), m_workers.end(), unit), m_workers.end());
-
-    // And pass on to bases...
-    for (auto &base : m_bases)
-        base.takeOwnership(unit);
+    // Remove unit from workers or whichever base owns it.
+    registry().release(unit);
 }
 
-void Manager::addBuildTask(const BuildTask &buildTask) { m_buildQueue.push_back(buildTask); }
+const Snapshot &Manager::snapshot() const { return m_kBot.snapshot(); }
+
+UnitRegistry &Manager::registry() { return m_kBot.registry(); }
+
+const UnitRegistry &Manager::registry() const { return m_kBot.registry(); }
+
+void Manager::addBuildTask(const BuildTask &buildTask) {
+    const auto position = std::upper_bound(
+        m_buildQueue.begin(), m_buildQueue.end(), buildTask,
+        [](const BuildTask &a, const BuildTask &b) { return a.getPriority() > b.getPriority(); });
+    m_buildQueue.insert(position, buildTask);
+    m_resources.enqueue(buildTask.getPriority());
+}
 
 void Manager::buildTaskOnUnitCreatedOrMorphed(const Unit &unit) {
-    // Return as soon as the first build task can identify the created unit.
-    for (auto &buildTask : m_buildQueue) {
-        if (buildTask.onUnitCreatedOrMorphed(unit))
-            return;
+    // Hand the unit to the task that has been awaiting its type for the longest time.
+    const auto it = m_tasksByType.find(unit->getType().getID());
+    if (it == m_tasksByType.end())
+        return;
+    assert(!it->second.empty());
+    const auto buildTask = it->second.front();
+    it->second.erase(it->second.begin());
+    if (it->second.empty())
+        m_tasksByType.erase(it);
+
+    if (!buildTask->onUnitCreatedOrMorphed(unit)) {
+        // Should not happen, as the task parked to await this type. Report it and keep the task
+        // waiting for the next unit of the type, so that it does not stay parked forever.
+        Broodwar << "Manager: \"" << buildTask->toString() << "\" rejected its new unit"
+                 << std::endl;
+        if (buildTask->getState() == BuildTask::State::waitForUnit)
+            awaitUnit(unit->getType(), *buildTask);
     }
 }
 
 void Manager::buildTaskOnUnitDestroyed(const Unit &unit) {
-    // Return as soon as the first build task can identify the destroyed unit.
-    for (auto &buildTask : m_buildQueue) {
-        if (buildTask.onUnitDestroyed(unit))
-            return;
-    }
+    const auto it = m_tasksByUnit.find(unit);
+    if (it == m_tasksByUnit.end())
+        return;
+    const auto buildTask = it->second;
+    m_tasksByUnit.erase(it);
+    buildTask->onUnitDestroyed(unit);
 }
 
-void Manager::buildTaskOnUnitCompleted(const Unit &) {
-    // Since BuildTasks are busy waiting for completion right now, this is unused.
+void Manager::buildTaskOnUnitCompleted(const Unit &unit) {
+    const auto it = m_tasksByUnit.find(unit);
+    if (it != m_tasksByUnit.end())
+        it->second->onUnitCompleted(unit);
 }
 
 int Manager::getAvailableMinerals() const {
-    return BWAPI::Broodwar->self()->minerals() - m_reservedMinerals;
+    return BWAPI::Broodwar->self()->minerals() - m_resources.reservedMinerals();
 }
 
-int Manager::getAvailableGas() const { return BWAPI::Broodwar->self()->gas() - m_reservedGas; }
+int Manager::getAvailableGas() const {
+    return BWAPI::Broodwar->self()->gas() - m_resources.reservedGas();
+}
 
 bool Manager::acquireResources(int minerals, int gas, BuildTask::Priority priority) {
-    // All higher tasks have to have their resources allocated, otherwise fail!
-    for (auto it = m_buildQueue.begin(); it != m_buildQueue.end() && it->getPriority() > priority;
-         ++it) {
-        if (it->getState() <= BuildTask::State::acquireResources)
-            return false;
-    }
-
-    // Allocate resources if available.
-    if (getAvailableMinerals() >= minerals && getAvailableGas() >= gas) {
-        m_reservedMinerals += minerals;
-        m_reservedGas += gas;
-        return true;
-    }
-    return false;
+    return m_resources.reserve(minerals, gas, priority, BWAPI::Broodwar->self()->minerals(),
+                               BWAPI::Broodwar->self()->gas());
 }
 
-void Manager::releaseResources(int minerals, int gas) {
-    m_reservedMinerals -= minerals;
-    m_reservedGas -= gas;
-    assert(m_reservedMinerals >= 0);
-    assert(m_reservedGas >= 0);
-}
+void Manager::releaseResources(int minerals, int gas) { m_resources.release(minerals, gas); }
 
 Unit Manager::acquireWorker(const UnitType &workerType, const Position &nearPosition) {
-    // Search for matching workers and remember their bases.
-    std::vector<std::pair<Unit, Base *>> workers;
-    for (auto &base : m_bases) {
-        const auto worker = base.findWorker(workerType, nearPosition);
-        if (worker != nullptr)
-            workers.emplace_back(worker, &base);
+    const auto &snapshot = this->snapshot();
+    auto pred = [&](const Unit &u) { return snapshot.type(u) == workerType; };
+    auto comp = [&](const Unit &a, const Unit &b) {
+        return distance(nearPosition, snapshot.position(a)) <
+               distance(nearPosition, snapshot.position(b));
+    };
+
+    // Search the workers of all bases. Prefer "other units" over mineral workers over gas workers,
+    // then pick the closest one...
+    auto &registry = this->registry();
+    for (const auto role : {UnitRegistry::Role::other, UnitRegistry::Role::mineralWorker,
+                            UnitRegistry::Role::gasWorker}) {
+        const auto &units = registry.withRole(role);
+        const auto  worker = min_element_if(units.begin(), units.end(), pred, comp);
+        if (worker != units.end()) {
+            // ...and take ownership explicitly (out of its base)!
+            const auto unit = *worker;
+            registry.assign(unit, m_workers);
+            return unit;
+        }
     }
 
-    if (workers.empty()) {
-        // No worker found.
-        return nullptr;
-    }
-
-    // Pick best candidate...
-    const auto closestWorker = std::min_element(
-        workers.begin(), workers.end(), [&nearPosition](const auto &a, const auto &b) {
-            return distance(nearPosition, a.first->getPosition()) <
-                   distance(nearPosition, b.first->getPosition());
-        });
-
-    // ...and take ownership explicitly!
-    closestWorker->second->takeOwnership(closestWorker->first);
-    m_workers.push_back(closestWorker->first);
-    return closestWorker->first;
+    // No worker found.
+    return nullptr;
 }
 
 void Manager::releaseWorker(const Unit &worker) {
-    m_workers.erase(std::remove(m_workers.begin(), m_workers.end(), worker), m_workers.end());
-
     // Pass ownership back to bases
     giveOwnership(worker);
 }
 
+BuildingPlacer &Manager::placer() { return m_kBot.placer(); }
+
+PeriodicTasks &Manager::periodic() { return m_kBot.periodic(); }
+
+void Manager::watchUnit(const Unit &unit, BuildTask &buildTask) {
+    assert(m_tasksByUnit.count(unit) == 0 || m_tasksByUnit[unit] == &buildTask);
+    m_tasksByUnit[unit] = &buildTask;
+}
+
+void Manager::unwatchUnit(const Unit &unit) { m_tasksByUnit.erase(unit); }
+
+void Manager::awaitUnit(const UnitType &type, BuildTask &buildTask) {
+    m_tasksByType[type.getID()].push_back(&buildTask);
+}
+
 } // namespace
@@ -1,8 +1,15 @@
 #pragma once
 
 #include "Base.h"
+#include "BuildingPlacer.h"
+#include "PeriodicTasks.h"
 #include "BuildTask.h"
+#include "ResourceLedger.h"
+#include "Snapshot.h"
+#include "UnitRegistry.h"
 #include <BWAPI.h>
+#include <list>
+#include <unordered_map>
 #include <vector>
 
 namespace KBot {
@@ -25,13 +32,14 @@ public:
     // Transfer ownership of a unit to manager.
     void giveOwnership(const BWAPI::Unit &unit);
 
-    // Take ownership of a unit from manager (forcibly).
+    // Take ownership of a unit from manager (forcibly). O(1), see UnitRegistry.
     void takeOwnership(const BWAPI::Unit &unit);
 
+    // Inserts the build task after all tasks with the same or a higher priority.
     void addBuildTask(const BuildTask &buildTask);
     // const auto &getBuildQueue() const { return m_buildQueue; }
 
-    // Notify BuildTasks
+    // Notify BuildTasks. The events are routed to the tasks awaiting or watching the unit.
     void buildTaskOnUnitCreatedOrMorphed(const BWAPI::Unit &unit);
     void buildTaskOnUnitDestroyed(const BWAPI::Unit &unit);
     void buildTaskOnUnitCompleted(const BWAPI::Unit &unit);
@@ -43,15 +51,33 @@ public:
     void releaseResources(int minerals, int gas);
     BWAPI::Unit acquireWorker(const BWAPI::UnitType &workerType,
                               const BWAPI::Position &nearPosition);
-    void releaseWorker(const BWAPI::Unit &worker);
+    void            releaseWorker(const BWAPI::Unit &worker);
+    BuildingPlacer &placer();
+    PeriodicTasks & periodic();
+
+    // Interface for BuildTask: event routing. A task is notified of the destruction and completion
+    // of the units it watches (its worker and building unit) and of the next creation of a unit of
+    // the type it awaits, so that it can stay parked in the meantime.
+    void watchUnit(const BWAPI::Unit &unit, BuildTask &buildTask);
+    void unwatchUnit(const BWAPI::Unit &unit);
+    void awaitUnit(const BWAPI::UnitType &type, BuildTask &buildTask);
+
+    // Interface for Base: the unit state of the current frame and the ownership of units.
+    const Snapshot &    snapshot() const;
+    UnitRegistry &      registry();
+    const UnitRegistry &registry() const;
 
 private:
-    KBot &                   m_kBot;
-    std::vector<Base>        m_bases;
-    std::vector<BuildTask>   m_buildQueue;
-    int                      m_reservedMinerals = 0;
-    int                      m_reservedGas = 0;
-    std::vector<BWAPI::Unit> m_workers; // for build tasks
+    KBot &                m_kBot;
+    PeriodicTasks::Timing m_timing;
+    UnitRegistry::Group   m_workers; // for build tasks
+    std::vector<Base>     m_bases;
+    std::list<BuildTask>  m_buildQueue; // ordered by priority, highest first
+    ResourceLedger        m_resources;
+
+    // Event routing for the build tasks, see watchUnit() and awaitUnit().
+    std::unordered_map<BWAPI::Unit, BuildTask *>      m_tasksByUnit;
+    std::unordered_map<int, std::vector<BuildTask *>> m_tasksByType; // by UnitType::getID()
 };
 
 } // namespace
@@ -0,0 +1,71 @@
+#include "PeriodicTasks.h"
+
+#include <BWAPI.h>
+#include <algorithm>
+#include <cassert>
+
+namespace KBot {
+
+using namespace BWAPI;
+
+PeriodicTasks::PeriodicTasks() {
+    m_runsFrame.fill(-1);
+    for (int kind = 0; kind < static_cast<int>(Kind::count); ++kind)
+        setPeriod(static_cast<Kind>(kind), Broodwar->getLatencyFrames());
+}
+
+void PeriodicTasks::setPeriod(Kind kind, int frames) {
+    int period = std::max(1, std::min(frames, (int) cycleFrames));
+    while (cycleFrames % period != 0)
+        ++period;
+    m_periods[static_cast<int>(kind)] = period;
+}
+
+PeriodicTasks::Timing PeriodicTasks::add(Kind kind) {
+    Timing timing;
+    timing.period = getPeriod(kind);
+
+    // Pick the phase whose busiest frame has the fewest jobs, then the fewest jobs in total.
+    int bestMax = 0;
+    int bestSum = 0;
+    for (int phase = 0; phase < timing.period; ++phase) {
+        int max = 0;
+        int sum = 0;
+        for (int slot = phase; slot < cycleFrames; slot += timing.period) {
+            max = std::max(max, m_load[slot]);
+            sum += m_load[slot];
+        }
+        if (phase == 0 || max < bestMax || (max == bestMax && sum < bestSum)) {
+            timing.phase = phase;
+            bestMax = max;
+            bestSum = sum;
+        }
+    }
+
+    for (int slot = timing.phase; slot < cycleFrames; slot += timing.period)
+        ++m_load[slot];
+    return timing;
+}
+
+void PeriodicTasks::remove(const Timing &timing) {
+    for (int slot = timing.phase; slot < cycleFrames; slot += timing.period) {
+        assert(m_load[slot] > 0);
+        --m_load[slot];
+    }
+}
+
+bool PeriodicTasks::due(const Timing &timing) {
+    const int frame = Broodwar->getFrameCount();
+    if (frame % timing.period != timing.phase)
+        return false;
+
+    const int slot = frame % cycleFrames;
+    if (m_runsFrame[slot] != frame) {
+        m_runsFrame[slot] = frame;
+        m_runs[slot] = 0;
+    }
+    ++m_runs[slot];
+    return true;
+}
+
+} // namespace
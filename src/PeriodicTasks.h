@@ -0,0 +1,55 @@
+#pragma once
+
+#include <array>
+
+namespace KBot {
+
+// Staggers the periodic ("prevent spamming") sections of the modules over the frames. Each base,
+// build task, squad and module registers with a period and gets the phase whose frames are the
+// least loaded, so that its periodic section runs on the frames where
+// frame % period == phase instead of all of them firing on the same frame.
+//
+// The load is accounted on a cycle of cycleFrames frames, which every period divides.
+class PeriodicTasks {
+public:
+    static const int cycleFrames = 60;
+
+    // The kinds of periodic work, each with its own period.
+    enum class Kind { manager, base, buildTask, general, squad, enemy, count };
+
+    // When the periodic section of one job is due.
+    struct Timing {
+        int period = 1;
+        int phase = 0;
+    };
+
+    // All periods default to the latency frames of the game.
+    PeriodicTasks();
+
+    // Sets the period of the kind, rounded up to a divisor of cycleFrames. Affects the jobs
+    // registered afterwards.
+    void setPeriod(Kind kind, int frames);
+    int  getPeriod(Kind kind) const { return m_periods[static_cast<int>(kind)]; }
+
+    // Registers a job of the kind and returns its timing. The job has to be removed with the
+    // same timing when it ends (copies of the job share it).
+    Timing add(Kind kind);
+    void   remove(const Timing &timing);
+
+    // Returns whether the periodic section of the job is due in the current frame, and counts it.
+    bool due(const Timing &timing);
+
+    // Number of registered jobs due in the frames where frame % cycleFrames == slot.
+    int load(int slot) const { return m_load[slot]; }
+
+    // Number of jobs that were due in the last frame of the slot.
+    int runs(int slot) const { return m_runs[slot]; }
+
+private:
+    std::array<int, static_cast<int>(Kind::count)> m_periods;
+    std::array<int, cycleFrames>                   m_load = {};
+    std::array<int, cycleFrames>                   m_runs = {};
+    std::array<int, cycleFrames>                   m_runsFrame = {}; // frame counted in m_runs
+};
+
+} // namespace
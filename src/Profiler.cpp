@@ -0,0 +1,102 @@
+#include "Profiler.h"
+
+#if KBOT_PROFILER
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+
+namespace KBot {
+
+Profiler &Profiler::instance() {
+    static Profiler profiler;
+    return profiler;
+}
+
+void Profiler::reset() {
+    m_nodes.clear();
+    m_roots.clear();
+    m_current = -1;
+}
+
+int Profiler::enter(const char *name) {
+    // Zone names are usually string literals, so compare the pointers first.
+    auto &siblings = m_current == -1 ? m_roots : m_nodes[m_current].children;
+    const auto it = std::find_if(siblings.begin(), siblings.end(), [this, name](int node) {
+        return m_nodes[node].name == name || std::strcmp(m_nodes[node].name, name) == 0;
+    });
+
+    int node;
+    if (it != siblings.end())
+        node = *it;
+    else {
+        node = (int) m_nodes.size();
+        siblings.push_back(node); // before m_nodes grows, siblings may refer into it
+        m_nodes.push_back(Node{name, m_current, {}, {}});
+        m_nodes.back().samples.reserve(sampleCount);
+    }
+
+    m_current = node;
+    return node;
+}
+
+void Profiler::leave(int node, std::chrono::steady_clock::duration duration) {
+    const auto us = std::chrono::duration<float, std::micro>(duration).count();
+
+    auto &n = m_nodes[node];
+    if (n.samples.size() < sampleCount)
+        n.samples.push_back(us);
+    else
+        n.samples[n.calls % sampleCount] = us;
+    ++n.calls;
+    n.total += us;
+    n.max = std::max(n.max, us);
+
+    m_current = n.parent;
+}
+
+void Profiler::report(std::ostream &out) const {
+    out << std::left << std::setw(48) << "zone" << std::right << std::setw(10) << "calls"
+        << std::setw(12) << "total [ms]" << std::setw(10) << "mean" << std::setw(10) << "p50"
+        << std::setw(10) << "p99" << std::setw(10) << "max" << "\n";
+    for (const auto root : m_roots)
+        report(out, root, 0);
+}
+
+void Profiler::report(std::ostream &out, int node, int depth) const {
+    const auto &n = m_nodes[node];
+
+    // Percentiles of the samples in the ring buffer.
+    auto       samples = n.samples;
+    const auto percentile = [&samples](double p) -> float {
+        if (samples.empty())
+            return 0;
+        const auto k = std::min(samples.size() - 1, std::size_t(p * samples.size()));
+        std::nth_element(samples.begin(), samples.begin() + k, samples.end());
+        return samples[k];
+    };
+
+    out << std::left << std::setw(48) << (std::string(2 * depth, ' ') + n.name) << std::right
+        << std::fixed << std::setprecision(1) << std::setw(10) << n.calls << std::setw(12)
+        << n.total / 1000 << std::setw(10) << (n.calls ? n.total / n.calls : 0) << std::setw(10)
+        << percentile(0.50) << std::setw(10) << percentile(0.99) << std::setw(10) << n.max
+        << "\n";
+
+    for (const auto child : n.children)
+        report(out, child, depth + 1);
+}
+
+bool Profiler::writeReport(const std::string &path) const {
+    std::ofstream file(path);
+    if (!file)
+        return false;
+    file << "KBot profile (latencies in microseconds, percentiles of the last " << sampleCount
+         << " calls)\n\n";
+    report(file);
+    return (bool) file;
+}
+
+} // namespace
+
+#endif
@@ -0,0 +1,89 @@
+#pragma once
+
+// Compile-time switch: build with KBOT_PROFILER=0 to remove the profiler completely. The zones
+// then expand to nothing and no timing code is compiled in.
+#ifndef KBOT_PROFILER
+#define KBOT_PROFILER 1
+#endif
+
+#if KBOT_PROFILER
+
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace KBot {
+
+// Hierarchical profiler. KBOT_PROFILE(name) times the enclosing scope as a zone, which is a child
+// of the zone that was open when it was entered. For each zone, the latencies of the last
+// sampleCount calls are kept in a ring buffer, from which the report computes the percentiles.
+// Not thread safe; zones must only be entered from the thread of the bot.
+class Profiler {
+public:
+    static const std::size_t sampleCount = 1024;
+
+    // Times a scope, see KBOT_PROFILE.
+    class Zone {
+    public:
+        explicit Zone(const char *name) : m_node(instance().enter(name)) {
+            m_start = std::chrono::steady_clock::now();
+        }
+        ~Zone() { instance().leave(m_node, std::chrono::steady_clock::now() - m_start); }
+
+        Zone(const Zone &) = delete;
+        Zone &operator=(const Zone &) = delete;
+
+    private:
+        int                                   m_node;
+        std::chrono::steady_clock::time_point m_start;
+    };
+
+    static Profiler &instance();
+
+    // Drops all zones and samples (at the beginning of a game).
+    void reset();
+
+    // Writes calls, total time, mean, p50, p99 and max (in microseconds) for each zone, indented
+    // by depth.
+    void report(std::ostream &out) const;
+
+    // Writes the report to a file. Returns false if the file could not be written.
+    bool writeReport(const std::string &path) const;
+
+private:
+    struct Node {
+        const char *       name;
+        int                parent;
+        std::vector<int>   children;
+        std::vector<float> samples; // ring buffer of the latencies in microseconds
+        std::size_t        calls = 0;
+        double             total = 0; // microseconds
+        float              max = 0;   // microseconds
+    };
+
+    Profiler() = default;
+
+    int  enter(const char *name);
+    void leave(int node, std::chrono::steady_clock::duration duration);
+
+    void report(std::ostream &out, int node, int depth) const;
+
+    std::vector<Node> m_nodes;
+    std::vector<int>  m_roots;
+    int               m_current = -1; // innermost open zone
+};
+
+} // namespace
+
+#define KBOT_PROFILE_CONCAT_(a, b) a##b
+#define KBOT_PROFILE_CONCAT(a, b) KBOT_PROFILE_CONCAT_(a, b)
+#define KBOT_PROFILE(name)                                                                         \
+    ::KBot::Profiler::Zone KBOT_PROFILE_CONCAT(kBotProfileZone, __LINE__)(name)
+
+#else
+
+#define KBOT_PROFILE(name)
+
+#endif
@@ -0,0 +1,518 @@
+#include "Recorder.h"
+
+#include "Profiler.h"
+#include <algorithm>
+#include <iterator>
+
+namespace KBot {
+
+using namespace BWAPI;
+
+namespace {
+
+const char         magic[4] = {'K', 'B', 'R', 'C'};
+const char         footerMagic[4] = {'K', 'B', 'R', 'I'};
+const std::int32_t version = 1;
+const int          footerSize = 8 + sizeof(footerMagic);
+
+enum BlockKind : char { delta, keyframe };
+
+// Fixed size values (header, index, footer)
+
+template <typename T>
+void write(std::ostream &out, T value) {
+    out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+void write(std::ostream &out, const std::string &text) {
+    write(out, (std::int32_t) text.size());
+    out.write(text.data(), text.size());
+}
+
+template <typename T>
+T read(std::istream &in) {
+    T value = 0;
+    in.read(reinterpret_cast<char *>(&value), sizeof(value));
+    return value;
+}
+
+std::string readString(std::istream &in) {
+    const auto size = read<std::int32_t>(in);
+    if (!in || size < 0 || size > 4096)
+        return {};
+    std::string text(size, '\0');
+    in.read(&text[0], size);
+    return text;
+}
+
+// Variable length values (blocks): 7 bits per byte, signed values zigzag encoded.
+
+void putVarint(std::string &out, std::uint32_t value) {
+    for (; value >= 0x80; value >>= 7)
+        out += (char) (value | 0x80);
+    out += (char) value;
+}
+
+void putSigned(std::string &out, int value) {
+    putVarint(out, ((std::uint32_t) value << 1) ^ (std::uint32_t)(value >> 31));
+}
+
+void putString(std::string &out, const std::string &text) {
+    putVarint(out, (std::uint32_t) text.size());
+    out += text;
+}
+
+bool readVarint(std::istream &in, std::uint32_t &value) {
+    value = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        const int byte = in.get();
+        if (byte == std::char_traits<char>::eof())
+            return false;
+        value |= (std::uint32_t)(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+            return true;
+    }
+    return false;
+}
+
+class Input {
+public:
+    explicit Input(const std::string &data) : m_data(data) {}
+
+    std::uint32_t varint() {
+        std::uint32_t value = 0;
+        for (int shift = 0; shift < 35; shift += 7) {
+            if (m_position == m_data.size())
+                break;
+            const auto byte = (std::uint8_t) m_data[m_position++];
+            value |= (std::uint32_t)(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0)
+                return value;
+        }
+        m_ok = false;
+        return 0;
+    }
+
+    int signedValue() {
+        const auto value = varint();
+        return (int) ((value >> 1) ^ (~(value & 1) + 1));
+    }
+
+    std::string string() {
+        const auto size = varint();
+        if (size > m_data.size() - m_position) {
+            m_ok = false;
+            return {};
+        }
+        m_position += size;
+        return m_data.substr(m_position - size, size);
+    }
+
+    bool ok() const { return m_ok; }
+
+private:
+    const std::string &m_data;
+    std::size_t        m_position = 0;
+    bool               m_ok = true;
+};
+
+// Writes the fields of state that differ from base: id, bit mask, deltas. With force, the entry
+// is written even if nothing changed. Returns true if written.
+template <std::size_t N>
+bool putDelta(std::string &out, int id, const std::array<int, N> &state,
+              const std::array<int, N> &base, bool force = false) {
+    std::uint32_t mask = 0;
+    for (std::size_t i = 0; i < N; ++i)
+        if (state[i] != base[i])
+            mask |= 1u << i;
+    if (mask == 0 && !force)
+        return false;
+
+    putVarint(out, id);
+    putVarint(out, mask);
+    for (std::size_t i = 0; i < N; ++i)
+        if (mask & (1u << i))
+            putSigned(out, state[i] - base[i]);
+    return true;
+}
+
+// Reads an entry written by putDelta() on top of state, which holds the base.
+template <std::size_t N>
+void getDelta(Input &in, std::array<int, N> &state) {
+    const auto mask = in.varint();
+    for (std::size_t i = 0; i < N; ++i)
+        if (mask & (1u << i))
+            state[i] += in.signedValue();
+}
+
+Record::Unit capture(const Unit &unit) {
+    using namespace Record;
+
+    Record::Unit fields;
+    fields[player] = unit->getPlayer()->getID();
+    fields[type] = unit->getType();
+    fields[positionX] = unit->getPosition().x;
+    fields[positionY] = unit->getPosition().y;
+    fields[hitPoints] = unit->getHitPoints();
+    fields[shields] = unit->getShields();
+    fields[resources] = unit->getResources();
+    fields[order] = unit->getOrder();
+    fields[orderTargetX] = unit->getOrderTargetPosition().x;
+    fields[orderTargetY] = unit->getOrderTargetPosition().y;
+    fields[remainingBuildTime] = unit->getRemainingBuildTime();
+    fields[transport] = unit->getTransport() != nullptr ? unit->getTransport()->getID() : -1;
+
+    const std::pair<bool, UnitFlag> unitFlags[] = {
+        {unit->isCompleted(), completed},       {unit->isIdle(), idle},
+        {unit->isUnderAttack(), underAttack},   {unit->isLifted(), lifted},
+        {unit->isLockedDown(), lockedDown},     {unit->isMaelstrommed(), maelstrommed},
+        {unit->isStasised(), stasised},         {unit->isPowered(), powered},
+        {unit->isStuck(), stuck},
+    };
+    fields[flags] = 0;
+    for (const auto &flag : unitFlags)
+        if (flag.first)
+            fields[flags] |= flag.second;
+    return fields;
+}
+
+Record::Player capture(const Player &player) {
+    using namespace Record;
+
+    Record::Player fields;
+    fields[minerals] = player->minerals();
+    fields[gas] = player->gas();
+    for (int race = 0; race < 3; ++race) {
+        fields[supplyUsed + race] = player->supplyUsed(Race(race));
+        fields[supplyTotal + race] = player->supplyTotal(Race(race));
+    }
+    return fields;
+}
+
+} // namespace
+
+bool Recorder::start(const std::string &path) {
+    finish();
+    m_file.open(path, std::ios::binary);
+    if (!m_file)
+        return false;
+
+    m_frames = 0;
+    m_playerCount = 0;
+    m_units.clear();
+    m_previousUnits.clear();
+    m_present.clear();
+    m_previousPresent.clear();
+    m_index.clear();
+
+    m_file.write(magic, sizeof(magic));
+    write(m_file, version);
+    write(m_file, Broodwar->mapHash());
+    write(m_file, Broodwar->mapFileName());
+    const auto id = [](const Player &player) { return player != nullptr ? player->getID() : -1; };
+    write(m_file, (std::int32_t) id(Broodwar->self()));
+    write(m_file, (std::int32_t) id(Broodwar->enemy()));
+    write(m_file, (std::int32_t) id(Broodwar->neutral()));
+
+    std::vector<Record::PlayerInfo> players;
+    for (const auto &player : Broodwar->getPlayers()) {
+        if (player->getID() >= (int) players.size())
+            players.resize(player->getID() + 1, {"", Races::None, PlayerTypes::None, {}, false});
+        players[player->getID()] = {player->getName(), player->getRace(), player->getType(),
+                                    player->getStartLocation(), player->isNeutral()};
+    }
+    m_playerCount = (int) players.size();
+    m_players.assign(players.size(), Record::Player{});
+    write(m_file, (std::int32_t) players.size());
+    for (const auto &player : players) {
+        write(m_file, player.name);
+        write(m_file, (std::int32_t) player.race);
+        write(m_file, (std::int32_t) player.type);
+        write(m_file, (std::int32_t) player.startLocation.x);
+        write(m_file, (std::int32_t) player.startLocation.y);
+        write(m_file, (std::int32_t) player.neutral);
+    }
+
+    return (bool) m_file;
+}
+
+void Recorder::record() {
+    if (!isRecording())
+        return;
+    KBOT_PROFILE("Recorder::record");
+
+    const int  frame = Broodwar->getFrameCount();
+    const bool isKeyframe = m_frames++ % Record::keyframeInterval == 0;
+    m_block.clear();
+
+    // Events
+    const auto &events = Broodwar->getEvents();
+    putVarint(m_block, (std::uint32_t) events.size());
+    for (const auto &event : events) {
+        putVarint(m_block, event.getType());
+        putSigned(m_block, event.getUnit() != nullptr ? event.getUnit()->getID() : -1);
+        putSigned(m_block, event.getPlayer() != nullptr ? event.getPlayer()->getID() : -1);
+        putSigned(m_block, event.getPosition().x);
+        putSigned(m_block, event.getPosition().y);
+        putVarint(m_block, event.isWinner());
+        putString(m_block, event.getText());
+    }
+
+    // Players
+    std::string   section;
+    std::uint32_t count = 0;
+    for (const auto &player : Broodwar->getPlayers()) {
+        const auto id = player->getID();
+        if (id >= m_playerCount)
+            continue;
+        const auto state = capture(player);
+        if (putDelta(section, id, state, isKeyframe ? Record::Player{} : m_players[id], isKeyframe))
+            ++count;
+        m_players[id] = state;
+    }
+    putVarint(m_block, count);
+    m_block += section;
+
+    // Units
+    std::swap(m_units, m_previousUnits);
+    std::swap(m_present, m_previousPresent);
+    std::fill(m_present.begin(), m_present.end(), 0);
+    for (const auto &unit : Broodwar->getAllUnits()) {
+        const auto id = (std::size_t) unit->getID();
+        if (id >= m_units.size()) {
+            m_units.resize(id + 1);
+            m_present.resize(id + 1, 0);
+        }
+        m_units[id] = capture(unit);
+        m_present[id] = 1;
+    }
+    if (m_previousPresent.size() < m_present.size()) {
+        m_previousUnits.resize(m_present.size());
+        m_previousPresent.resize(m_present.size(), 0);
+    }
+
+    section.clear();
+    count = 0;
+    for (std::size_t id = 0; id < m_present.size(); ++id) {
+        if (!m_present[id])
+            continue;
+        const bool isNew = isKeyframe || !m_previousPresent[id];
+        if (putDelta(section, (int) id, m_units[id],
+                     isNew ? Record::Unit{} : m_previousUnits[id], isNew))
+            ++count;
+    }
+    putVarint(m_block, count);
+    m_block += section;
+
+    // A keyframe replaces the whole state, so there is nothing to remove.
+    section.clear();
+    count = 0;
+    for (std::size_t id = 0; !isKeyframe && id < m_previousPresent.size(); ++id)
+        if (m_previousPresent[id] && (id >= m_present.size() || !m_present[id])) {
+            putVarint(section, (std::uint32_t) id);
+            ++count;
+        }
+    putVarint(m_block, count);
+    m_block += section;
+
+    // Block
+    if (isKeyframe)
+        m_index.emplace_back(frame, (std::int64_t) m_file.tellp());
+    std::string header(1, isKeyframe ? keyframe : delta);
+    putVarint(header, frame);
+    putVarint(header, (std::uint32_t) m_block.size());
+    m_file.write(header.data(), header.size());
+    m_file.write(m_block.data(), m_block.size());
+}
+
+void Recorder::finish() {
+    if (!isRecording())
+        return;
+
+    const auto indexOffset = (std::int64_t) m_file.tellp();
+    write(m_file, (std::int32_t) m_index.size());
+    for (const auto &entry : m_index) {
+        write(m_file, (std::int32_t) entry.first);
+        write(m_file, entry.second);
+    }
+    write(m_file, indexOffset);
+    m_file.write(footerMagic, sizeof(footerMagic));
+    m_file.close();
+}
+
+bool Recording::open(const std::string &path) {
+    m_file.close();
+    m_file.clear();
+    m_file.open(path, std::ios::binary);
+    char fileMagic[sizeof(magic)] = {};
+    m_file.read(fileMagic, sizeof(fileMagic));
+    if (!m_file || !std::equal(magic, magic + sizeof(magic), fileMagic) ||
+        read<std::int32_t>(m_file) != version)
+        return false;
+
+    m_header = {};
+    m_header.mapHash = readString(m_file);
+    m_header.mapName = readString(m_file);
+    m_header.self = read<std::int32_t>(m_file);
+    m_header.enemy = read<std::int32_t>(m_file);
+    m_header.neutral = read<std::int32_t>(m_file);
+    const auto playerCount = read<std::int32_t>(m_file);
+    if (!m_file || playerCount < 0 || playerCount > 12)
+        return false;
+    m_header.players.resize(playerCount);
+    for (auto &player : m_header.players) {
+        player.name = readString(m_file);
+        player.race = read<std::int32_t>(m_file);
+        player.type = read<std::int32_t>(m_file);
+        player.startLocation.x = read<std::int32_t>(m_file);
+        player.startLocation.y = read<std::int32_t>(m_file);
+        player.neutral = read<std::int32_t>(m_file) != 0;
+    }
+    if (!m_file)
+        return false;
+    m_firstBlock = m_file.tellg();
+
+    // The frame index is read from the footer. If the game did not end properly, there is none
+    // and the index is rebuilt by scanning the blocks.
+    m_index.clear();
+    m_file.seekg(0, std::ios::end);
+    m_blocksEnd = m_file.tellg();
+    m_file.seekg(-footerSize, std::ios::end);
+    const auto indexOffset = read<std::int64_t>(m_file);
+    char       fileFooter[sizeof(footerMagic)] = {};
+    m_file.read(fileFooter, sizeof(fileFooter));
+    if (m_file && std::equal(footerMagic, footerMagic + sizeof(footerMagic), fileFooter) &&
+        m_firstBlock <= indexOffset && indexOffset < m_blocksEnd) {
+        m_file.seekg(indexOffset);
+        const auto count = read<std::int32_t>(m_file);
+        for (int i = 0; m_file && i < count; ++i) {
+            const auto frame = read<std::int32_t>(m_file);
+            m_index.emplace_back(frame, read<std::int64_t>(m_file));
+        }
+        m_blocksEnd = indexOffset;
+    } else {
+        m_file.clear();
+        m_file.seekg(m_firstBlock);
+        for (;;) {
+            const auto    offset = (std::int64_t) m_file.tellg();
+            const int     kind = m_file.get();
+            std::uint32_t frame, size;
+            if (!readVarint(m_file, frame) || !readVarint(m_file, size) ||
+                (std::int64_t) size > m_blocksEnd - (std::int64_t) m_file.tellg())
+                break; // end of the record, possibly a truncated block
+            if (kind == keyframe)
+                m_index.emplace_back((int) frame, offset);
+            m_file.seekg(size, std::ios::cur);
+        }
+    }
+
+    m_file.clear();
+    m_file.seekg(m_firstBlock);
+    reset();
+    return (bool) m_file;
+}
+
+bool Recording::next() {
+    if ((std::int64_t) m_file.tellg() >= m_blocksEnd)
+        return false;
+
+    const int     kind = m_file.get();
+    std::uint32_t frame, size;
+    if (!readVarint(m_file, frame) || !readVarint(m_file, size) ||
+        (std::int64_t) size > m_blocksEnd - (std::int64_t) m_file.tellg())
+        return false;
+    m_block.resize(size);
+    m_file.read(&m_block[0], size);
+    if (!m_file)
+        return false;
+
+    Input      in(m_block);
+    const bool isKeyframe = kind == keyframe;
+
+    // Events
+    m_events.resize(in.varint());
+    for (auto &event : m_events) {
+        event.type = (EventType::Enum) in.varint();
+        event.unit = in.signedValue();
+        event.player = in.signedValue();
+        event.position.x = in.signedValue();
+        event.position.y = in.signedValue();
+        event.winner = in.varint() != 0;
+        event.text = in.string();
+    }
+
+    // Players
+    for (auto count = in.varint(); in.ok() && count > 0; --count) {
+        const auto id = in.varint();
+        if (id >= m_players.size())
+            m_players.resize(id + 1);
+        if (isKeyframe)
+            m_players[id] = {};
+        getDelta(in, m_players[id]);
+    }
+
+    // Units
+    std::vector<std::uint8_t> previousPresent;
+    if (isKeyframe) {
+        previousPresent = m_present;
+        std::fill(m_present.begin(), m_present.end(), 0);
+    }
+    m_changed.clear();
+    for (auto count = in.varint(); in.ok() && count > 0; --count) {
+        const auto id = in.varint();
+        if (id >= 10000) // BWAPI unit ids
+            return false;
+        if (id >= m_units.size()) {
+            m_units.resize(id + 1);
+            m_present.resize(id + 1, 0);
+        }
+        if (!m_present[id])
+            m_units[id] = {};
+        getDelta(in, m_units[id]);
+        m_present[id] = 1;
+        m_changed.push_back((int) id);
+    }
+
+    m_removed.clear();
+    for (auto count = in.varint(); in.ok() && count > 0; --count) {
+        const auto id = in.varint();
+        if (id < m_present.size() && m_present[id]) {
+            m_present[id] = 0;
+            m_removed.push_back((int) id);
+        }
+    }
+    for (std::size_t id = 0; id < previousPresent.size(); ++id)
+        if (previousPresent[id] && !m_present[id])
+            m_removed.push_back((int) id);
+
+    m_frame = (int) frame;
+    return in.ok();
+}
+
+bool Recording::seek(int frame) {
+    const auto entry = std::upper_bound(
+        m_index.begin(), m_index.end(), frame,
+        [](int frame, const std::pair<int, std::int64_t> &entry) { return frame < entry.first; });
+    if (entry == m_index.begin())
+        return false;
+
+    m_file.clear();
+    m_file.seekg(std::prev(entry)->second);
+    reset();
+    while (m_frame < frame)
+        if (!next())
+            return false;
+    return m_frame == frame;
+}
+
+void Recording::reset() {
+    m_frame = -1;
+    m_events.clear();
+    m_changed.clear();
+    m_removed.clear();
+    m_units.clear();
+    m_present.clear();
+    m_players.clear();
+}
+
+} // namespace
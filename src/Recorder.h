@@ -0,0 +1,174 @@
+#pragma once
+
+// Compile-time switch: build with KBOT_RECORDER=0 to stop main.cpp from recording the games.
+#ifndef KBOT_RECORDER
+#define KBOT_RECORDER 1
+#endif
+
+#include <BWAPI.h>
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace KBot {
+
+// The content of a game record, shared by the Recorder and the Recording.
+//
+// File layout: a header, then one block per frame, then the frame index and a footer. Every
+// keyframeInterval frames, a keyframe block holds the full state. The other blocks hold the
+// changes since the previous frame: the changed fields of the units and players (as varint deltas
+// behind a bit mask) and the units that are no longer accessible. The index lists the keyframes
+// with their offset in the file, so a reader can seek to any frame. Integers are little-endian.
+namespace Record {
+
+const int keyframeInterval = 240;
+
+// The unit fields the bot reads, see Snapshot and readyToAcceptOrders().
+enum UnitField {
+    player,
+    type,
+    positionX,
+    positionY,
+    hitPoints,
+    shields,
+    resources,
+    order,
+    orderTargetX,
+    orderTargetY,
+    remainingBuildTime,
+    transport, // unit id, or -1
+    flags,
+    unitFieldCount
+};
+enum UnitFlag {
+    completed = 1 << 0,
+    idle = 1 << 1,
+    underAttack = 1 << 2,
+    lifted = 1 << 3,
+    lockedDown = 1 << 4,
+    maelstrommed = 1 << 5,
+    stasised = 1 << 6,
+    powered = 1 << 7,
+    stuck = 1 << 8,
+};
+using Unit = std::array<int, unitFieldCount>;
+
+// Per race: Zerg, Terran, Protoss (BWAPI race ids)
+enum PlayerField {
+    minerals,
+    gas,
+    supplyUsed,
+    supplyTotal = supplyUsed + 3,
+    playerFieldCount = supplyTotal + 3
+};
+using Player = std::array<int, playerFieldCount>;
+
+struct PlayerInfo {
+    std::string         name;
+    int                 race;
+    int                 type;
+    BWAPI::TilePosition startLocation;
+    bool                neutral;
+};
+
+struct Header {
+    std::string             mapHash;
+    std::string             mapName;
+    int                     self = -1; // player ids
+    int                     enemy = -1;
+    int                     neutral = -1;
+    std::vector<PlayerInfo> players; // indexed by player id
+};
+
+struct Event {
+    BWAPI::EventType::Enum type;
+    int                    unit = -1; // unit id
+    int                    player = -1; // player id
+    BWAPI::Position        position;
+    bool                   winner = false;
+    std::string            text;
+};
+
+} // namespace Record
+
+// Records the event stream and the unit state of a game, as seen by the bot, frame by frame. A
+// record can be replayed offline by tools/headless, to profile the frames of a tournament game.
+class Recorder {
+public:
+    ~Recorder() { finish(); }
+
+    // Starts a record of the current game. Returns false if the file cannot be written.
+    bool start(const std::string &path);
+
+    // Records the events and the state of the current frame. Call before dispatching the events.
+    void record();
+
+    // Writes the frame index. Called by the destructor.
+    void finish();
+
+    bool isRecording() const { return m_file.is_open(); }
+
+private:
+    std::ofstream m_file;
+    int           m_frames = 0;
+
+    // State of the current and the previous frame, indexed by id. m_present marks the units that
+    // are accessible.
+    int                         m_playerCount = 0;
+    std::vector<Record::Unit>   m_units, m_previousUnits;
+    std::vector<std::uint8_t>   m_present, m_previousPresent;
+    std::vector<Record::Player> m_players;
+
+    std::vector<std::pair<int, std::int64_t>> m_index; // keyframes: frame, offset
+    std::string                               m_block;
+};
+
+// Reads a record, frame by frame. After next(), the current state holds the units and players at
+// the beginning of that frame.
+class Recording {
+public:
+    // Opens a record and reads its header. Returns false if the file is not a valid record.
+    bool open(const std::string &path);
+
+    const Record::Header &header() const { return m_header; }
+
+    // Reads the next frame. Returns false at the end of the record.
+    bool next();
+
+    // Goes to the last keyframe before or at frame, then reads up to it. Returns false if the
+    // frame is not part of the record. Afterwards, only the state is complete: the changed and
+    // removed units are those of the last frame read.
+    bool seek(int frame);
+
+    // State after the last call to next()
+    int                                frame() const { return m_frame; }
+    const std::vector<Record::Event> & events() const { return m_events; }
+    const std::vector<int> &           changedUnits() const { return m_changed; } // incl. new
+    const std::vector<int> &           removedUnits() const { return m_removed; }
+    int                                unitIds() const { return (int) m_present.size(); }
+    bool                               isPresent(int id) const { return m_present[id] != 0; }
+    const Record::Unit &               unit(int id) const { return m_units[id]; }
+    const std::vector<Record::Player> &players() const { return m_players; }
+
+private:
+    void reset();
+
+    std::ifstream m_file;
+    std::int64_t  m_firstBlock = 0;
+    std::int64_t  m_blocksEnd = 0;
+
+    Record::Header                            m_header;
+    std::vector<std::pair<int, std::int64_t>> m_index; // keyframes: frame, offset
+
+    int                         m_frame = -1;
+    std::vector<Record::Event>  m_events;
+    std::vector<int>            m_changed, m_removed;
+    std::vector<Record::Unit>   m_units;
+    std::vector<std::uint8_t>   m_present;
+    std::vector<Record::Player> m_players;
+    std::string                 m_block;
+};
+
+} // namespace
@@ -0,0 +1,37 @@
+#include "ResourceLedger.h"
+
+#include <cassert>
+
+namespace KBot {
+
+void ResourceLedger::dequeue(BuildTask::Priority priority) {
+    const auto it = m_waiting.find(priority);
+    assert(it != m_waiting.end());
+    if (--it->second == 0)
+        m_waiting.erase(it);
+}
+
+bool ResourceLedger::reserve(int minerals, int gas, BuildTask::Priority priority,
+                             int stockMinerals, int stockGas) {
+    // All higher tasks have to have their resources allocated, otherwise fail!
+    if (higherPriorityWaiting(priority))
+        return false;
+
+    // Allocate resources if available.
+    if (stockMinerals - m_reservedMinerals >= minerals && stockGas - m_reservedGas >= gas) {
+        m_reservedMinerals += minerals;
+        m_reservedGas += gas;
+        dequeue(priority);
+        return true;
+    }
+    return false;
+}
+
+void ResourceLedger::release(int minerals, int gas) {
+    m_reservedMinerals -= minerals;
+    m_reservedGas -= gas;
+    assert(m_reservedMinerals >= 0);
+    assert(m_reservedGas >= 0);
+}
+
+} // namespace
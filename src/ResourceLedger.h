@@ -0,0 +1,42 @@
+#pragma once
+
+#include "BuildTask.h"
+#include <map>
+
+namespace KBot {
+
+// Bookkeeping of the minerals and gas reserved by build tasks. Tasks with different priorities
+// allocate in order (see BuildTask::Priority), so the ledger counts the tasks still waiting for
+// their resources per priority. Whether a higher task is waiting is answered in O(log n) instead
+// of walking the build queue.
+class ResourceLedger {
+public:
+    // Registers a task that will request its resources (Manager::addBuildTask).
+    void enqueue(BuildTask::Priority priority) { ++m_waiting[priority]; }
+
+    // Unregisters a waiting task that will not request its resources any more.
+    void dequeue(BuildTask::Priority priority);
+
+    // Returns whether a task with a higher priority is still waiting for its resources.
+    bool higherPriorityWaiting(BuildTask::Priority priority) const {
+        return m_waiting.upper_bound(priority) != m_waiting.end();
+    }
+
+    // Reserves the resources of a waiting task if no higher task is waiting and enough of
+    // the given stock is unreserved. On success, the task is no longer waiting.
+    bool reserve(int minerals, int gas, BuildTask::Priority priority, int stockMinerals,
+                 int stockGas);
+
+    // Releases resources reserved before.
+    void release(int minerals, int gas);
+
+    int reservedMinerals() const { return m_reservedMinerals; }
+    int reservedGas() const { return m_reservedGas; }
+
+private:
+    std::map<BuildTask::Priority, int> m_waiting; // number of waiting tasks, none with count 0
+    int                                m_reservedMinerals = 0;
+    int                                m_reservedGas = 0;
+};
+
+} // namespace
@@ -0,0 +1,60 @@
+#include "Scheduler.h"
+
+#include "Profiler.h"
+#include <algorithm>
+
+namespace KBot {
+
+bool Scheduler::submit(const std::string &name, Priority priority, Job job) {
+    const auto sameName = [&name](const Entry &entry) { return entry.name == name; };
+    if (std::any_of(m_jobs.begin(), m_jobs.end(), sameName) ||
+        std::any_of(m_submitted.begin(), m_submitted.end(), sameName))
+        return false;
+
+    if (m_running)
+        m_submitted.push_back({name, priority, std::move(job)});
+    else
+        insert({name, priority, std::move(job)});
+    return true;
+}
+
+void Scheduler::run(std::chrono::steady_clock::time_point frameStart) {
+    KBOT_PROFILE("Scheduler::run");
+
+    using Clock = std::chrono::steady_clock;
+    const auto start = Clock::now();
+    const auto deadline = frameStart + m_budget;
+
+    m_running = true;
+    m_lastSteps = 0;
+    for (auto it = m_jobs.begin(); it != m_jobs.end();) {
+        // Run steps of the same job until it is done or the budget is spent.
+        bool done = false;
+        do {
+            done = it->job();
+            ++m_lastSteps;
+        } while (!done && Clock::now() < deadline);
+
+        if (done)
+            it = m_jobs.erase(it);
+        if (Clock::now() >= deadline)
+            break;
+    }
+    m_running = false;
+
+    for (auto &entry : m_submitted)
+        insert(std::move(entry));
+    m_submitted.clear();
+
+    m_lastTime = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start);
+}
+
+void Scheduler::insert(Entry entry) {
+    // After all jobs with the same or a higher priority.
+    const auto position = std::find_if(m_jobs.begin(), m_jobs.end(), [&entry](const Entry &e) {
+        return e.priority < entry.priority;
+    });
+    m_jobs.insert(position, std::move(entry));
+}
+
+} // namespace
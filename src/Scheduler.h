@@ -0,0 +1,58 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace KBot {
+
+// Cooperative scheduler for the work that does not have to be done within a specific frame.
+// Modules submit resumable jobs, which are run in steps by run() at the end of each frame, highest
+// priority first, until the frame has used up its time budget. Unfinished jobs are carried over to
+// the next frame, so that the expensive work is spread instead of landing on the same frames.
+class Scheduler {
+public:
+    enum class Priority : int { low = -100, normal = 0, high = 100 };
+
+    // Does a bounded amount of work per call. Returns true when the job is done.
+    using Job = std::function<bool()>;
+
+    // Queues a job, unless a job with the same name is still pending. Jobs with the same priority
+    // run in order of submission. Jobs submitted by a running job are queued after run() returns.
+    // Returns whether the job was queued.
+    bool submit(const std::string &name, Priority priority, Job job);
+
+    // Called every KBot::onFrame(), with the time the frame started. Runs steps of the pending jobs
+    // until the frame has taken the budget. At least one step is run, so that every frame makes
+    // progress.
+    void run(std::chrono::steady_clock::time_point frameStart);
+
+    // Time a frame may take, from its start, before the jobs stop.
+    void                      setBudget(std::chrono::microseconds budget) { m_budget = budget; }
+    std::chrono::microseconds getBudget() const { return m_budget; }
+
+    std::size_t pending() const { return m_jobs.size() + m_submitted.size(); }
+
+    // Statistics of the last run().
+    int                       lastSteps() const { return m_lastSteps; }
+    std::chrono::microseconds lastTime() const { return m_lastTime; }
+
+private:
+    struct Entry {
+        std::string name;
+        Priority    priority;
+        Job         job;
+    };
+
+    void insert(Entry entry);
+
+    std::vector<Entry>        m_jobs;      // ordered by priority (highest first), then submission
+    std::vector<Entry>        m_submitted; // during run()
+    bool                      m_running = false;
+    std::chrono::microseconds m_budget = std::chrono::milliseconds(15); // < Watchdog::relaxTime
+    int                       m_lastSteps = 0;
+    std::chrono::microseconds m_lastTime = std::chrono::microseconds(0);
+};
+
+} // namespace
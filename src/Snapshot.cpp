@@ -0,0 +1,102 @@
+#include "Snapshot.h"
+
+#include "Profiler.h"
+#include "utils.h"
+
+namespace KBot {
+
+using namespace BWAPI;
+
+void Snapshot::capture() {
+    KBOT_PROFILE("Snapshot::capture");
+
+    m_frame = Broodwar->getFrameCount();
+
+    for (const auto &unit : m_units)
+        if (unit->getID() < (int) m_idOf.size())
+            m_idOf[unit->getID()] = none;
+
+    m_units.clear();
+    m_positions.clear();
+    m_types.clear();
+    m_players.clear();
+    m_orders.clear();
+    m_orderTargets.clear();
+    m_resources.clear();
+    m_flags.clear();
+
+    const auto self = Broodwar->self();
+    for (const auto &unit : Broodwar->getAllUnits()) {
+        const auto index = unit->getID();
+        if (index >= (int) m_idOf.size())
+            m_idOf.resize(index + 1, none);
+        m_idOf[index] = (Id) m_units.size();
+
+        std::uint8_t flags = 0;
+        if (unit->isIdle())
+            flags |= idle;
+        if (unit->isCompleted())
+            flags |= completed;
+        if (unit->isUnderAttack())
+            flags |= underAttack;
+        if (self->isEnemy(unit->getPlayer()))
+            flags |= enemy;
+        if (unit->getPlayer() == self && ::KBot::readyToAcceptOrders(unit))
+            flags |= ready;
+
+        m_units.push_back(unit);
+        m_positions.push_back(unit->getPosition());
+        m_types.push_back(unit->getType());
+        m_players.push_back(unit->getPlayer());
+        m_orders.push_back(unit->getOrder());
+        m_orderTargets.push_back(unit->getOrderTargetPosition());
+        m_resources.push_back(unit->getResources());
+        m_flags.push_back(flags);
+    }
+}
+
+Position Snapshot::position(const Unit &unit) const {
+    const auto i = id(unit);
+    return i != none ? m_positions[i] : unit->getPosition();
+}
+
+UnitType Snapshot::type(const Unit &unit) const {
+    const auto i = id(unit);
+    return i != none ? m_types[i] : unit->getType();
+}
+
+Order Snapshot::order(const Unit &unit) const {
+    const auto i = id(unit);
+    return i != none ? m_orders[i] : unit->getOrder();
+}
+
+Position Snapshot::orderTargetPosition(const Unit &unit) const {
+    const auto i = id(unit);
+    return i != none ? m_orderTargets[i] : unit->getOrderTargetPosition();
+}
+
+bool Snapshot::isIdle(const Unit &unit) const {
+    const auto i = id(unit);
+    return i != none ? isIdle(i) : unit->isIdle();
+}
+
+bool Snapshot::isUnderAttack(const Unit &unit) const {
+    const auto i = id(unit);
+    return i != none ? isUnderAttack(i) : unit->isUnderAttack();
+}
+
+bool Snapshot::readyToAcceptOrders(const Unit &unit) const {
+    const auto i = id(unit);
+    return i != none && m_players[i] == Broodwar->self() ? readyToAcceptOrders(i)
+                                                          : ::KBot::readyToAcceptOrders(unit);
+}
+
+bool Snapshot::gasAvailable(const Unit &gas) const {
+    const auto i = id(gas);
+    if (i == none)
+        return ::KBot::gasAvailable(gas);
+    return m_types[i].isRefinery() && m_players[i] == Broodwar->self() && isCompleted(i) &&
+           m_resources[i] > 0;
+}
+
+} // namespace
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <BWAPI.h>
+#include <cstdint>
+#include <vector>
+
+namespace KBot {
+
+// Copy of the unit state the bot reads, taken once at the beginning of KBot::onFrame(). The
+// fields of the accessible units are stored as structure of arrays, indexed by a dense id, so that
+// the modules get one consistent view per frame and scan contiguous memory instead of going
+// through the BWAPI client for every accessor call.
+//
+// Units that are not part of the snapshot (e.g. created by an event handler after it was taken)
+// are read from BWAPI directly by the per-unit accessors.
+class Snapshot {
+public:
+    using Id = int;
+    static const Id none = -1;
+
+    // Copies the state of all accessible units.
+    void capture();
+
+    // Frame at which the snapshot was taken.
+    int frame() const { return m_frame; }
+
+    // Number of units, i.e. the valid ids are [0, size()).
+    Id size() const { return (Id) m_units.size(); }
+
+    // Returns the dense id of the unit in this snapshot, or none.
+    Id id(const BWAPI::Unit &unit) const {
+        const auto index = unit->getID();
+        return index >= 0 && index < (int) m_idOf.size() ? m_idOf[index] : none;
+    }
+
+    // Per id (structure of arrays)
+    const std::vector<BWAPI::Unit> &     units() const { return m_units; }
+    const std::vector<BWAPI::Position> & positions() const { return m_positions; }
+    const std::vector<BWAPI::UnitType> & types() const { return m_types; }
+    const std::vector<BWAPI::Player> &   players() const { return m_players; }
+    const std::vector<BWAPI::Order> &    orders() const { return m_orders; }
+    const std::vector<BWAPI::Position> & orderTargetPositions() const { return m_orderTargets; }
+    const std::vector<int> &             resources() const { return m_resources; }
+    const std::vector<std::uint8_t> &    flags() const { return m_flags; }
+
+    bool isIdle(Id id) const { return (m_flags[id] & idle) != 0; }
+    bool isCompleted(Id id) const { return (m_flags[id] & completed) != 0; }
+    bool isUnderAttack(Id id) const { return (m_flags[id] & underAttack) != 0; }
+    bool isEnemy(Id id) const { return (m_flags[id] & enemy) != 0; }
+    bool readyToAcceptOrders(Id id) const { return (m_flags[id] & ready) != 0; }
+
+    // Per unit, with a fallback on BWAPI for the units not in the snapshot.
+    BWAPI::Position position(const BWAPI::Unit &unit) const;
+    BWAPI::UnitType type(const BWAPI::Unit &unit) const;
+    BWAPI::Order    order(const BWAPI::Unit &unit) const;
+    BWAPI::Position orderTargetPosition(const BWAPI::Unit &unit) const;
+    bool            isIdle(const BWAPI::Unit &unit) const;
+    bool            isUnderAttack(const BWAPI::Unit &unit) const;
+    bool            readyToAcceptOrders(const BWAPI::Unit &unit) const;
+    bool            gasAvailable(const BWAPI::Unit &gas) const; // see utils.h
+
+private:
+    enum Flag : std::uint8_t {
+        idle = 1 << 0,
+        completed = 1 << 1,
+        underAttack = 1 << 2,
+        enemy = 1 << 3,
+        ready = 1 << 4, // see KBot::readyToAcceptOrders()
+    };
+
+    int m_frame = -1;
+
+    std::vector<Id> m_idOf; // indexed by BWAPI::Unit::getID()
+
+    std::vector<BWAPI::Unit>     m_units;
+    std::vector<BWAPI::Position> m_positions;
+    std::vector<BWAPI::UnitType> m_types;
+    std::vector<BWAPI::Player>   m_players;
+    std::vector<BWAPI::Order>    m_orders;
+    std::vector<BWAPI::Position> m_orderTargets;
+    std::vector<int>             m_resources;
+    std::vector<std::uint8_t>    m_flags;
+};
+
+} // namespace
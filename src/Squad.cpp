@@ -1,6 +1,8 @@
 #include "Squad.h"
 
 #include "KBot.h"
+#include "Profiler.h"
+#include "Watchdog.h"
 #include "utils.h"
 #include <stdexcept>
 
@@ -8,28 +10,51 @@ namespace KBot {
 
 using namespace BWAPI;
 
-Squad::Squad(KBot &kBot) : m_kBot(&kBot), m_state(State::scout) {}
+Squad::Squad(KBot &kBot)
+    : m_kBot(&kBot), m_state(State::scout),
+      m_timing(kBot.periodic().add(PeriodicTasks::Kind::squad)) {}
+
+Position Squad::getPosition() const {
+    // Cached for the frame of the snapshot, as the squads query it a lot.
+    const auto &snapshot = m_kBot->snapshot();
+    if (m_positionFrame != snapshot.frame() || m_positionSize != size()) {
+        Position sum(0, 0);
+        for (const auto &unit : *this)
+            sum += snapshot.position(unit);
+        m_position = empty() ? Positions::Invalid : sum / (int) size();
+        m_positionFrame = snapshot.frame();
+        m_positionSize = size();
+    }
+    return m_position;
+}
 
 void Squad::update() {
-    if (!empty()) {
+    KBOT_PROFILE("Squad::update");
+
+    const auto &snapshot = m_kBot->snapshot();
+    const auto &watchdog = Watchdog::instance();
+
+    // Display debug information
+    if (!empty() && watchdog.drawDebug()) {
         // Draw squad radius
         Broodwar->drawCircleMap(getPosition(), 400, Colors::Red);
         Broodwar->drawTextMap(getPosition(), "Squad: %s", to_string(m_state).c_str());
 
         // Show membership
         for (const auto &unit : *this)
-            Broodwar->drawLineMap(getPosition(), unit->getPosition(), Colors::Grey);
+            Broodwar->drawLineMap(getPosition(), snapshot.position(unit), Colors::Grey);
 
         // Draw path to enemy
         if (m_kBot->enemy().getPositionCount() > 0) {
             const auto enemyPosition = Position(m_kBot->enemy().getClosestPosition());
             const auto path = m_kBot->map().GetPath(getPosition(), enemyPosition);
             if (!path.empty()) {
-                Broodwar->drawLineMap(getPosition(), Position(path.front()->Center()), Colors::Red);
-                for (std::size_t i = 1; i < path.size(); ++i)
-                    Broodwar->drawLineMap(Position(path[i - 1]->Center()),
-                                          Position(path[i]->Center()), Colors::Red);
-                Broodwar->drawLineMap(Position(path.back()->Center()), enemyPosition, Colors::Red);
+                auto previous = getPosition();
+                for (const auto choke : path) {
+                    Broodwar->drawLineMap(previous, Position(choke->Center()), Colors::Red);
+                    previous = Position(choke->Center());
+                }
+                Broodwar->drawLineMap(previous, enemyPosition, Colors::Red);
             } else
                 Broodwar->drawLineMap(getPosition(), enemyPosition, Colors::Red);
         }
@@ -37,12 +62,10 @@ void Squad::update() {
 
     // ----- Prevent spamming -----------------------------------------------
     // Everything below is executed only occasionally and not on every frame.
-    if (Broodwar->getFrameCount() % Broodwar->getLatencyFrames() != 0)
+    if (!m_kBot->periodic().due(m_timing))
         return;
 
-    // TODO: remove
-    const auto enemiesNearBase = Broodwar->getUnitsInRadius(
-        Position(Broodwar->self()->getStartLocation()), 1000, Filter::IsEnemy);
+    const auto &enemiesNearBase = m_kBot->general().enemiesNearBase();
 
     // Update squad state
     const auto oldState = m_state;
@@ -80,42 +103,51 @@ void Squad::update() {
     if (m_state != oldState)
         this->stop();
 
+    // Drop the paths of the units which left the squad
+    for (auto it = m_paths.begin(); it != m_paths.end();) {
+        if (count(it->first) == 0)
+            it = m_paths.erase(it);
+        else
+            ++it;
+    }
+
     // TODO: Move unit logic
     for (const auto &unit : *this) {
         assert(unit->exists());
 
-        // Ignore the unit if it has one of the following status ailments
-        if (unit->isLockedDown() || unit->isMaelstrommed() || unit->isStasised())
+        // Ignore the unit if it has some status ailment or is in a state preventing orders
+        if (!snapshot.readyToAcceptOrders(unit))
             continue;
 
-        // Ignore the unit if it is in one of the following states
-        if (unit->isLoaded() || !unit->isPowered() || unit->isStuck())
-            continue;
-
-        if (unit->getType() == UnitTypes::Terran_Marine) {
-            int          unitPathLength;
-            BWEM::CPPath unitPath;
+        const auto unitPosition = snapshot.position(unit);
+        if (snapshot.type(unit) == UnitTypes::Terran_Marine) {
+            int      unitPathLength;
+            Position lastNode;
 
             switch (m_state) {
             case State::scout:
-                if (unit->isIdle())
+                if (snapshot.isIdle(unit))
                     // Scout!
                     unit->attack(Position(m_kBot->enemy().getClosestPosition()));
                 break;
-            case State::attack:
-                unitPath =
-                    m_kBot->map().GetPath(unit->getPosition(), getPosition(), &unitPathLength);
-                if (unitPathLength > 400 && !unit->isUnderAttack()) {
+            case State::attack: {
+                const auto path = m_paths.find(unit);
+                if (watchdog.reducePathing() || path == m_paths.end()) {
+                    // Under time pressure, or until the path is refreshed, use the memoized ground
+                    // distance instead of a path and regroup straight towards the squad.
+                    unitPathLength = distance(unitPosition, getPosition());
+                    lastNode = unitPosition;
+                } else {
+                    unitPathLength = path->second.length;
+                    lastNode = path->second.lastNode == Positions::None ? unitPosition
+                                                                        : path->second.lastNode;
+                }
+                if (unitPathLength > 400 && !snapshot.isUnderAttack(unit)) {
                     // Regroup!
                     // Prevent spamming, check if order is already set. TODO: Still bad bahavior.
-                    if (unit->getOrder() != Orders::AttackMove ||
-                        distance(unit->getOrderTargetPosition(), getPosition()) >= 400) {
-                        Position orderPosition, lastNode;
-                        if (unitPath.empty())
-                            lastNode = unit->getPosition();
-                        else
-                            lastNode = Position(unitPath.back()->Center());
-
+                    if (snapshot.order(unit) != Orders::AttackMove ||
+                        distance(snapshot.orderTargetPosition(unit), getPosition()) >= 400) {
+                        Position orderPosition;
                         if (getPosition().getApproxDistance(lastNode) <= 350)
                             orderPosition = lastNode;
                         else {
@@ -126,29 +158,34 @@ void Squad::update() {
                         unit->attack(orderPosition);
 
                         // debug
-                        Broodwar->registerEvent(
-                            [unit, orderPosition](Game *) {
-                                Broodwar->drawLineMap(unit->getPosition(), orderPosition,
-                                                      Colors::Purple);
-                            },
-                            [unit](Game *) { return unit->exists(); },
-                            Broodwar->getLatencyFrames());
+                        if (watchdog.drawDebug())
+                            Broodwar->registerEvent(
+                                [unit, orderPosition](Game *) {
+                                    Broodwar->drawLineMap(unit->getPosition(), orderPosition,
+                                                          Colors::Purple);
+                                },
+                                [unit](Game *) { return unit->exists(); },
+                                m_timing.period);
                     }
-                } else if (unit->isIdle())
+                } else if (snapshot.isIdle(unit))
                     // Attack!
                     unit->attack(Position(m_kBot->enemy().getClosestPosition()));
                 break;
+            }
             case State::defend:
-                if (distance(unit->getPosition(), Broodwar->self()->getStartLocation()) > 1000) {
+                if (distance(unitPosition, Broodwar->self()->getStartLocation()) > 1000) {
                     // Retreat!
                     // Prevent spamming, check if order is already set.
-                    if (unit->getOrder() != Orders::AttackMove ||
-                        distance(unit->getOrderTargetPosition(),
+                    if (snapshot.order(unit) != Orders::AttackMove ||
+                        distance(snapshot.orderTargetPosition(unit),
                                  Broodwar->self()->getStartLocation()) > 1000)
                         unit->attack(Position(Broodwar->self()->getStartLocation()));
-                } else if (unit->isIdle() && !enemiesNearBase.empty())
+                } else if (snapshot.isIdle(unit) && !enemiesNearBase.empty()) {
                     // Defend!
-                    unit->attack(unit->getClosestUnit(Filter::IsEnemy)->getPosition());
+                    const auto enemy = m_kBot->units().closest(unitPosition, UnitIndex::isEnemy);
+                    if (enemy != nullptr)
+                        unit->attack(snapshot.position(enemy));
+                }
                 break;
             default:
                 throw std::logic_error("Unknown Squad::State!");
@@ -157,6 +194,15 @@ void Squad::update() {
     }
 }
 
+void Squad::refreshPath(Unit unit) {
+    KBOT_PROFILE("BWEM::Map::GetPath");
+
+    int        length;
+    const auto path = m_kBot->map().GetPath(m_kBot->snapshot().position(unit), getPosition(),
+                                            &length);
+    m_paths[unit] = {length, path.empty() ? Positions::None : Position(path.back()->Center())};
+}
+
 std::string to_string(Squad::State state) {
     switch (state) {
     case Squad::State::scout:
@@ -1,7 +1,9 @@
 #pragma once
 
+#include "PeriodicTasks.h"
 #include <BWAPI.h>
 #include <string>
+#include <unordered_map>
 
 namespace KBot {
 
@@ -18,9 +20,31 @@ public:
     void  update();
     State getState() const { return m_state; }
 
+    // Registered with KBot::periodic() on construction, removed by General with the squad.
+    const PeriodicTasks::Timing &getTiming() const { return m_timing; }
+
+    // Average position of the units, read from the snapshot of KBot (hides
+    // BWAPI::Unitset::getPosition()).
+    BWAPI::Position getPosition() const;
+
+    // Queries the path from the unit to the squad, which the attacking units regroup along. Run by
+    // a Scheduler job of General, so that the path queries are spread over the frames.
+    void refreshPath(BWAPI::Unit unit);
+
 private:
-    KBot *m_kBot;
-    State m_state;
+    struct Path {
+        int             length;
+        BWAPI::Position lastNode; // center of the last ChokePoint, Positions::None if there is none
+    };
+
+    KBot *                                m_kBot;
+    State                                 m_state;
+    PeriodicTasks::Timing                 m_timing;
+    std::unordered_map<BWAPI::Unit, Path> m_paths;
+
+    mutable BWAPI::Position m_position;
+    mutable int             m_positionFrame = -1;
+    mutable std::size_t     m_positionSize = 0;
 };
 
 std::string to_string(Squad::State state);
@@ -0,0 +1,165 @@
+#include "Terrain.h"
+
+#include <algorithm>
+#include <fstream>
+
+namespace KBot {
+
+using namespace BWAPI;
+
+namespace {
+
+const char         magic[4] = {'K', 'B', 'T', 'R'};
+const std::int32_t version = 1;
+
+void write(std::ostream &out, std::int32_t value) {
+    out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+void write(std::ostream &out, const std::string &text) {
+    write(out, (std::int32_t) text.size());
+    out.write(text.data(), text.size());
+}
+
+// Packs the flags to bits, 8 per byte.
+void writeBits(std::ostream &out, const std::vector<std::uint8_t> &flags) {
+    std::vector<char> bits((flags.size() + 7) / 8, 0);
+    for (std::size_t i = 0; i < flags.size(); ++i)
+        if (flags[i])
+            bits[i / 8] |= (char) (1 << (i % 8));
+    out.write(bits.data(), bits.size());
+}
+
+std::int32_t readInt(std::istream &in) {
+    std::int32_t value = 0;
+    in.read(reinterpret_cast<char *>(&value), sizeof(value));
+    return value;
+}
+
+std::string readString(std::istream &in) {
+    const auto size = readInt(in);
+    if (!in || size < 0 || size > 4096)
+        return {};
+    std::string text(size, '\0');
+    in.read(&text[0], size);
+    return text;
+}
+
+std::vector<std::uint8_t> readBits(std::istream &in, std::size_t count) {
+    std::vector<char> bits((count + 7) / 8, 0);
+    in.read(bits.data(), bits.size());
+    std::vector<std::uint8_t> flags(count);
+    for (std::size_t i = 0; i < count; ++i)
+        flags[i] = (bits[i / 8] >> (i % 8)) & 1;
+    return flags;
+}
+
+} // namespace
+
+Terrain Terrain::capture() {
+    Terrain terrain;
+    terrain.name = Broodwar->mapFileName();
+    terrain.hash = Broodwar->mapHash();
+    terrain.width = Broodwar->mapWidth();
+    terrain.height = Broodwar->mapHeight();
+
+    terrain.walkable.resize(terrain.width * 4 * terrain.height * 4);
+    for (int y = 0; y < terrain.height * 4; ++y)
+        for (int x = 0; x < terrain.width * 4; ++x)
+            terrain.walkable[y * terrain.width * 4 + x] = Broodwar->isWalkable(x, y);
+
+    terrain.buildable.resize(terrain.width * terrain.height);
+    terrain.groundHeight.resize(terrain.width * terrain.height);
+    for (int y = 0; y < terrain.height; ++y)
+        for (int x = 0; x < terrain.width; ++x) {
+            terrain.buildable[y * terrain.width + x] = Broodwar->isBuildable(x, y);
+            terrain.groundHeight[y * terrain.width + x] =
+                (std::uint8_t) Broodwar->getGroundHeight(x, y);
+        }
+
+    for (const auto &unit : Broodwar->getStaticNeutralUnits())
+        terrain.neutrals.push_back(
+            {unit->getInitialType(), unit->getInitialPosition(), unit->getInitialResources()});
+
+    for (const auto &location : Broodwar->getStartLocations())
+        terrain.startLocations.push_back(location);
+
+    return terrain;
+}
+
+bool Terrain::save(const std::string &path) const {
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+
+    file.write(magic, sizeof(magic));
+    write(file, version);
+    write(file, name);
+    write(file, hash);
+    write(file, width);
+    write(file, height);
+    writeBits(file, walkable);
+    writeBits(file, buildable);
+    file.write(reinterpret_cast<const char *>(groundHeight.data()), groundHeight.size());
+
+    write(file, (std::int32_t) neutrals.size());
+    for (const auto &neutral : neutrals) {
+        write(file, neutral.type.getID());
+        write(file, neutral.position.x);
+        write(file, neutral.position.y);
+        write(file, neutral.resources);
+    }
+
+    write(file, (std::int32_t) startLocations.size());
+    for (const auto &location : startLocations) {
+        write(file, location.x);
+        write(file, location.y);
+    }
+
+    return (bool) file;
+}
+
+bool Terrain::load(const std::string &path) {
+    std::ifstream file(path, std::ios::binary);
+    char          fileMagic[sizeof(magic)] = {};
+    file.read(fileMagic, sizeof(fileMagic));
+    if (!file || !std::equal(magic, magic + sizeof(magic), fileMagic) || readInt(file) != version)
+        return false;
+
+    name = readString(file);
+    hash = readString(file);
+    width = readInt(file);
+    height = readInt(file);
+    // BWAPI maps are at most 256x256 tiles.
+    if (!file || width <= 0 || height <= 0 || width > 256 || height > 256)
+        return false;
+
+    walkable = readBits(file, width * 4 * height * 4);
+    buildable = readBits(file, width * height);
+    groundHeight.resize(width * height);
+    file.read(reinterpret_cast<char *>(groundHeight.data()), groundHeight.size());
+
+    const auto neutralCount = readInt(file);
+    if (!file || neutralCount < 0 || neutralCount > 10000)
+        return false;
+    neutrals.resize(neutralCount);
+    for (auto &neutral : neutrals) {
+        neutral.type = UnitType(readInt(file));
+        neutral.position.x = readInt(file);
+        neutral.position.y = readInt(file);
+        neutral.resources = readInt(file);
+    }
+
+    const auto startLocationCount = readInt(file);
+    if (!file || startLocationCount < 0 || startLocationCount > 8)
+        return false;
+    startLocations.resize(startLocationCount);
+    for (auto &location : startLocations) {
+        location.x = readInt(file);
+        location.y = readInt(file);
+    }
+
+    return (bool) file;
+}
+
+} // namespace
@@ -0,0 +1,53 @@
+#pragma once
+
+// Compile-time switch: build with KBOT_TERRAIN_DUMP=1 to have KBot::onStart dump the terrain of
+// every new map (the Debug configuration does). Off by default, to keep it out of tournament games.
+#ifndef KBOT_TERRAIN_DUMP
+#define KBOT_TERRAIN_DUMP 0
+#endif
+
+#include <BWAPI.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace KBot {
+
+// The static data of a map, as BWEM reads it from BWAPI: walkability, buildability, ground height,
+// the static neutral units and the start locations. With KBOT_TERRAIN_DUMP, KBot dumps the terrain
+// of every map it plays on (see KBot::onStart), so that the headless backend in tools/headless and
+// the map benchmarks can run the analysis offline.
+struct Terrain {
+    struct Neutral {
+        BWAPI::UnitType type;
+        BWAPI::Position position; // center, as BWAPI::Unit::getInitialPosition()
+        int             resources;
+    };
+
+    std::string name; // BWAPI::Game::mapFileName()
+    std::string hash; // BWAPI::Game::mapHash()
+    int         width = 0;  // tiles
+    int         height = 0; // tiles
+
+    std::vector<std::uint8_t>        walkable;     // per walk tile, row by row
+    std::vector<std::uint8_t>        buildable;    // per tile, row by row
+    std::vector<std::uint8_t>        groundHeight; // per tile, as BWAPI::Game::getGroundHeight()
+    std::vector<Neutral>             neutrals;
+    std::vector<BWAPI::TilePosition> startLocations;
+
+    // Copies the terrain of the current game from BWAPI::Broodwar.
+    static Terrain capture();
+
+    // Writes the terrain to a binary file. Returns false if the file could not be written.
+    bool save(const std::string &path) const;
+
+    // Reads a file written by save(). Returns false if the file could not be read or is not a
+    // terrain dump of this version.
+    bool load(const std::string &path);
+
+    bool isWalkable(int x, int y) const { return walkable[y * width * 4 + x] != 0; }
+    bool isBuildable(int x, int y) const { return buildable[y * width + x] != 0; }
+    int  getGroundHeight(int x, int y) const { return groundHeight[y * width + x]; }
+};
+
+} // namespace
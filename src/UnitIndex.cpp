@@ -0,0 +1,101 @@
+#include "UnitIndex.h"
+
+#include "Profiler.h"
+#include <cassert>
+
+namespace KBot {
+
+using namespace BWAPI;
+
+void UnitIndex::reset(const BWEM::Map &map) {
+    m_grid = std::make_unique<Grid>(&map);
+    m_cellOf.clear();
+    m_unplaced.clear();
+    m_maxExtent = 0;
+
+    for (const auto &unit : Broodwar->getAllUnits())
+        add(unit);
+}
+
+void UnitIndex::update(const Snapshot &snapshot) {
+    KBOT_PROFILE("UnitIndex::update");
+
+    if (!m_grid)
+        return;
+
+    // Refresh the positions in place and collect the units that left their cell.
+    std::vector<Entry> moved;
+    for (int index = 0; index < m_grid->Width() * m_grid->Height(); ++index) {
+        auto &entries = cell(index).entries;
+        for (std::size_t k = 0; k < entries.size();) {
+            entries[k].position = snapshot.position(entries[k].unit);
+            if (cellIndex(entries[k].position) == index) {
+                ++k;
+                continue;
+            }
+            moved.push_back(entries[k]);
+            entries[k] = entries.back();
+            entries.pop_back();
+        }
+    }
+
+    for (auto &entry : m_unplaced)
+        entry.position = snapshot.position(entry.unit);
+    moved.insert(moved.end(), m_unplaced.begin(), m_unplaced.end());
+    m_unplaced.clear();
+
+    for (const auto &entry : moved)
+        insert(entry);
+}
+
+void UnitIndex::add(Unit unit) {
+    if (!m_grid || !unit->exists())
+        return;
+
+    remove(unit);
+    insert({unit, unit->getPosition(), unit->getPlayer(), unit->getType(),
+            Broodwar->self()->isEnemy(unit->getPlayer())});
+}
+
+void UnitIndex::remove(Unit unit) {
+    const auto it = m_cellOf.find(unit);
+    if (it == m_cellOf.end())
+        return;
+
+    auto &entries = it->second == -1 ? m_unplaced : cell(it->second).entries;
+    const auto entry = std::find_if(entries.begin(), entries.end(),
+                                    [unit](const Entry &e) { return e.unit == unit; });
+    assert(entry != entries.end());
+    *entry = entries.back();
+    entries.pop_back();
+    m_cellOf.erase(it);
+}
+
+int UnitIndex::cellIndex(const Position &position) const {
+    if (!position.isValid())
+        return -1;
+    return (position.y / cellPixels) * m_grid->Width() + position.x / cellPixels;
+}
+
+void UnitIndex::insert(const Entry &entry) {
+    const int index = cellIndex(entry.position);
+    (index == -1 ? m_unplaced : cell(index).entries).push_back(entry);
+    m_cellOf[entry.unit] = index;
+
+    m_maxExtent = std::max({m_maxExtent, entry.type.dimensionLeft(), entry.type.dimensionRight(),
+                            entry.type.dimensionUp(), entry.type.dimensionDown()});
+}
+
+long long UnitIndex::squaredDistance(const Entry &entry, const Position &position) {
+    // Same bounding box as BWAPI::Unit::getLeft(), getTop(), getRight() and getBottom().
+    const int left = entry.position.x - entry.type.dimensionLeft();
+    const int top = entry.position.y - entry.type.dimensionUp();
+    const int right = entry.position.x + entry.type.dimensionRight() + 1;
+    const int bottom = entry.position.y + entry.type.dimensionDown() + 1;
+
+    const long long dx = std::max({left - position.x, position.x - right, 0});
+    const long long dy = std::max({top - position.y, position.y - bottom, 0});
+    return dx * dx + dy * dy;
+}
+
+} // namespace
@@ -0,0 +1,204 @@
+#pragma once
+
+#include "Snapshot.h"
+#include <BWAPI.h>
+#include <BWEM/bwem.h>
+#include <BWEM/gridMap.h>
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace KBot {
+
+// Spatial index of the accessible units, built on a BWEM::utils::GridMap of 4x4 tile cells.
+// It is kept up to date by the unit events of KBot (show, hide, create, destroy, morph, renegade)
+// and by update(), which moves the units that left their cell. Queries only read the index, never
+// the BWAPI client, so that the same radius query can be repeated cheaply within a frame.
+class UnitIndex {
+public:
+    // What the index knows about a unit, as of the last update.
+    struct Entry {
+        BWAPI::Unit     unit;
+        BWAPI::Position position;
+        BWAPI::Player   player;
+        BWAPI::UnitType type;
+        bool            enemy; // player is an enemy of Broodwar->self()
+    };
+
+    // Predicates for the queries below.
+    static bool any(const Entry &) { return true; }
+    static bool isEnemy(const Entry &entry) { return entry.enemy; }
+    static auto ofPlayer(BWAPI::Player player) {
+        return [player](const Entry &entry) { return entry.player == player; };
+    }
+
+    // (Re)builds the index from the accessible units. The map must be initialized.
+    void reset(const BWEM::Map &map);
+
+    // Called every KBot::onFrame(), after the snapshot was taken. Refreshes the positions of the
+    // indexed units.
+    void update(const Snapshot &snapshot);
+
+    // Adds the unit if it is accessible (onUnitShow, onUnitCreate). Refreshes it otherwise.
+    void add(BWAPI::Unit unit);
+
+    // Removes the unit (onUnitHide, onUnitDestroy).
+    void remove(BWAPI::Unit unit);
+
+    // Refreshes the type and the owner of the unit (onUnitMorph, onUnitRenegade).
+    void refresh(BWAPI::Unit unit) { add(unit); }
+
+    // Returns the units within radius of center. As BWAPI::Game::getUnitsInRadius, the distance is
+    // measured from the bounding box of each unit.
+    template <typename Pred>
+    std::vector<BWAPI::Unit> inRadius(const BWAPI::Position &center, int radius, Pred pred) const;
+
+    // Returns the units whose position is in the box [topLeft, bottomRight].
+    template <typename Pred>
+    std::vector<BWAPI::Unit> inBox(const BWAPI::Position &topLeft,
+                                   const BWAPI::Position &bottomRight, Pred pred) const;
+
+    // Returns the k units closest to center (bounding box distance) within maxRadius, closest
+    // first.
+    template <typename Pred>
+    std::vector<BWAPI::Unit> nearest(const BWAPI::Position &center, std::size_t k, Pred pred,
+                                     int maxRadius = std::numeric_limits<int>::max()) const;
+
+    // Returns the closest unit to center within maxRadius, or nullptr if there is none.
+    template <typename Pred>
+    BWAPI::Unit closest(const BWAPI::Position &center, Pred pred,
+                        int maxRadius = std::numeric_limits<int>::max()) const {
+        const auto units = nearest(center, 1, pred, maxRadius);
+        return units.empty() ? nullptr : units.front();
+    }
+
+    std::size_t size() const { return m_cellOf.size(); }
+
+private:
+    struct Cell {
+        std::vector<Entry> entries;
+    };
+
+    static const int cellTiles = 4;
+    static const int cellPixels = cellTiles * 32;
+    using Grid = BWEM::utils::GridMap<Cell, cellTiles>;
+
+    // Index of the cell containing position, or -1 if position is not on the map.
+    int         cellIndex(const BWAPI::Position &position) const;
+    Cell &      cell(int index) {
+        return m_grid->GetCell(index % m_grid->Width(), index / m_grid->Width());
+    }
+    const Cell &cell(int index) const {
+        return m_grid->GetCell(index % m_grid->Width(), index / m_grid->Width());
+    }
+
+    void insert(const Entry &entry);
+
+    // Squared distance from position to the bounding box of the unit.
+    static long long squaredDistance(const Entry &entry, const BWAPI::Position &position);
+
+    // Calls f(entry) for each entry whose cell intersects the box [left, right] x [top, bottom].
+    template <typename F>
+    void forEachInBox(int left, int top, int right, int bottom, F f) const;
+
+    std::unique_ptr<Grid>                m_grid;
+    std::unordered_map<BWAPI::Unit, int> m_cellOf;        // -1 for the units in m_unplaced
+    std::vector<Entry>                   m_unplaced;      // units whose position is unknown
+    int                                  m_maxExtent = 0; // max. distance position -> box edge
+};
+
+template <typename F>
+void UnitIndex::forEachInBox(int left, int top, int right, int bottom, F f) const {
+    if (!m_grid)
+        return;
+    const int i1 = std::max(0, left / cellPixels);
+    const int j1 = std::max(0, top / cellPixels);
+    const int i2 = std::min(m_grid->Width() - 1, right / cellPixels);
+    const int j2 = std::min(m_grid->Height() - 1, bottom / cellPixels);
+
+    for (int j = j1; j <= j2; ++j)
+        for (int i = i1; i <= i2; ++i)
+            for (const auto &entry : m_grid->GetCell(i, j).entries)
+                f(entry);
+}
+
+template <typename Pred>
+std::vector<BWAPI::Unit> UnitIndex::inRadius(const BWAPI::Position &center, int radius,
+                                             Pred pred) const {
+    std::vector<BWAPI::Unit> units;
+    const int                reach = radius + m_maxExtent;
+    const long long          squaredRadius = (long long) radius * radius;
+    forEachInBox(center.x - reach, center.y - reach, center.x + reach, center.y + reach,
+                 [&](const Entry &entry) {
+                     if (squaredDistance(entry, center) <= squaredRadius && pred(entry))
+                         units.push_back(entry.unit);
+                 });
+    return units;
+}
+
+template <typename Pred>
+std::vector<BWAPI::Unit> UnitIndex::inBox(const BWAPI::Position &topLeft,
+                                          const BWAPI::Position &bottomRight, Pred pred) const {
+    std::vector<BWAPI::Unit> units;
+    forEachInBox(topLeft.x, topLeft.y, bottomRight.x, bottomRight.y, [&](const Entry &entry) {
+        if (topLeft.x <= entry.position.x && entry.position.x <= bottomRight.x &&
+            topLeft.y <= entry.position.y && entry.position.y <= bottomRight.y && pred(entry))
+            units.push_back(entry.unit);
+    });
+    return units;
+}
+
+template <typename Pred>
+std::vector<BWAPI::Unit> UnitIndex::nearest(const BWAPI::Position &center, std::size_t k,
+                                            Pred pred, int maxRadius) const {
+    std::vector<std::pair<long long, BWAPI::Unit>> candidates;
+    if (!m_grid || k == 0)
+        return {};
+
+    const long long squaredMaxRadius = (long long) maxRadius * maxRadius;
+    const int       ci = std::min(std::max(center.x / cellPixels, 0), m_grid->Width() - 1);
+    const int       cj = std::min(std::max(center.y / cellPixels, 0), m_grid->Height() - 1);
+    const int maxRing = std::max({ci, cj, m_grid->Width() - 1 - ci, m_grid->Height() - 1 - cj});
+
+    // Visit the rings of cells around the cell of center. Any unit beyond ring r is at least
+    // r * cellPixels - m_maxExtent away, which bounds the search once k candidates are known.
+    for (int ring = 0; ring <= maxRing; ++ring) {
+        for (int j = cj - ring; j <= cj + ring; ++j)
+            for (int i = ci - ring; i <= ci + ring; ++i) {
+                if (std::max(std::abs(i - ci), std::abs(j - cj)) != ring ||
+                    !m_grid->ValidCoords(i, j))
+                    continue;
+                for (const auto &entry : m_grid->GetCell(i, j).entries) {
+                    const auto d = squaredDistance(entry, center);
+                    if (d <= squaredMaxRadius && pred(entry))
+                        candidates.emplace_back(d, entry.unit);
+                }
+            }
+
+        const long long bound = (long long) ring * cellPixels - m_maxExtent;
+        if (bound > 0 && bound > maxRadius)
+            break;
+        if (candidates.size() >= k && bound > 0) {
+            std::nth_element(candidates.begin(), candidates.begin() + (k - 1), candidates.end(),
+                             [](const auto &a, const auto &b) { return a.first < b.first; });
+            if (candidates[k - 1].first <= bound * bound)
+                break;
+        }
+    }
+
+    std::sort(candidates.begin(), candidates.end(),
+              [](const auto &a, const auto &b) { return a.first < b.first; });
+    if (candidates.size() > k)
+        candidates.resize(k);
+
+    std::vector<BWAPI::Unit> units;
+    for (const auto &candidate : candidates)
+        units.push_back(candidate.second);
+    return units;
+}
+
+} // namespace
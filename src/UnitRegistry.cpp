@@ -0,0 +1,71 @@
+#include "UnitRegistry.h"
+
+#include <cassert>
+
+namespace KBot {
+
+using namespace BWAPI;
+
+UnitRegistry::Group UnitRegistry::createGroup(Owner owner, Role role) {
+    m_groups.push_back({owner, role, {}});
+    return (Group) m_groups.size() - 1;
+}
+
+void UnitRegistry::assign(Unit unit, Group group, Unit assignment) {
+    assert(0 <= group && group < (Group) m_groups.size());
+    release(unit);
+
+    const auto id = (std::size_t) unit->getID();
+    if (id >= m_records.size())
+        m_records.resize(id + 1);
+
+    auto &members = m_groups[group].members;
+    auto &units = m_roles[static_cast<std::size_t>(m_groups[group].role)];
+
+    auto &record = m_records[id];
+    record.group = group;
+    record.groupSlot = (std::uint32_t) members.size();
+    record.roleSlot = (std::uint32_t) units.size();
+    record.assignment = assignment;
+    members.push_back(unit);
+    units.push_back(unit);
+}
+
+void UnitRegistry::release(Unit unit) {
+    const auto id = (std::size_t) unit->getID();
+    if (id >= m_records.size() || m_records[id].group == noGroup)
+        return;
+
+    auto &record = m_records[id];
+    auto &group = m_groups[record.group];
+    erase(group.members, record.groupSlot, &Record::groupSlot);
+    erase(m_roles[static_cast<std::size_t>(group.role)], record.roleSlot, &Record::roleSlot);
+    record = Record();
+}
+
+UnitRegistry::Owner UnitRegistry::owner(Unit unit) const {
+    const auto record = find(unit);
+    return record ? m_groups[record->group].owner : Owner::none;
+}
+
+Unit UnitRegistry::assignment(Unit unit) const {
+    const auto record = find(unit);
+    return record ? record->assignment : nullptr;
+}
+
+const UnitRegistry::Record *UnitRegistry::find(Unit unit) const {
+    const auto id = (std::size_t) unit->getID();
+    if (id >= m_records.size() || m_records[id].group == noGroup)
+        return nullptr;
+    return &m_records[id];
+}
+
+void UnitRegistry::erase(std::vector<Unit> &list, std::uint32_t slot,
+                         std::uint32_t Record::*slotMember) {
+    assert(slot < list.size());
+    list[slot] = list.back();
+    m_records[list[slot]->getID()].*slotMember = slot;
+    list.pop_back();
+}
+
+} // namespace
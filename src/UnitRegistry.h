@@ -0,0 +1,75 @@
+#pragma once
+
+#include <BWAPI.h>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace KBot {
+
+// Records which module owns each of my units, in which role and with which assignment. Owners
+// allocate groups (e.g. a base its mineral workers and one group per refinery) and move units
+// between them with assign(). A unit is in at most one group at a time, so transferring or
+// releasing it is O(1) and no owner has to search its containers for it.
+//
+// The records are indexed by BWAPI::Unit::getID(), which is dense. The members of each group and
+// of each role are kept in unordered vectors (removal swaps with the last element).
+class UnitRegistry {
+public:
+    using Group = int;
+    static const Group noGroup = -1;
+
+    enum class Owner : std::uint8_t { none, manager, base, general };
+    enum class Role : std::uint8_t { none, mineralWorker, gasWorker, other, builder, army };
+
+    // Creates an empty group. Groups live as long as the registry.
+    Group createGroup(Owner owner, Role role);
+
+    // Moves the unit into group, out of any group it was in before. The assignment is what the
+    // unit works on in its role (e.g. the refinery of a gas worker), or nullptr.
+    void assign(BWAPI::Unit unit, Group group, BWAPI::Unit assignment = nullptr);
+
+    // Removes the unit from its group, if any.
+    void release(BWAPI::Unit unit);
+
+    // The owner of the group of the unit, and what the unit works on (see assign()).
+    Owner       owner(BWAPI::Unit unit) const;
+    BWAPI::Unit assignment(BWAPI::Unit unit) const;
+
+    // Units in group, in no particular order. Invalidated by assign() and release().
+    const std::vector<BWAPI::Unit> &members(Group group) const { return m_groups[group].members; }
+
+    // Units with role, in no particular order. Invalidated by assign() and release().
+    const std::vector<BWAPI::Unit> &withRole(Role role) const {
+        return m_roles[static_cast<std::size_t>(role)];
+    }
+
+private:
+    struct Record {
+        Group         group = noGroup;
+        std::uint32_t groupSlot = 0; // position in the members of group
+        std::uint32_t roleSlot = 0;  // position in the units with the role of group
+        BWAPI::Unit   assignment = nullptr;
+    };
+
+    struct GroupData {
+        Owner                    owner;
+        Role                     role;
+        std::vector<BWAPI::Unit> members;
+    };
+
+    static const std::size_t roleCount = static_cast<std::size_t>(Role::army) + 1;
+
+    // Returns the record of the unit, or nullptr if it has none.
+    const Record *find(BWAPI::Unit unit) const;
+
+    // Removes the unit from list and fixes the slot of the unit moved into its place.
+    void erase(std::vector<BWAPI::Unit> &list, std::uint32_t slot,
+               std::uint32_t Record::*slotMember);
+
+    std::vector<Record>                             m_records; // indexed by getID()
+    std::vector<GroupData>                          m_groups;
+    std::array<std::vector<BWAPI::Unit>, roleCount> m_roles;
+};
+
+} // namespace
@@ -0,0 +1,132 @@
+#include "Watchdog.h"
+
+#include <BWAPI.h>
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <numeric>
+#include <stdexcept>
+
+namespace KBot {
+
+using namespace BWAPI;
+
+const std::array<Watchdog::Limit, 3> Watchdog::limits = {{{std::chrono::milliseconds(55), 320},
+                                                          {std::chrono::milliseconds(1000), 10},
+                                                          {std::chrono::milliseconds(10000), 1}}};
+const std::chrono::milliseconds Watchdog::stepDownTime(42);
+const std::chrono::milliseconds Watchdog::relaxTime(20);
+
+Watchdog &Watchdog::instance() {
+    static Watchdog watchdog;
+    return watchdog;
+}
+
+void Watchdog::reset() {
+    m_level = Level::full;
+    m_start = std::chrono::steady_clock::now(); // restarts a frame in progress
+    m_frames = 0;
+    m_lastStep = 0;
+    m_overruns = {};
+    m_window.clear();
+    m_log.clear();
+}
+
+void Watchdog::beginFrame() {
+    if (m_depth++ == 0)
+        m_start = std::chrono::steady_clock::now();
+}
+
+void Watchdog::endFrame() {
+    if (--m_depth > 0)
+        return;
+    const auto time = std::chrono::steady_clock::now() - m_start;
+    record(std::chrono::duration<double, std::milli>(time).count());
+}
+
+double Watchdog::mean() const {
+    if (m_window.empty())
+        return 0;
+    return std::accumulate(m_window.begin(), m_window.end(), 0.0) / m_window.size();
+}
+
+double Watchdog::max() const {
+    if (m_window.empty())
+        return 0;
+    return *std::max_element(m_window.begin(), m_window.end());
+}
+
+void Watchdog::record(double time) {
+    ++m_frames;
+    for (std::size_t i = 0; i < limits.size(); ++i)
+        if (time >= limits[i].time.count())
+            ++m_overruns[i];
+
+    if (m_window.size() < (std::size_t) windowFrames)
+        m_window.push_back((float) time);
+    else
+        m_window[(m_frames - 1) % windowFrames] = (float) time;
+
+    if (m_level != Level::postponedAnalysis) {
+        if (time >= limits[1].time.count())
+            step(Level::postponedAnalysis, time);
+        else if (time >= stepDownTime.count() && m_frames - m_lastStep >= cooldownFrames)
+            step(static_cast<Level>(static_cast<int>(m_level) + 1), time);
+    }
+    if (m_level != Level::full && m_frames - m_lastStep >= windowFrames &&
+        max() < relaxTime.count())
+        step(static_cast<Level>(static_cast<int>(m_level) - 1), time);
+}
+
+void Watchdog::step(Level to, double time) {
+    m_log.push_back({Broodwar->getFrameCount(), m_level, to, time, mean()});
+    Broodwar << "Watchdog: " << to_string(m_level) << " -> " << to_string(to) << " (frame took "
+             << (int) time << " ms)" << std::endl;
+
+    m_level = to;
+    m_lastStep = m_frames;
+}
+
+void Watchdog::report(std::ostream &out) const {
+    out << std::fixed << std::setprecision(1) << "frames: " << m_frames << "\n";
+    for (std::size_t i = 0; i < limits.size(); ++i)
+        out << "frames >= " << limits[i].time.count() << " ms: " << m_overruns[i] << " (allowed "
+            << limits[i].allowed << ")\n";
+    out << "last " << m_window.size() << " frames: mean " << mean() << " ms, max " << max()
+        << " ms\n\n";
+
+    out << std::setw(8) << "frame" << "  " << std::left << std::setw(20) << "from"
+        << std::setw(20) << "to" << std::right << std::setw(12) << "time [ms]" << std::setw(12)
+        << "mean [ms]" << "\n";
+    for (const auto &step : m_log)
+        out << std::setw(8) << step.frame << "  " << std::left << std::setw(20)
+            << to_string(step.from) << std::setw(20) << to_string(step.to) << std::right
+            << std::setw(12) << step.time << std::setw(12) << step.mean << "\n";
+}
+
+bool Watchdog::writeReport(const std::string &path) const {
+    std::ofstream file(path);
+    if (!file)
+        return false;
+    file << "KBot watchdog (step down at " << stepDownTime.count() << " ms, step up after "
+         << windowFrames << " frames below " << relaxTime.count() << " ms)\n\n";
+    report(file);
+    return (bool) file;
+}
+
+std::string to_string(Watchdog::Level level) {
+    switch (level) {
+    case Watchdog::Level::full:
+        return "Full";
+    case Watchdog::Level::noDebugDrawing:
+        return "NoDebugDrawing";
+    case Watchdog::Level::reducedPathing:
+        return "ReducedPathing";
+    case Watchdog::Level::postponedAnalysis:
+        return "PostponedAnalysis";
+    default:
+        throw std::logic_error("Unknown Watchdog::Level!");
+    }
+}
+
+} // namespace
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace KBot {
+
+// Guards the tournament frame time limits. A game is lost if more than 320 frames take 55 ms or
+// more, more than 10 frames take 1 s or more, or a single frame takes 10 s or more.
+//
+// The watchdog times every frame and steps down a quality ladder when frames get close to 55 ms:
+// first the debug drawing is dropped, then the per-unit path queries of the squads are replaced
+// by cached distances, and finally the deferrable jobs of the scheduler are postponed. After a
+// calm period, it steps back up one level at a time. Every step is logged.
+class Watchdog {
+public:
+    // The quality ladder, from full quality to the cheapest level.
+    enum class Level { full, noDebugDrawing, reducedPathing, postponedAnalysis };
+
+    struct Limit {
+        std::chrono::milliseconds time;
+        int                       allowed; // frames taking time or more
+    };
+    static const std::array<Limit, 3> limits;
+
+    // Frames taking stepDownTime or more step down one level, at most once per cooldownFrames.
+    // Frames taking limits[1].time or more step down to the cheapest level at once.
+    static const std::chrono::milliseconds stepDownTime;
+    static const int                       cooldownFrames = 24;
+    // Steps up one level if no frame of the last windowFrames took relaxTime or more.
+    static const std::chrono::milliseconds relaxTime;
+    static const int                       windowFrames = 240;
+
+    // Times the enclosing scope as a frame, see beginFrame().
+    class Frame {
+    public:
+        Frame() { instance().beginFrame(); }
+        ~Frame() { instance().endFrame(); }
+
+        Frame(const Frame &) = delete;
+        Frame &operator=(const Frame &) = delete;
+    };
+
+    static Watchdog &instance();
+
+    // Back to full quality, drops the statistics and the log (at the beginning of a game).
+    void reset();
+
+    // Times a frame. Nested calls are ignored: KBot runs as a client executable, whose loop in
+    // main.cpp times all the events of a frame, including the unit events, so the Frame that
+    // KBot::onFrame holds itself is nested in that one.
+    void beginFrame();
+    void endFrame();
+
+    // Start of the frame in progress.
+    std::chrono::steady_clock::time_point frameStart() const { return m_start; }
+
+    Level level() const { return m_level; }
+    bool  drawDebug() const { return m_level < Level::noDebugDrawing; }
+    bool  reducePathing() const { return m_level >= Level::reducedPathing; }
+    bool  postponeAnalysis() const { return m_level >= Level::postponedAnalysis; }
+
+    // Statistics
+    int    frames() const { return m_frames; }
+    int    overruns(std::size_t limit) const { return m_overruns[limit]; }
+    double mean() const; // of the last windowFrames frames, in ms
+    double max() const;  // of the last windowFrames frames, in ms
+
+    // Writes the statistics and the log of the steps.
+    void report(std::ostream &out) const;
+
+    // Writes the report to a file. Returns false if the file could not be written.
+    bool writeReport(const std::string &path) const;
+
+private:
+    struct Step {
+        int    frame;
+        Level  from;
+        Level  to;
+        double time; // ms, of the frame which caused the step
+        double mean; // ms, of the last windowFrames frames
+    };
+
+    Watchdog() = default;
+
+    void record(double time);
+    void step(Level to, double time);
+
+    Level m_level = Level::full;
+    int   m_depth = 0; // nested beginFrame() calls
+    std::chrono::steady_clock::time_point m_start;
+
+    int                m_frames = 0;
+    int                m_lastStep = 0; // frame of the last step
+    std::array<int, 3> m_overruns = {};
+    std::vector<float> m_window; // ring buffer of the frame times in ms
+    std::vector<Step>  m_log;
+};
+
+std::string to_string(Watchdog::Level level);
+
+} // namespace
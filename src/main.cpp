@@ -1,8 +1,12 @@
 #include "KBot.h"
+#include "Recorder.h"
+#include "Watchdog.h"
 #include <BWAPI.h>
 #include <BWAPI/Client.h>
 #include <chrono>
+#include <ctime>
 #include <iostream>
+#include <string>
 #include <thread>
 
 template <typename Bot>
@@ -98,9 +102,19 @@ int main(int /*argc*/, const char ** /*argv*/) {
         std::cout << ++gameCounter << ". game ready!" << std::endl;
         KBot::KBot kbot;
 
+        // Record the game, so that slow frames can be replayed offline (see tools/headless).
+        KBot::Recorder recorder;
+        if (KBOT_RECORDER)
+            recorder.start("bwapi-data/write/KBot_" + std::to_string(std::time(nullptr)) + ".rec");
+
         // Dispatch events
         while (BWAPI::BWAPIClient.isConnected() && BWAPI::Broodwar->isInGame()) {
-            dispatchEvents(kbot);
+            {
+                // The time limits of tournaments apply to all events of a frame.
+                KBot::Watchdog::Frame frame;
+                recorder.record();
+                dispatchEvents(kbot);
+            }
 
             // Trigger shared memory update. Blocks until next frame.
             BWAPI::BWAPIClient.update();
@@ -2,6 +2,7 @@
 
 #pragma once
 
+#include "DistanceOracle.h"
 #include <BWAPI.h>
 #include <BWEM/bwem.h>
 #include <limits>
@@ -9,11 +10,11 @@
 namespace KBot {
 
 // Returns distance between positions considering BWEM paths. Returns max. int if no path is
-// available.
+// available. Distances are memoized by the DistanceOracle (with a precision of 8 pixels).
 template <typename PositionA, typename PositionB>
 int distance(const PositionA &a, const PositionB &b, BWEM::Map &map = BWEM::Map::Instance()) {
-    int length;
-    map.GetPath(BWAPI::Position(a), BWAPI::Position(b), &length);
+    const int length =
+        DistanceOracle::instance().distance(map, BWAPI::Position(a), BWAPI::Position(b));
     return length != -1 ? length : std::numeric_limits<int>::max();
 }
 
@@ -32,6 +33,24 @@ inline bool readyToAcceptOrders(const BWAPI::Unit &unit) {
     return true;
 }
 
+// A merged version of std::min_element and std::find_if.
+template <typename ForwardIt, typename UnaryPredicate, typename Compare>
+ForwardIt min_element_if(ForwardIt first, ForwardIt last, UnaryPredicate p, Compare comp) {
+    while (first != last && !p(*first))
+        ++first;
+    if (first == last)
+        return last;
+
+    ForwardIt smallest = first;
+    ++first;
+    for (; first != last; ++first) {
+        if (p(*first) && comp(*first, *smallest)) {
+            smallest = first;
+        }
+    }
+    return smallest;
+}
+
 // Checks if the given vespene geyser or refinery is available to be mined from.
 inline bool gasAvailable(const BWAPI::Unit &gas) {
     return gas->getType().isRefinery() && gas->getPlayer() == BWAPI::Broodwar->self() &&
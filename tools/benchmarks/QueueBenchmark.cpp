@@ -0,0 +1,167 @@
+// Compares the Dijkstra priority queues used by BWEM's distance computations:
+// the former std::multimap with equal_range/find_if decrease-key vs. BWEM::utils::IndexedHeap.
+// The searches mimic Area::ComputeDistances on random 8-connected tile grids (weights 10000 / 14142).
+//
+// Build and run with: make benchmarks && obj/QueueBenchmark [width height searches seed]
+
+#include <stdexcept>
+
+#include <BWEM/indexedHeap.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <vector>
+
+namespace {
+
+struct Grid {
+    int               width;
+    int               height;
+    std::vector<char> walkable;
+};
+
+Grid randomGrid(int width, int height, std::mt19937 &rng) {
+    Grid grid{width, height, std::vector<char>(width * height, 1)};
+
+    // Random rectangular obstacles, roughly like cliffs and doodads.
+    std::uniform_int_distribution<int> x(0, width - 1), y(0, height - 1), size(1, 8);
+    for (int i = 0; i < width * height / 40; ++i) {
+        const int x0 = x(rng), y0 = y(rng), w = size(rng), h = size(rng);
+        for (int yy = y0; yy < std::min(height, y0 + h); ++yy)
+            for (int xx = x0; xx < std::min(width, x0 + w); ++xx)
+                grid.walkable[yy * grid.width + xx] = 0;
+    }
+
+    return grid;
+}
+
+const int deltas[8][2] = {{-1, -1}, {0, -1}, {+1, -1}, {-1, 0},
+                          {+1, 0},  {-1, +1}, {0, +1}, {+1, +1}};
+
+// Distances from start to every reachable tile (-1 otherwise), using the former multimap queue.
+std::vector<int> dijkstraMultimap(const Grid &grid, int start) {
+    std::vector<int>  dist(grid.walkable.size(), 0); // 0 == not in the queue, as Tile::InternalData
+    std::vector<char> closed(grid.walkable.size(), 0);
+    std::vector<int>  result(grid.walkable.size(), -1);
+
+    std::multimap<int, int> toVisit;
+    toVisit.emplace(0, start);
+
+    while (!toVisit.empty()) {
+        const int currentDist = toVisit.begin()->first;
+        const int current     = toVisit.begin()->second;
+        toVisit.erase(toVisit.begin());
+        dist[current]   = 0;
+        closed[current] = 1;
+        result[current] = currentDist;
+
+        const int cx = current % grid.width, cy = current / grid.width;
+        for (const auto &d : deltas) {
+            const int nx = cx + d[0], ny = cy + d[1];
+            if (nx < 0 || ny < 0 || nx >= grid.width || ny >= grid.height) continue;
+            const int next = ny * grid.width + nx;
+            if (closed[next] || !grid.walkable[next]) continue;
+
+            const int newDist = currentDist + ((d[0] != 0 && d[1] != 0) ? 14142 : 10000);
+            if (dist[next]) {
+                if (newDist < dist[next]) {
+                    auto range = toVisit.equal_range(dist[next]);
+                    auto it    = std::find_if(range.first, range.second,
+                                           [next](const std::pair<const int, int> &e) {
+                                               return e.second == next;
+                                           });
+                    toVisit.erase(it);
+                    dist[next] = newDist;
+                    toVisit.emplace(newDist, next);
+                }
+            } else {
+                dist[next] = newDist;
+                toVisit.emplace(newDist, next);
+            }
+        }
+    }
+
+    return result;
+}
+
+// Same search, using IndexedHeap (reused between searches, as Area::ComputeDistances does).
+std::vector<int> dijkstraIndexedHeap(const Grid &grid, int start,
+                                     BWEM::utils::IndexedHeap<int> &toVisit) {
+    std::vector<char> closed(grid.walkable.size(), 0);
+    std::vector<int>  result(grid.walkable.size(), -1);
+
+    toVisit.Clear();
+    toVisit.Reserve((int) grid.walkable.size());
+    toVisit.Push(start, 0);
+
+    while (!toVisit.Empty()) {
+        const int currentDist = toVisit.TopKey();
+        const int current     = toVisit.Pop();
+        closed[current]       = 1;
+        result[current]       = currentDist;
+
+        const int cx = current % grid.width, cy = current / grid.width;
+        for (const auto &d : deltas) {
+            const int nx = cx + d[0], ny = cy + d[1];
+            if (nx < 0 || ny < 0 || nx >= grid.width || ny >= grid.height) continue;
+            const int next = ny * grid.width + nx;
+            if (closed[next] || !grid.walkable[next]) continue;
+
+            toVisit.PushOrDecrease(next, currentDist + ((d[0] != 0 && d[1] != 0) ? 14142 : 10000));
+        }
+    }
+
+    return result;
+}
+
+template <class F>
+double measureMs(F f) {
+    const auto start = std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    const int      width    = argc > 1 ? std::atoi(argv[1]) : 128;
+    const int      height   = argc > 2 ? std::atoi(argv[2]) : 128;
+    const int      searches = argc > 3 ? std::atoi(argv[3]) : 50;
+    const unsigned seed     = argc > 4 ? (unsigned) std::atoi(argv[4]) : 42;
+
+    std::mt19937 rng(seed);
+    const Grid   grid = randomGrid(width, height, rng);
+
+    std::vector<int>                   starts;
+    std::uniform_int_distribution<int> tile(0, width * height - 1);
+    while ((int) starts.size() < searches) {
+        const int t = tile(rng);
+        if (grid.walkable[t]) starts.push_back(t);
+    }
+
+    std::vector<std::vector<int>> multimapResults, heapResults;
+    BWEM::utils::IndexedHeap<int> heap;
+
+    const double multimapMs = measureMs([&] {
+        for (int start : starts)
+            multimapResults.push_back(dijkstraMultimap(grid, start));
+    });
+    const double heapMs = measureMs([&] {
+        for (int start : starts)
+            heapResults.push_back(dijkstraIndexedHeap(grid, start, heap));
+    });
+
+    const bool same = multimapResults == heapResults;
+
+    std::printf("grid %dx%d, %d searches\n", width, height, searches);
+    std::printf("  std::multimap : %9.2f ms\n", multimapMs);
+    std::printf("  IndexedHeap   : %9.2f ms  (x%.2f)\n", heapMs, multimapMs / heapMs);
+    std::printf("  results       : %s\n", same ? "identical" : "MISMATCH");
+
+    return same ? 0 : 1;
+}
@@ -0,0 +1,30 @@
+// Writes a synthetic terrain dump (see TerrainGenerator.h), for KBotHeadless scenarios or to keep
+// the map of a scaling test.
+//
+//   GenerateTerrain size=192x192,seed=7,plateaus=12 output.terrain
+
+#include "TerrainGenerator.h"
+
+#include <cstdlib>
+#include <iostream>
+
+int main(int argc, const char **argv) {
+    if (argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " key=value,... output.terrain" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    try {
+        const auto terrain = Headless::generateTerrain(Headless::TerrainParameters::parse(argv[1]));
+        if (!terrain.save(argv[2])) {
+            std::cerr << argv[2] << ": cannot write terrain dump" << std::endl;
+            return EXIT_FAILURE;
+        }
+        std::cout << terrain.name << ": " << terrain.neutrals.size() << " neutral units, "
+                  << terrain.startLocations.size() << " start locations" << std::endl;
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
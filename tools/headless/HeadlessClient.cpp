@@ -0,0 +1,160 @@
+// Replaces Client.cpp of BWAPIClient: instead of connecting to Brood War through the shared
+// memory, BWAPI::BWAPIClient plays a game on a Headless::Server. The main loop of KBot (main.cpp)
+// runs unchanged. The game is named by an environment variable:
+//   KBOT_HEADLESS_SCENARIO  a scenario file (see Scenario.h)
+//   KBOT_HEADLESS_REPLAY    a game record (see KBot::Recorder), next to the terrain dump of its map
+// When the match is over, a frame time report is printed to stdout.
+
+#include "Server.h"
+
+#include <BWAPI/Client.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Declared before BWAPI::BWAPIClient, so it is destroyed after it.
+std::unique_ptr<Headless::Server> server;
+bool                              finished = false;
+
+Clock::time_point   lastUpdate;
+Clock::time_point   startTime;
+std::vector<double> frameTimes; // ms spent by the bot, per frame
+int                 unitCommands = 0;
+
+double percentile(const std::vector<double> &sorted, double p) {
+    if (sorted.empty())
+        return 0;
+    return sorted[std::min(sorted.size() - 1, (std::size_t)(p * sorted.size()))];
+}
+
+void report() {
+    const double seconds = std::chrono::duration<double>(Clock::now() - startTime).count();
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "Headless: " << frameTimes.size() << " frames in " << seconds << " s ("
+              << frameTimes.size() / std::max(seconds, 1e-9) << " frames/s)\n";
+    if (frameTimes.empty())
+        return;
+
+    // The first frame includes KBot::onStart (map analysis) and is reported on its own.
+    std::cout << "  first frame (onStart): " << frameTimes.front() << " ms\n";
+    std::vector<double> sorted(frameTimes.begin() + 1, frameTimes.end());
+    std::sort(sorted.begin(), sorted.end());
+    double sum = 0;
+    for (const auto time : sorted)
+        sum += time;
+    const auto over = [&](double limit) {
+        return sorted.end() - std::lower_bound(sorted.begin(), sorted.end(), limit);
+    };
+
+    std::cout << "  frame time [ms]: mean " << sum / std::max<std::size_t>(sorted.size(), 1)
+              << ", p50 " << percentile(sorted, 0.5) << ", p99 " << percentile(sorted, 0.99)
+              << ", max " << (sorted.empty() ? 0 : sorted.back()) << "\n";
+    std::cout << "  frames over 55 ms: " << over(55) << ", over 1 s: " << over(1000)
+              << ", over 10 s: " << over(10000) << "\n";
+
+    // The frames to look at with the profiler
+    std::vector<int> slowest(frameTimes.size() - 1);
+    for (std::size_t i = 0; i < slowest.size(); ++i)
+        slowest[i] = (int) i + 1;
+    const auto count = std::min<std::size_t>(slowest.size(), 5);
+    std::partial_sort(slowest.begin(), slowest.begin() + count, slowest.end(),
+                      [](int a, int b) { return frameTimes[a] > frameTimes[b]; });
+    std::cout << "  slowest frames:";
+    for (std::size_t i = 0; i < count; ++i)
+        std::cout << " " << slowest[i] << " (" << frameTimes[slowest[i]] << " ms)";
+    std::cout << "\n";
+    std::cout << "  unit commands: " << unitCommands << std::endl;
+}
+
+} // namespace
+
+namespace BWAPI {
+
+Client BWAPIClient;
+
+Client::Client() {}
+
+Client::~Client() { disconnect(); }
+
+bool Client::isConnected() const { return server != nullptr; }
+
+bool Client::connect() {
+    if (server)
+        return true;
+
+    const char *scenarioPath = std::getenv("KBOT_HEADLESS_SCENARIO");
+    const char *recordPath = std::getenv("KBOT_HEADLESS_REPLAY");
+    if (scenarioPath == nullptr && recordPath == nullptr) {
+        std::cerr << "Set KBOT_HEADLESS_SCENARIO to a scenario file or KBOT_HEADLESS_REPLAY to a "
+                     "game record."
+                  << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+
+    try {
+        const auto loadTerrain = [](const std::string &path) {
+            KBot::Terrain terrain;
+            if (!terrain.load(path))
+                throw std::runtime_error(path + ": cannot read terrain dump");
+            return terrain;
+        };
+
+        if (recordPath != nullptr) {
+            auto recording = std::make_unique<KBot::Recording>();
+            if (!recording->open(recordPath))
+                throw std::runtime_error(std::string(recordPath) + ": cannot read game record");
+            const std::string path = recordPath;
+            const auto        directory = path.substr(0, path.find_last_of("/\\") + 1);
+            const auto terrain = loadTerrain(directory + recording->header().mapHash + ".terrain");
+            server = std::make_unique<Headless::Server>(terrain, std::move(recording));
+        } else {
+            auto       scenario = Headless::Scenario::load(scenarioPath);
+            const auto terrain = loadTerrain(scenario.terrain);
+            server = std::make_unique<Headless::Server>(terrain, std::move(scenario));
+        }
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+
+    finished = false;
+    frameTimes.clear();
+    unitCommands = 0;
+    return true;
+}
+
+void Client::disconnect() { server.reset(); }
+
+void Client::update() {
+    if (!server)
+        return;
+    if (finished) {
+        // KBot has left the game loop of main.cpp.
+        disconnect();
+        return;
+    }
+
+    // Time spent by the bot since the previous update returned.
+    const auto now = Clock::now();
+    if (server->isInGame())
+        frameTimes.push_back(std::chrono::duration<double, std::milli>(now - lastUpdate).count());
+    else if (server->frame() == 0)
+        startTime = now;
+
+    const bool inGame = server->update();
+    unitCommands += server->unitCommands();
+    if (!inGame) {
+        report();
+        finished = true;
+    }
+    lastUpdate = Clock::now();
+}
+
+} // namespace BWAPI
@@ -0,0 +1,335 @@
+// Benchmark of the BWEM map analysis. Runs BWEM::Map::Initialize repeatedly on terrain dumps (see
+// KBot::Terrain) and reports the distribution of the time of each phase of the analysis, with its
+// allocations and the peak of the heap. The report is written to stdout as JSON, to compare builds;
+// a summary table goes to stderr.
+//
+//   MapBenchmark [--runs N] [--warmup N] [--threads N] terrain...
+//
+// A terrain is either a dump or "synthetic:key=value,..." for a generated map (see
+// TerrainGenerator.h), to draw scaling curves over the map size and density:
+//
+//   MapBenchmark synthetic:size=64 synthetic:size=128 synthetic:size=192 synthetic:size=256
+//
+// --threads 0 (default) uses all hardware threads, as KBot does. --threads 1 is the sequential
+// analysis.
+
+#include "Server.h"
+#include "TerrainGenerator.h"
+
+#include <BWEM/bwem.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <new>
+#include <sstream>
+#include <string>
+#include <sys/resource.h>
+#include <vector>
+
+// Allocation counters. Each block carries its size in a header, for the live byte count.
+
+namespace {
+
+std::atomic<std::size_t> allocations{0};
+std::atomic<std::size_t> allocatedBytes{0};
+std::atomic<std::size_t> liveBytes{0};
+std::atomic<std::size_t> peakBytes{0};
+
+void *allocate(std::size_t size) noexcept {
+    auto *block = static_cast<std::max_align_t *>(std::malloc(size + sizeof(std::max_align_t)));
+    if (block == nullptr)
+        return nullptr;
+    *reinterpret_cast<std::size_t *>(block) = size;
+
+    ++allocations;
+    allocatedBytes += size;
+    const auto live = liveBytes += size;
+    auto       peak = peakBytes.load();
+    while (live > peak && !peakBytes.compare_exchange_weak(peak, live))
+        ;
+    return block + 1;
+}
+
+void deallocate(void *pointer) noexcept {
+    if (pointer == nullptr)
+        return;
+    auto *block = static_cast<std::max_align_t *>(pointer) - 1;
+    liveBytes -= *reinterpret_cast<std::size_t *>(block);
+    std::free(block);
+}
+
+} // namespace
+
+void *operator new(std::size_t size) {
+    if (auto *pointer = allocate(size))
+        return pointer;
+    throw std::bad_alloc();
+}
+void *operator new[](std::size_t size) { return operator new(size); }
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept { return allocate(size); }
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept { return allocate(size); }
+void  operator delete(void *pointer) noexcept { deallocate(pointer); }
+void  operator delete[](void *pointer) noexcept { deallocate(pointer); }
+void  operator delete(void *pointer, std::size_t) noexcept { deallocate(pointer); }
+void  operator delete[](void *pointer, std::size_t) noexcept { deallocate(pointer); }
+void  operator delete(void *pointer, const std::nothrow_t &) noexcept { deallocate(pointer); }
+void  operator delete[](void *pointer, const std::nothrow_t &) noexcept { deallocate(pointer); }
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Sample {
+    double      ms;
+    std::size_t allocations;
+    std::size_t bytes;     // allocated during the phase
+    std::size_t peakBytes; // heap peak during the phase, above the heap before the analysis
+};
+
+struct Phase {
+    std::string         name;
+    std::vector<Sample> samples; // one per run
+};
+
+struct Distribution {
+    double min, median, mean, max, stddev;
+};
+
+Distribution distribution(std::vector<double> values) {
+    if (values.empty())
+        return {0, 0, 0, 0, 0};
+    std::sort(values.begin(), values.end());
+    double sum = 0;
+    for (const auto value : values)
+        sum += value;
+    const double mean = sum / values.size();
+    double       squares = 0;
+    for (const auto value : values)
+        squares += (value - mean) * (value - mean);
+    return {values.front(), values[values.size() / 2], mean, values.back(),
+            std::sqrt(squares / values.size())};
+}
+
+std::string json(const std::string &text) {
+    std::ostringstream out;
+    out << '"';
+    for (const char c : text)
+        if (c == '"' || c == '\\')
+            out << '\\' << c;
+        else if ((unsigned char) c < 0x20)
+            out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int) c << std::dec;
+        else
+            out << c;
+    out << '"';
+    return out.str();
+}
+
+std::ostream &operator<<(std::ostream &out, const Distribution &d) {
+    return out << "{\"min\": " << d.min << ", \"median\": " << d.median << ", \"mean\": " << d.mean
+               << ", \"max\": " << d.max << ", \"stddev\": " << d.stddev << "}";
+}
+
+// Median of a per-run value
+template <typename F>
+std::size_t median(const std::vector<Sample> &samples, F value) {
+    std::vector<std::size_t> values;
+    for (const auto &sample : samples)
+        values.push_back(value(sample));
+    std::sort(values.begin(), values.end());
+    return values.empty() ? 0 : values[values.size() / 2];
+}
+
+struct MapResult {
+    std::string        path;
+    KBot::Terrain      terrain;
+    std::vector<Phase> phases; // in the order of the analysis
+    std::vector<Sample> totals;
+};
+
+// Runs the analysis of one map.
+MapResult benchmark(const std::string &path, int runs, int warmup) {
+    MapResult result;
+    result.path = path;
+    result.terrain = Headless::benchmarkTerrain(path);
+
+    // BWEM reads the map through BWAPI::Broodwar, which the headless server provides.
+    Headless::Scenario scenario;
+    scenario.players.push_back({"KBot", BWAPI::Races::Terran, -1});
+    Headless::Server server(result.terrain, std::move(scenario));
+    server.update();
+
+    auto &              map = BWEM::Map::Instance();
+    std::vector<Sample> samples;
+    std::vector<std::string> names;
+    samples.reserve(64);
+    names.reserve(64);
+    const char *      current = nullptr;
+    Clock::time_point start;
+    std::size_t       startAllocations = 0, startBytes = 0, baseBytes = 0;
+
+    map.SetPhaseObserver([&](const char *phase) {
+        const auto now = Clock::now();
+        if (current != nullptr) {
+            const Sample sample{std::chrono::duration<double, std::milli>(now - start).count(),
+                                allocations - startAllocations, allocatedBytes - startBytes,
+                                peakBytes - baseBytes};
+            samples.push_back(sample);
+            names.emplace_back(current);
+        } else
+            baseBytes = liveBytes; // first phase, the previous analysis is released
+        current = phase;
+        startAllocations = allocations;
+        startBytes = allocatedBytes;
+        peakBytes = liveBytes.load();
+        start = Clock::now();
+    });
+
+    for (int run = -warmup; run < runs; ++run) {
+        samples.clear();
+        names.clear();
+        const auto runStart = Clock::now();
+        const auto runAllocations = allocations.load();
+        const auto runBytes = allocatedBytes.load();
+        std::size_t runPeak = 0;
+        map.Initialize();
+        const auto runEnd = Clock::now();
+        if (run < 0)
+            continue;
+
+        for (std::size_t i = 0; i < samples.size(); ++i) {
+            auto phase = std::find_if(result.phases.begin(), result.phases.end(),
+                                      [&](const Phase &phase) { return phase.name == names[i]; });
+            if (phase == result.phases.end()) {
+                result.phases.push_back({names[i], {}});
+                phase = std::prev(result.phases.end());
+            }
+            phase->samples.push_back(samples[i]);
+            runPeak = std::max(runPeak, samples[i].peakBytes);
+        }
+        result.totals.push_back(
+            {std::chrono::duration<double, std::milli>(runEnd - runStart).count(),
+             allocations - runAllocations, allocatedBytes - runBytes, runPeak});
+    }
+
+    map.SetPhaseObserver(nullptr);
+    return result;
+}
+
+} // namespace
+
+int main(int argc, const char **argv) {
+    const auto usage = [argv]() {
+        std::cerr << "Usage: " << argv[0] << " [--runs N] [--warmup N] [--threads N] terrain..."
+                  << std::endl;
+        return EXIT_FAILURE;
+    };
+
+    int                      runs = 10, warmup = 1, threads = 0;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i) {
+        const std::string argument = argv[i];
+        if ((argument == "--runs" || argument == "--warmup" || argument == "--threads") &&
+            i + 1 < argc) {
+            const int value = std::atoi(argv[++i]);
+            (argument == "--runs" ? runs : argument == "--warmup" ? warmup : threads) = value;
+        } else if (argument.compare(0, 2, "--") == 0)
+            return usage();
+        else
+            paths.push_back(argument);
+    }
+    if (paths.empty() || runs < 1)
+        return usage();
+
+    if (threads != 1)
+        BWEM::Map::Instance().EnableParallelAnalysis(threads);
+
+    std::vector<MapResult> results;
+    try {
+        for (const auto &path : paths)
+            results.push_back(benchmark(path, runs, warmup));
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    rusage resources{};
+    getrusage(RUSAGE_SELF, &resources);
+    const std::time_t now = std::time(nullptr);
+    char              date[32];
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+    // JSON report
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "{\n  \"date\": " << json(date) << ",\n  \"compiler\": " << json(__VERSION__)
+              << ",\n  \"runs\": " << runs << ",\n  \"warmup\": " << warmup
+              << ",\n  \"threads\": " << threads << ",\n  \"peakRssKiB\": " << resources.ru_maxrss
+              << ",\n  \"maps\": [";
+    for (std::size_t m = 0; m < results.size(); ++m) {
+        const auto &result = results[m];
+        const auto  ms = [](const std::vector<Sample> &samples) {
+            std::vector<double> values;
+            for (const auto &sample : samples)
+                values.push_back(sample.ms);
+            return distribution(values);
+        };
+        const auto field = [&](const std::vector<Sample> &samples) {
+            std::ostringstream out;
+            out << std::fixed << std::setprecision(3) << "\"ms\": " << ms(samples)
+                << ", \"allocations\": "
+                << median(samples, [](const Sample &s) { return s.allocations; })
+                << ", \"allocatedBytes\": "
+                << median(samples, [](const Sample &s) { return s.bytes; })
+                << ", \"peakBytes\": "
+                << median(samples, [](const Sample &s) { return s.peakBytes; });
+            return out.str();
+        };
+
+        std::cout << (m == 0 ? "" : ",") << "\n    {\n      \"path\": " << json(result.path)
+                  << ",\n      \"name\": " << json(result.terrain.name)
+                  << ",\n      \"hash\": " << json(result.terrain.hash)
+                  << ",\n      \"width\": " << result.terrain.width
+                  << ",\n      \"height\": " << result.terrain.height
+                  << ",\n      \"total\": {" << field(result.totals) << "},\n      \"phases\": [";
+        for (std::size_t p = 0; p < result.phases.size(); ++p)
+            std::cout << (p == 0 ? "" : ",") << "\n        {\"name\": "
+                      << json(result.phases[p].name) << ", " << field(result.phases[p].samples)
+                      << "}";
+        std::cout << "\n      ]\n    }";
+    }
+    std::cout << "\n  ]\n}" << std::endl;
+
+    // Summary
+    std::cerr << std::fixed << std::setprecision(2);
+    for (const auto &result : results) {
+        std::cerr << result.terrain.name << " (" << result.terrain.width << "x"
+                  << result.terrain.height << "), " << runs << " runs\n";
+        std::cerr << "  " << std::left << std::setw(34) << "phase" << std::right << std::setw(10)
+                  << "median ms" << std::setw(10) << "max ms" << std::setw(10) << "allocs"
+                  << std::setw(12) << "peak KiB" << "\n";
+        const auto line = [](const std::string &name, const std::vector<Sample> &samples) {
+            std::vector<double> values;
+            for (const auto &sample : samples)
+                values.push_back(sample.ms);
+            const auto d = distribution(values);
+            std::cerr << "  " << std::left << std::setw(34) << name << std::right
+                      << std::setw(10) << d.median << std::setw(10) << d.max << std::setw(10)
+                      << median(samples, [](const Sample &s) { return s.allocations; })
+                      << std::setw(12)
+                      << median(samples, [](const Sample &s) { return s.peakBytes; }) / 1024
+                      << "\n";
+        };
+        for (const auto &phase : result.phases)
+            line(phase.name, phase.samples);
+        line("Initialize", result.totals);
+    }
+    std::cerr << "peak RSS: " << resources.ru_maxrss << " KiB" << std::endl;
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,493 @@
+// Micro-benchmark of the BWEM queries the bot runs every frame: Map::GetPath, GetArea,
+// GetNearestArea, BreadthFirstSearch and KBot::distance (with a cold and a warm DistanceOracle).
+// The queries are drawn from seeded random workloads on the analysed map: from units to bases,
+// between nearby units, inside one area and across unconnected areas. For each query set, the
+// report gives the time per query and the cache misses per query from the hardware counters
+// (perf_event_open; null where the kernel does not allow it). JSON goes to stdout, a summary table
+// to stderr, as for MapBenchmark.
+//
+//   QueryBenchmark [--queries N] [--runs N] [--seed N] terrain...
+//
+// A terrain is a dump or "synthetic:key=value,..." (see TerrainGenerator.h).
+
+#include "Server.h"
+#include "TerrainGenerator.h"
+#include "utils.h"
+
+#include <BWEM/bwem.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <linux/perf_event.h>
+#include <random>
+#include <sstream>
+#include <string>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+using namespace BWAPI;
+using Clock = std::chrono::steady_clock;
+
+// Keeps the compiler from dropping the results of the queries.
+volatile std::uint64_t sink = 0;
+
+// Hardware cache counters of the calling thread. A counter that cannot be opened (no PMU in a
+// virtual machine, perf_event_paranoid, ...) reads as -1.
+class CacheCounters {
+public:
+    enum Counter { references, misses, l1dMisses, counterCount };
+    using Values = std::array<std::int64_t, counterCount>;
+
+    static const char *name(int counter) {
+        static const char *names[] = {"cacheReferences", "cacheMisses", "l1dReadMisses"};
+        return names[counter];
+    }
+
+    CacheCounters() {
+        m_fds[references] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES);
+        m_fds[misses] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+        m_fds[l1dMisses] = open(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+                                                        (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                                        (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+    }
+
+    ~CacheCounters() {
+        for (const int fd : m_fds)
+            if (fd != -1)
+                close(fd);
+    }
+
+    CacheCounters(const CacheCounters &) = delete;
+    CacheCounters &operator=(const CacheCounters &) = delete;
+
+    void start() {
+        for (const int fd : m_fds)
+            if (fd != -1) {
+                ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+    }
+
+    Values stop() {
+        Values values;
+        for (int i = 0; i < counterCount; ++i) {
+            std::uint64_t value = 0;
+            values[i] = -1;
+            if (m_fds[i] != -1) {
+                ioctl(m_fds[i], PERF_EVENT_IOC_DISABLE, 0);
+                if (read(m_fds[i], &value, sizeof(value)) == sizeof(value))
+                    values[i] = (std::int64_t) value;
+            }
+        }
+        return values;
+    }
+
+private:
+    static int open(std::uint32_t type, std::uint64_t config) {
+        perf_event_attr attributes;
+        std::memset(&attributes, 0, sizeof(attributes));
+        attributes.size = sizeof(attributes);
+        attributes.type = type;
+        attributes.config = config;
+        attributes.disabled = 1;
+        attributes.exclude_kernel = 1;
+        attributes.exclude_hv = 1;
+        return (int) syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0);
+    }
+
+    std::array<int, counterCount> m_fds;
+};
+
+struct Query {
+    Position a, b;
+};
+
+// Random query workloads on the analysed map.
+class Workloads {
+public:
+    Workloads(const BWEM::Map &map, unsigned seed) : m_map(map), m_engine(seed) {}
+
+    // Any walk position, walkable or not
+    WalkPosition anyWalkPosition() {
+        return WalkPosition(random(m_map.WalkSize().x), random(m_map.WalkSize().y));
+    }
+
+    WalkPosition unwalkableWalkPosition() {
+        for (int tries = 0; tries < 1000; ++tries) {
+            const auto position = anyWalkPosition();
+            if (m_map.GetArea(position) == nullptr)
+                return position;
+        }
+        return anyWalkPosition();
+    }
+
+    TilePosition anyTilePosition() {
+        return TilePosition(random(m_map.Size().x), random(m_map.Size().y));
+    }
+
+    // Center of a walk tile of an area, where a ground unit can stand
+    Position unitPosition(const BWEM::Area *area = nullptr) {
+        for (int tries = 0; tries < 10000; ++tries) {
+            const auto position =
+                area == nullptr
+                    ? anyWalkPosition()
+                    : WalkPosition(area->TopLeft()) +
+                          WalkPosition(random(area->BoundingBoxSize().x * 4),
+                                       random(area->BoundingBoxSize().y * 4));
+            const auto found = m_map.Valid(position) ? m_map.GetArea(position) : nullptr;
+            if (found != nullptr && (area == nullptr || found == area))
+                return Position(position) + Position(4, 4);
+        }
+        return Position(area != nullptr ? area->Top() : WalkPosition(0, 0)) + Position(4, 4);
+    }
+
+    // From a unit anywhere to a base, as the workers and the squads do
+    std::vector<Query> unitToBase(int count) {
+        std::vector<const BWEM::Base *> bases;
+        for (const auto &area : m_map.Areas())
+            for (const auto &base : area.Bases())
+                bases.push_back(&base);
+        std::vector<Query> queries;
+        for (int i = 0; i < count && !bases.empty(); ++i)
+            queries.push_back({unitPosition(), bases[random((int) bases.size())]->Center()});
+        return queries;
+    }
+
+    // Between two units at most ten tiles apart, as in combat
+    std::vector<Query> unitToUnit(int count) {
+        std::vector<Query> queries;
+        for (int tries = 0; (int) queries.size() < count && tries < 100 * count; ++tries) {
+            const auto a = unitPosition();
+            const auto b = a + Position(random(640) - 320, random(640) - 320);
+            if (m_map.Valid(b) && m_map.GetArea(WalkPosition(b)) != nullptr)
+                queries.push_back({a, Position(WalkPosition(b)) + Position(4, 4)});
+        }
+        return queries;
+    }
+
+    // Both ends in the same area, where GetPath needs no choke point
+    std::vector<Query> sameArea(int count) {
+        std::vector<Query> queries;
+        for (int i = 0; i < count && !m_map.Areas().empty(); ++i) {
+            const auto &area = m_map.Areas()[random((int) m_map.Areas().size())];
+            queries.push_back({unitPosition(&area), unitPosition(&area)});
+        }
+        return queries;
+    }
+
+    // Ends in areas that are not connected by ground (islands, or areas closed by neutrals).
+    // Empty if all the areas are connected.
+    std::vector<Query> acrossContinents(int count) {
+        std::vector<Query> queries;
+        const auto &       areas = m_map.Areas();
+        for (int tries = 0; !areas.empty() && (int) queries.size() < count && tries < 100 * count;
+             ++tries) {
+            const auto &a = areas[random((int) areas.size())];
+            const auto &b = areas[random((int) areas.size())];
+            if (!a.AccessibleFrom(&b))
+                queries.push_back({unitPosition(&a), unitPosition(&b)});
+        }
+        return queries;
+    }
+
+private:
+    // In [0, n), the same on every platform
+    int random(int n) { return n > 0 ? (int) (m_engine() % (std::uint32_t) n) : 0; }
+
+    const BWEM::Map &m_map;
+    std::mt19937     m_engine;
+};
+
+struct Result {
+    std::string                        api;
+    std::string                        workload;
+    int                                queries = 0;
+    std::vector<double>                nsPerQuery; // per run
+    std::vector<CacheCounters::Values> counters;   // per run, totals
+};
+
+double median(std::vector<double> values) {
+    if (values.empty())
+        return 0;
+    std::sort(values.begin(), values.end());
+    return values[values.size() / 2];
+}
+
+std::string json(const std::string &text) {
+    std::ostringstream out;
+    out << '"';
+    for (const char c : text)
+        if (c == '"' || c == '\\')
+            out << '\\' << c;
+        else if ((unsigned char) c < 0x20)
+            out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int) c << std::dec;
+        else
+            out << c;
+    out << '"';
+    return out.str();
+}
+
+// Median of a counter per query, or -1 if the counter is not available.
+double perQuery(const Result &result, int counter) {
+    std::vector<double> values;
+    for (const auto &run : result.counters) {
+        if (run[counter] < 0)
+            return -1;
+        values.push_back((double) run[counter] / result.queries);
+    }
+    return median(values);
+}
+
+struct MapResult {
+    std::string         path;
+    KBot::Terrain       terrain;
+    int                 areas = 0;
+    int                 chokePoints = 0;
+    std::vector<Result> results;
+};
+
+class Benchmark {
+public:
+    Benchmark(CacheCounters &counters, int runs) : m_counters(counters), m_runs(runs) {}
+
+    // Times query(i) for i in [0, count). before() runs ahead of each run, out of the timing.
+    void run(std::vector<Result> &results, const std::string &api, const std::string &workload,
+             int count, const std::function<std::uint64_t(int)> &query,
+             const std::function<void()> &before = nullptr) {
+        if (count == 0)
+            return;
+        Result result;
+        result.api = api;
+        result.workload = workload;
+        result.queries = count;
+        for (int run = 0; run < m_runs; ++run) {
+            if (before)
+                before();
+            std::uint64_t checksum = 0;
+            m_counters.start();
+            const auto start = Clock::now();
+            for (int i = 0; i < count; ++i)
+                checksum += query(i);
+            const auto end = Clock::now();
+            result.counters.push_back(m_counters.stop());
+            sink = sink + checksum;
+            result.nsPerQuery.push_back(
+                std::chrono::duration<double, std::nano>(end - start).count() / count);
+        }
+        results.push_back(std::move(result));
+    }
+
+private:
+    CacheCounters &m_counters;
+    const int      m_runs;
+};
+
+MapResult benchmark(const std::string &path, int queries, int runs, unsigned seed,
+                    CacheCounters &counters) {
+    MapResult result;
+    result.path = path;
+    result.terrain = Headless::benchmarkTerrain(path);
+
+    // BWEM reads the map through BWAPI::Broodwar, which the headless server provides.
+    Headless::Scenario scenario;
+    scenario.players.push_back({"KBot", Races::Terran, -1});
+    Headless::Server server(result.terrain, std::move(scenario));
+    server.update();
+
+    auto &map = BWEM::Map::Instance();
+    map.Initialize();
+    result.areas = (int) map.Areas().size();
+    result.chokePoints = map.ChokePointCount();
+
+    Workloads workloads(map, seed);
+    Benchmark bench(counters, runs);
+    auto &    results = result.results;
+
+    const std::vector<std::pair<std::string, std::vector<Query>>> pathWorkloads = {
+        {"unit to base", workloads.unitToBase(queries)},
+        {"unit to unit", workloads.unitToUnit(queries)},
+        {"same area", workloads.sameArea(queries)},
+        {"across continents", workloads.acrossContinents(queries)}};
+
+    for (const auto &workload : pathWorkloads) {
+        const auto &set = workload.second;
+        bench.run(results, "GetPath", workload.first, (int) set.size(), [&](int i) {
+            int length;
+            return map.GetPath(set[i].a, set[i].b, &length).size() + (std::uint64_t) length;
+        });
+    }
+
+    // KBot::distance, with the oracle emptied before each run (every query is a miss) and kept
+    // from a previous pass (every query is a hit).
+    auto &oracle = KBot::DistanceOracle::instance();
+    for (const auto &workload : pathWorkloads) {
+        const auto &set = workload.second;
+        const auto  query = [&](int i) {
+            return (std::uint64_t) KBot::distance(set[i].a, set[i].b);
+        };
+        bench.run(results, "KBot::distance (cold)", workload.first, (int) set.size(), query,
+                  [&]() { oracle.clear(); });
+        bench.run(results, "KBot::distance (warm)", workload.first, (int) set.size(), query,
+                  [&]() {
+                      oracle.clear();
+                      for (const auto &q : set)
+                          KBot::distance(q.a, q.b);
+                  });
+    }
+
+    std::vector<WalkPosition> anyWalk, unwalkable, walkable;
+    std::vector<TilePosition> tiles;
+    for (int i = 0; i < queries; ++i) {
+        anyWalk.push_back(workloads.anyWalkPosition());
+        unwalkable.push_back(workloads.unwalkableWalkPosition());
+        walkable.push_back(WalkPosition(workloads.unitPosition()));
+        tiles.push_back(workloads.anyTilePosition());
+    }
+
+    const auto areaId = [](const BWEM::Area *area) {
+        return area != nullptr ? (std::uint64_t) area->Id() : 0;
+    };
+    bench.run(results, "GetArea(WalkPosition)", "any position", queries,
+              [&](int i) { return areaId(map.GetArea(anyWalk[i])); });
+    bench.run(results, "GetNearestArea(WalkPosition)", "walkable", queries,
+              [&](int i) { return areaId(map.GetNearestArea(walkable[i])); });
+    bench.run(results, "GetNearestArea(WalkPosition)", "unwalkable", queries,
+              [&](int i) { return areaId(map.GetNearestArea(unwalkable[i])); });
+
+    // The nearest free buildable tile, as the building placer looks for it
+    bench.run(results, "BreadthFirstSearch(TilePosition)", "nearest buildable", queries,
+              [&](int i) {
+                  const auto found = map.BreadthFirstSearch(
+                      tiles[i],
+                      [](const BWEM::Tile &tile, TilePosition) {
+                          return tile.Buildable() && tile.GetNeutral() == nullptr;
+                      },
+                      [](const BWEM::Tile &, TilePosition) { return true; });
+                  return (std::uint64_t) (found.x + found.y);
+              });
+
+    return result;
+}
+
+} // namespace
+
+int main(int argc, const char **argv) {
+    const auto usage = [argv]() {
+        std::cerr << "Usage: " << argv[0] << " [--queries N] [--runs N] [--seed N] terrain..."
+                  << std::endl;
+        return EXIT_FAILURE;
+    };
+
+    int                      queries = 10000, runs = 5, seed = 1;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i) {
+        const std::string argument = argv[i];
+        if ((argument == "--queries" || argument == "--runs" || argument == "--seed") &&
+            i + 1 < argc) {
+            const int value = std::atoi(argv[++i]);
+            (argument == "--queries" ? queries : argument == "--runs" ? runs : seed) = value;
+        } else if (argument.compare(0, 2, "--") == 0)
+            return usage();
+        else
+            paths.push_back(argument);
+    }
+    if (paths.empty() || queries < 1 || runs < 1)
+        return usage();
+
+    // As KBot does
+    BWEM::Map::Instance().EnableParallelAnalysis(0);
+
+    CacheCounters          counters;
+    std::vector<MapResult> maps;
+    try {
+        for (const auto &path : paths)
+            maps.push_back(benchmark(path, queries, runs, (unsigned) seed, counters));
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const std::time_t now = std::time(nullptr);
+    char              date[32];
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+    // JSON report
+    const auto counter = [](double value) {
+        std::ostringstream out;
+        if (value < 0)
+            out << "null";
+        else
+            out << std::fixed << std::setprecision(3) << value;
+        return out.str();
+    };
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "{\n  \"date\": " << json(date) << ",\n  \"compiler\": " << json(__VERSION__)
+              << ",\n  \"queries\": " << queries << ",\n  \"runs\": " << runs
+              << ",\n  \"seed\": " << seed << ",\n  \"maps\": [";
+    for (std::size_t m = 0; m < maps.size(); ++m) {
+        const auto &map = maps[m];
+        std::cout << (m == 0 ? "" : ",") << "\n    {\n      \"path\": " << json(map.path)
+                  << ",\n      \"name\": " << json(map.terrain.name)
+                  << ",\n      \"width\": " << map.terrain.width
+                  << ",\n      \"height\": " << map.terrain.height
+                  << ",\n      \"areas\": " << map.areas
+                  << ",\n      \"chokePoints\": " << map.chokePoints << ",\n      \"queries\": [";
+        for (std::size_t r = 0; r < map.results.size(); ++r) {
+            const auto &result = map.results[r];
+            const auto  ns =
+                std::minmax_element(result.nsPerQuery.begin(), result.nsPerQuery.end());
+            std::cout << (r == 0 ? "" : ",") << "\n        {\"api\": " << json(result.api)
+                      << ", \"workload\": " << json(result.workload)
+                      << ", \"count\": " << result.queries
+                      << ", \"ns\": {\"min\": " << *ns.first
+                      << ", \"median\": " << median(result.nsPerQuery)
+                      << ", \"max\": " << *ns.second << "}";
+            for (int c = 0; c < CacheCounters::counterCount; ++c)
+                std::cout << ", \"" << CacheCounters::name(c)
+                          << "\": " << counter(perQuery(result, c));
+            std::cout << "}";
+        }
+        std::cout << "\n      ]\n    }";
+    }
+    std::cout << "\n  ]\n}" << std::endl;
+
+    // Summary
+    std::cerr << std::fixed << std::setprecision(1);
+    for (const auto &map : maps) {
+        std::cerr << map.terrain.name << " (" << map.terrain.width << "x" << map.terrain.height
+                  << ", " << map.areas << " areas), " << runs << " runs\n";
+        std::cerr << "  " << std::left << std::setw(34) << "query" << std::setw(20) << "workload"
+                  << std::right << std::setw(12) << "ns/query" << std::setw(12) << "misses/q"
+                  << std::setw(12) << "L1D/q" << "\n";
+        for (const auto &result : map.results) {
+            std::cerr << "  " << std::left << std::setw(34) << result.api << std::setw(20)
+                      << result.workload << std::right << std::setw(12)
+                      << median(result.nsPerQuery);
+            for (const int c : {CacheCounters::misses, CacheCounters::l1dMisses}) {
+                const double value = perQuery(result, c);
+                if (value < 0)
+                    std::cerr << std::setw(12) << "-";
+                else
+                    std::cerr << std::setw(12) << value;
+            }
+            std::cerr << "\n";
+        }
+    }
+    if (!maps.front().results.empty() &&
+        perQuery(maps.front().results.front(), CacheCounters::misses) < 0)
+        std::cerr << "cache counters unavailable (see /proc/sys/kernel/perf_event_paranoid)\n";
+    std::cerr << std::flush;
+
+    return EXIT_SUCCESS;
+}
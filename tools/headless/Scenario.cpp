@@ -0,0 +1,120 @@
+#include "Scenario.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace Headless {
+
+using namespace BWAPI;
+
+namespace {
+
+UnitType unitType(const std::string &name) {
+    for (const auto &type : UnitTypes::allUnitTypes())
+        if (type.getName() == name)
+            return type;
+    throw std::runtime_error("unknown unit type \"" + name + "\"");
+}
+
+Race race(const std::string &name) {
+    for (const auto &race : Races::allRaces())
+        if (race.getName() == name)
+            return race;
+    throw std::runtime_error("unknown race \"" + name + "\"");
+}
+
+} // namespace
+
+Scenario Scenario::load(const std::string &path) {
+    std::ifstream file(path);
+    if (!file)
+        throw std::runtime_error(path + ": cannot open scenario");
+
+    Scenario    scenario;
+    std::string line;
+    for (int lineNumber = 1; std::getline(file, line); ++lineNumber) {
+        std::istringstream in(line.substr(0, line.find('#')));
+        std::string        word;
+        if (!(in >> word))
+            continue; // empty line or comment
+
+        try {
+            if (word == "terrain") {
+                in >> scenario.terrain;
+                // Relative to the scenario file
+                const auto directory = path.find_last_of("/\\");
+                if (directory != std::string::npos && !scenario.terrain.empty() &&
+                    scenario.terrain[0] != '/')
+                    scenario.terrain = path.substr(0, directory + 1) + scenario.terrain;
+            } else if (word == "frames")
+                in >> scenario.frames;
+            else if (word == "melee")
+                scenario.melee = true;
+            else if (word == "player") {
+                std::string name, raceName;
+                int         startLocation;
+                in >> name >> raceName >> startLocation;
+                if (in)
+                    scenario.players.push_back({name, race(raceName), startLocation});
+            } else {
+                Action action;
+                action.frame = std::stoi(word);
+                std::string kind;
+                in >> kind;
+                if (kind == "create") {
+                    std::string typeName, flag;
+                    action.kind = Action::Kind::create;
+                    in >> action.unit >> action.player >> typeName >> action.position.x >>
+                        action.position.y;
+                    if (!in)
+                        throw std::runtime_error("missing or invalid arguments");
+                    action.type = unitType(typeName);
+                    if (in >> flag)
+                        action.completed = flag != "incomplete";
+                    in.clear();
+                } else if (kind == "complete") {
+                    action.kind = Action::Kind::complete;
+                    in >> action.unit;
+                } else if (kind == "move") {
+                    action.kind = Action::Kind::move;
+                    in >> action.unit >> action.position.x >> action.position.y;
+                } else if (kind == "destroy") {
+                    action.kind = Action::Kind::destroy;
+                    in >> action.unit;
+                } else if (kind == "resources") {
+                    action.kind = Action::Kind::resources;
+                    in >> action.player >> action.minerals >> action.gas;
+                } else
+                    throw std::runtime_error("unknown statement \"" + kind + "\"");
+
+                const bool hasPlayer = action.kind == Action::Kind::create ||
+                                       action.kind == Action::Kind::resources;
+                if (hasPlayer &&
+                    (action.player < 0 || action.player >= (int) scenario.players.size()))
+                    throw std::runtime_error("unknown player");
+                scenario.actions.push_back(action);
+            }
+
+            if (!in)
+                throw std::runtime_error("missing or invalid arguments");
+        } catch (const std::logic_error &) { // from std::stoi
+            throw std::runtime_error(path + ":" + std::to_string(lineNumber) +
+                                     ": invalid frame \"" + word + "\"");
+        } catch (const std::runtime_error &e) {
+            throw std::runtime_error(path + ":" + std::to_string(lineNumber) + ": " + e.what());
+        }
+    }
+
+    if (scenario.terrain.empty())
+        throw std::runtime_error(path + ": no terrain");
+    if (scenario.players.empty())
+        throw std::runtime_error(path + ": no players");
+
+    std::stable_sort(scenario.actions.begin(), scenario.actions.end(),
+                     [](const Action &a, const Action &b) { return a.frame < b.frame; });
+    return scenario;
+}
+
+} // namespace
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <BWAPI.h>
+#include <string>
+#include <vector>
+
+namespace Headless {
+
+// A scripted game for the headless backend: the players and a timeline of unit changes, read from
+// a text file. One statement per line, '#' starts a comment:
+//
+//   terrain <path>             terrain dump (see KBot::Terrain), relative to the scenario file
+//   frames <count>             length of the game, default 10000
+//   melee                      start with a resource depot and four workers at each start location
+//   player <name> <race> <start location index or -1>
+//                              the first player is KBot, the others are its enemies
+//   <frame> create <id> <player index> <unit type> <x> <y> [incomplete]
+//   <frame> complete <id>
+//   <frame> move <id> <x> <y>
+//   <frame> destroy <id>
+//   <frame> resources <player index> <minerals> <gas>
+//
+// Unit ids are chosen by the scenario, unit types and races are named as in BWAPI (Terran_SCV,
+// Zerg...), positions are in pixels (unit center).
+struct Scenario {
+    struct Player {
+        std::string name;
+        BWAPI::Race race;
+        int         startLocation; // index in the start locations of the terrain, or -1
+    };
+
+    struct Action {
+        enum class Kind { create, complete, move, destroy, resources };
+
+        int             frame;
+        Kind            kind;
+        int             unit = -1;
+        int             player = -1;
+        BWAPI::UnitType type;
+        BWAPI::Position position;
+        bool            completed = true;
+        int             minerals = 0;
+        int             gas = 0;
+    };
+
+    std::string         terrain;
+    int                 frames = 10000;
+    bool                melee = false;
+    std::vector<Player> players;
+    std::vector<Action> actions; // ordered by frame
+
+    // Reads a scenario file. Throws std::runtime_error with the line of the first error.
+    static Scenario load(const std::string &path);
+};
+
+} // namespace
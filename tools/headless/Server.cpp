@@ -0,0 +1,487 @@
+#include "Server.h"
+
+#include <BWAPI/Client.h>
+#include <BWAPI/Client/GameData.h>
+#include <BWAPI/Client/GameImpl.h>
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+
+namespace Headless {
+
+using namespace BWAPI;
+
+namespace {
+
+// BWAPI::GameData has room for 12 players, including the neutral one, and 10000 units.
+const int maxPlayers = 11;
+const int maxUnits = 10000;
+
+template <std::size_t N>
+void copy(char (&destination)[N], const std::string &source) {
+    std::strncpy(destination, source.c_str(), N - 1);
+    destination[N - 1] = '\0';
+}
+
+} // namespace
+
+Server::Server() : m_data(std::make_unique<GameData>()) {
+    // The units and players of BWAPIClient read their data through BWAPI::BWAPIClient.
+    BWAPIClient.data = m_data.get();
+    m_game = std::make_unique<GameImpl>(m_data.get());
+    BroodwarPtr = m_game.get();
+
+    auto &data = *m_data;
+    data.gameType = GameTypes::Melee;
+    data.latency = 2; // LAN latency
+    data.latencyFrames = 2;
+    data.remainingLatencyFrames = 2;
+    data.fps = 24;
+    data.averageFPS = 24;
+}
+
+Server::Server(const KBot::Terrain &terrain, Scenario scenario) : Server() {
+    m_scenario = std::move(scenario);
+    if ((int) m_scenario.players.size() > maxPlayers)
+        throw std::runtime_error("too many players");
+    setMap(terrain);
+
+    auto &data = *m_data;
+
+    // Players: the scenario players, then the neutral player. All scenario players are enemies.
+    const int neutral = (int) m_scenario.players.size();
+    data.playerCount = neutral + 1;
+    for (int i = 0; i <= neutral; ++i) {
+        auto &player = data.players[i];
+        for (int j = 0; j <= neutral; ++j) {
+            player.isAlly[j] = i == j;
+            player.isEnemy[j] = i != j && i != neutral && j != neutral;
+        }
+        player.isNeutral = i == neutral;
+        player.isParticipating = i != neutral;
+        player.startLocationX = TilePositions::None.x;
+        player.startLocationY = TilePositions::None.y;
+
+        if (i == neutral) {
+            copy(player.name, "Neutral");
+            player.race = Races::None;
+            player.type = PlayerTypes::Neutral;
+            continue;
+        }
+
+        const auto &scenarioPlayer = m_scenario.players[i];
+        copy(player.name, scenarioPlayer.name);
+        player.race = scenarioPlayer.race;
+        player.type = i == 0 ? PlayerTypes::Player : PlayerTypes::Computer;
+        player.color = i == 0 ? Colors::Red : Colors::Blue;
+        if (0 <= scenarioPlayer.startLocation &&
+            scenarioPlayer.startLocation < (int) terrain.startLocations.size()) {
+            player.startLocationX = terrain.startLocations[scenarioPlayer.startLocation].x;
+            player.startLocationY = terrain.startLocations[scenarioPlayer.startLocation].y;
+        }
+    }
+    data.self = 0;
+    data.enemy = neutral > 1 ? 1 : -1;
+    data.neutral = neutral;
+
+    // Static neutral units
+    for (const auto &unit : terrain.neutrals)
+        create(neutral, unit.type, unit.position, true, unit.resources);
+}
+
+Server::Server(const KBot::Terrain &terrain, std::unique_ptr<KBot::Recording> recording)
+    : Server() {
+    m_recording = std::move(recording);
+    const auto &header = m_recording->header();
+    if (header.mapHash != terrain.hash)
+        throw std::runtime_error("the terrain dump does not match the map of the record");
+    setMap(terrain);
+
+    auto &data = *m_data;
+    const int playerCount = (int) header.players.size();
+    data.playerCount = playerCount;
+    for (int i = 0; i < playerCount; ++i) {
+        const auto &info = header.players[i];
+        auto &      player = data.players[i];
+        copy(player.name, info.name);
+        player.race = info.race;
+        player.type = info.type;
+        player.isNeutral = info.neutral;
+        player.isParticipating = !info.neutral;
+        player.startLocationX = info.startLocation.x;
+        player.startLocationY = info.startLocation.y;
+        for (int j = 0; j < playerCount; ++j) {
+            player.isAlly[j] = i == j;
+            player.isEnemy[j] = i != j && !info.neutral && !header.players[j].neutral;
+        }
+    }
+    data.self = header.self;
+    data.enemy = header.enemy;
+    data.neutral = header.neutral;
+}
+
+void Server::setMap(const KBot::Terrain &terrain) {
+    auto &data = *m_data;
+    copy(data.mapFileName, terrain.name);
+    copy(data.mapPathName, terrain.name);
+    copy(data.mapName, terrain.name);
+    copy(data.mapHash, terrain.hash);
+    data.mapWidth = terrain.width;
+    data.mapHeight = terrain.height;
+    for (int y = 0; y < terrain.height * 4; ++y)
+        for (int x = 0; x < terrain.width * 4; ++x)
+            data.isWalkable[x][y] = terrain.isWalkable(x, y);
+    for (int y = 0; y < terrain.height; ++y)
+        for (int x = 0; x < terrain.width; ++x) {
+            data.isBuildable[x][y] = terrain.isBuildable(x, y);
+            data.getGroundHeight[x][y] = terrain.getGroundHeight(x, y);
+            data.isVisible[x][y] = true;
+            data.isExplored[x][y] = true;
+        }
+    data.startLocationCount = std::min((int) terrain.startLocations.size(), 8);
+    for (int i = 0; i < data.startLocationCount; ++i) {
+        data.startLocations[i].x = terrain.startLocations[i].x;
+        data.startLocations[i].y = terrain.startLocations[i].y;
+    }
+}
+
+Server::~Server() {
+    if (BroodwarPtr == m_game.get())
+        BroodwarPtr = nullptr;
+    if (BWAPIClient.data == m_data.get())
+        BWAPIClient.data = nullptr;
+}
+
+bool Server::update() {
+    auto &data = *m_data;
+    m_unitCommands = data.unitCommandCount;
+    if (m_ended) {
+        if (data.isInGame) {
+            data.isInGame = false;
+            m_game->onMatchEnd();
+        }
+        return false;
+    }
+
+    // Consume what the bot sent during the previous frame.
+    data.unitCommandCount = 0;
+    data.commandCount = 0;
+    data.shapeCount = 0;
+    data.stringCount = 0;
+    data.eventCount = 0;
+    data.eventStringCount = 0;
+
+    data.frameCount = m_frame;
+    data.elapsedTime = m_frame * 42 / 1000; // seconds at fastest speed
+    if (m_recording)
+        replay();
+    else
+        play();
+
+    if (m_frame == 0)
+        m_game->onMatchStart();
+    m_game->onMatchFrame();
+    ++m_frame;
+    return true;
+}
+
+bool Server::isInGame() const { return m_data->isInGame; }
+
+void Server::play() {
+    if (m_frame == 0)
+        start();
+    for (; m_nextAction < m_scenario.actions.size() &&
+           m_scenario.actions[m_nextAction].frame <= m_frame;
+         ++m_nextAction)
+        apply(m_scenario.actions[m_nextAction]);
+    if (m_frame == 0)
+        m_data->initialUnitCount = m_unitCount;
+    updatePlayers();
+
+    if (m_frame == m_scenario.frames) {
+        pushEvent(EventType::MatchEnd, false);
+        m_ended = true;
+    } else
+        pushEvent(EventType::MatchFrame);
+}
+
+void Server::start() {
+    m_data->isInGame = true;
+    pushEvent(EventType::MatchStart);
+
+    // Melee start: a resource depot and four workers for each player with a start location.
+    for (int i = 0; m_scenario.melee && i < (int) m_scenario.players.size(); ++i) {
+        const auto &player = m_data->players[i];
+        const auto  location = TilePosition(player.startLocationX, player.startLocationY);
+        if (location == TilePositions::None)
+            continue;
+
+        const auto race = Race(player.race);
+        const auto depot = race.getResourceDepot();
+        const auto center = Position(location) + Position(depot.tileSize()) / 2;
+        create(i, depot, center, true);
+        for (int k = 0; k < 4; ++k)
+            create(i, race.getWorker(), center + Position(-48 + 32 * k, depot.height() / 2 + 24),
+                   true);
+        if (race == Races::Zerg)
+            create(i, UnitTypes::Zerg_Overlord, center + Position(0, -64), true);
+    }
+
+    // The units present at the start are discovered on the first frame.
+    for (int index = 0; index < m_unitCount; ++index) {
+        pushEvent(EventType::UnitDiscover, index);
+        pushEvent(EventType::UnitShow, index);
+        const auto &unit = m_data->units[index];
+        if (unit.isCompleted && unit.player != m_data->neutral)
+            pushEvent(EventType::UnitComplete, index);
+    }
+}
+
+void Server::apply(const Scenario::Action &action) {
+    using Kind = Scenario::Action::Kind;
+
+    if (action.kind == Kind::resources) {
+        m_data->players[action.player].minerals = action.minerals;
+        m_data->players[action.player].gas = action.gas;
+        return;
+    }
+
+    if (action.kind == Kind::create) {
+        const int index = create(action.player, action.type, action.position, action.completed);
+        m_units[action.unit] = index;
+        pushEvent(EventType::UnitDiscover, index);
+        pushEvent(EventType::UnitShow, index);
+        if (m_frame > 0)
+            pushEvent(EventType::UnitCreate, index);
+        if (action.completed && m_frame > 0)
+            pushEvent(EventType::UnitComplete, index);
+        return;
+    }
+
+    const auto it = m_units.find(action.unit);
+    if (it == m_units.end())
+        return; // never created or already destroyed
+    auto &unit = m_data->units[it->second];
+
+    switch (action.kind) {
+    case Kind::complete:
+        if (!unit.isCompleted) {
+            unit.isCompleted = true;
+            unit.isIdle = true;
+            unit.remainingBuildTime = 0;
+            unit.order = Orders::PlayerGuard;
+            pushEvent(EventType::UnitComplete, it->second);
+        }
+        break;
+    case Kind::move:
+        unit.positionX = action.position.x;
+        unit.positionY = action.position.y;
+        break;
+    case Kind::destroy:
+        destroy(it->second);
+        m_units.erase(it);
+        break;
+    default:
+        throw std::logic_error("Unknown Scenario::Action::Kind!");
+    }
+}
+
+void Server::replay() {
+    namespace Record = KBot::Record;
+    auto &data = *m_data;
+
+    if (!m_recording->next()) {
+        // The record ends without a MatchEnd event (e.g. the bot crashed).
+        pushEvent(EventType::MatchEnd, false);
+        m_ended = true;
+        return;
+    }
+    data.frameCount = m_recording->frame();
+    data.isInGame = true;
+
+    // Units, the ids of the record are the indexes in BWAPI::GameData::units.
+    for (const auto id : m_recording->removedUnits()) {
+        auto &unit = data.units[id];
+        unit.exists = false;
+        std::fill(std::begin(unit.isVisible), std::end(unit.isVisible), false);
+    }
+    for (const auto id : m_recording->changedUnits()) {
+        const auto &fields = m_recording->unit(id);
+        auto &      unit = data.units[id];
+        if (!unit.exists) {
+            reset(id, fields[Record::player], UnitType(fields[Record::type]), {}, true, 0);
+            m_unitCount = std::max(m_unitCount, id + 1);
+        }
+
+        unit.player = fields[Record::player];
+        unit.type = fields[Record::type];
+        unit.positionX = fields[Record::positionX];
+        unit.positionY = fields[Record::positionY];
+        unit.hitPoints = fields[Record::hitPoints];
+        unit.shields = fields[Record::shields];
+        unit.resources = fields[Record::resources];
+        unit.order = fields[Record::order];
+        unit.orderTargetPositionX = fields[Record::orderTargetX];
+        unit.orderTargetPositionY = fields[Record::orderTargetY];
+        unit.remainingBuildTime = fields[Record::remainingBuildTime];
+        unit.transport = fields[Record::transport];
+
+        const int flags = fields[Record::flags];
+        unit.isCompleted = (flags & Record::completed) != 0;
+        unit.isIdle = (flags & Record::idle) != 0;
+        unit.recentlyAttacked = (flags & Record::underAttack) != 0;
+        unit.isLifted = (flags & Record::lifted) != 0;
+        unit.lockdownTimer = (flags & Record::lockedDown) != 0 ? 1 : 0;
+        unit.maelstromTimer = (flags & Record::maelstrommed) != 0 ? 1 : 0;
+        unit.stasisTimer = (flags & Record::stasised) != 0 ? 1 : 0;
+        unit.isPowered = (flags & Record::powered) != 0;
+        unit.isStuck = (flags & Record::stuck) != 0;
+    }
+    if (m_frame == 0)
+        data.initialUnitCount = m_unitCount;
+
+    // Players
+    const auto &players = m_recording->players();
+    for (int i = 0; i < std::min((int) players.size(), data.playerCount); ++i) {
+        auto &player = data.players[i];
+        player.minerals = players[i][Record::minerals];
+        player.gas = players[i][Record::gas];
+        for (int race = 0; race < 3; ++race) {
+            player.supplyUsed[race] = players[i][Record::supplyUsed + race];
+            player.supplyTotal[race] = players[i][Record::supplyTotal + race];
+        }
+    }
+
+    // Events, with the parameters of the BWAPI server
+    for (const auto &event : m_recording->events())
+        switch (event.type) {
+        case EventType::MatchEnd:
+            pushEvent(event.type, event.winner);
+            m_ended = true;
+            break;
+        case EventType::SendText:
+        case EventType::SaveGame:
+            pushEvent(event.type, addEventString(event.text));
+            break;
+        case EventType::ReceiveText:
+            pushEvent(event.type, event.player, addEventString(event.text));
+            break;
+        case EventType::PlayerLeft:
+            pushEvent(event.type, event.player);
+            break;
+        case EventType::NukeDetect:
+            pushEvent(event.type, event.position.x, event.position.y);
+            break;
+        default:
+            pushEvent(event.type, event.unit);
+        }
+}
+
+int Server::create(int player, UnitType type, Position position, bool completed, int resources) {
+    if (m_unitCount == maxUnits)
+        throw std::runtime_error("too many units");
+
+    const int index = m_unitCount++;
+    reset(index, player, type, position, completed, resources);
+    return index;
+}
+
+void Server::reset(int index, int player, UnitType type, Position position, bool completed,
+                   int resources) {
+    auto &unit = m_data->units[index];
+    unit = UnitData();
+    unit.id = index;
+    unit.replayID = index;
+    unit.player = player;
+    unit.type = type;
+    unit.positionX = position.x;
+    unit.positionY = position.y;
+    unit.hitPoints = type.maxHitPoints();
+    unit.shields = type.maxShields();
+    unit.resources = resources;
+    unit.buildType = UnitTypes::None;
+    unit.tech = TechTypes::None;
+    unit.upgrade = UpgradeTypes::None;
+    unit.remainingBuildTime = completed ? 0 : type.buildTime();
+    unit.order = player == m_data->neutral ? Orders::Nothing
+                                           : completed ? Orders::PlayerGuard : Orders::Nothing;
+    unit.secondaryOrder = Orders::Nothing;
+    unit.targetPositionX = unit.orderTargetPositionX = position.x;
+    unit.targetPositionY = unit.orderTargetPositionY = position.y;
+
+    // No related units
+    unit.buildUnit = unit.target = unit.orderTarget = unit.rallyUnit = unit.addon = -1;
+    unit.nydusExit = unit.powerUp = unit.transport = unit.carrier = unit.hatchery = -1;
+    unit.lastAttackerPlayer = -1;
+
+    unit.exists = true;
+    unit.isCompleted = completed;
+    unit.isIdle = completed;
+    unit.isInterruptible = true;
+    unit.isPowered = true;
+    unit.isDetected = true;
+    std::fill(std::begin(unit.isVisible), std::end(unit.isVisible), true);
+}
+
+void Server::destroy(int index) {
+    auto &unit = m_data->units[index];
+    unit.exists = false;
+    std::fill(std::begin(unit.isVisible), std::end(unit.isVisible), false);
+    pushEvent(EventType::UnitHide, index);
+    pushEvent(EventType::UnitEvade, index);
+    pushEvent(EventType::UnitDestroy, index);
+}
+
+void Server::updatePlayers() {
+    for (int i = 0; i < (int) m_scenario.players.size(); ++i) {
+        auto &player = m_data->players[i];
+        std::fill(std::begin(player.allUnitCount), std::end(player.allUnitCount), 0);
+        std::fill(std::begin(player.visibleUnitCount), std::end(player.visibleUnitCount), 0);
+        std::fill(std::begin(player.completedUnitCount), std::end(player.completedUnitCount), 0);
+        std::fill(std::begin(player.supplyTotal), std::end(player.supplyTotal), 0);
+        std::fill(std::begin(player.supplyUsed), std::end(player.supplyUsed), 0);
+    }
+
+    for (int index = 0; index < m_unitCount; ++index) {
+        const auto &unit = m_data->units[index];
+        if (!unit.exists || unit.player == m_data->neutral)
+            continue;
+
+        auto &     player = m_data->players[unit.player];
+        const auto type = UnitType(unit.type);
+        ++player.allUnitCount[type];
+        ++player.visibleUnitCount[type];
+        if (unit.isCompleted)
+            ++player.completedUnitCount[type];
+
+        // Supply is counted per race (Zerg, Terran, Protoss), in half units.
+        const int race = type.getRace();
+        if (0 <= race && race < 3) {
+            auto &total = player.supplyTotal[race];
+            if (unit.isCompleted)
+                total = std::min(total + type.supplyProvided(), 400);
+            player.supplyUsed[race] += type.supplyRequired();
+        }
+    }
+}
+
+void Server::pushEvent(EventType::Enum type, int v1, int v2) {
+    auto &data = *m_data;
+    if (data.eventCount == GameData::MAX_EVENTS)
+        return;
+    auto &event = data.events[data.eventCount++];
+    event.type = type;
+    event.v1 = v1;
+    event.v2 = v2;
+}
+
+int Server::addEventString(const std::string &text) {
+    auto &data = *m_data;
+    if (data.eventStringCount == GameData::MAX_EVENT_STRINGS)
+        return 0;
+    copy(data.eventStrings[data.eventStringCount], text);
+    return data.eventStringCount++;
+}
+
+} // namespace
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "Recorder.h"
+#include "Scenario.h"
+#include "Terrain.h"
+#include <BWAPI.h>
+#include <memory>
+#include <unordered_map>
+
+namespace BWAPI {
+struct GameData;
+class GameImpl;
+} // namespace BWAPI
+
+namespace Headless {
+
+// Stands in for the Brood War side of BWAPI. It writes a game into a BWAPI::GameData, as the
+// BWAPI server does into the shared memory, and lets the GameImpl of BWAPIClient read it. So
+// BWAPI::Broodwar, the units and the players behave as for a client bot, without Brood War.
+//
+// The terrain comes from a terrain dump. The units come from the timeline of a scenario, played
+// with complete information (everything is visible), or from a game record (see KBot::Recorder),
+// replayed frame by frame with the events and the unit state of the recorded game. Commands of the
+// bot are accepted but have no effect on the game.
+class Server {
+public:
+    Server(const KBot::Terrain &terrain, Scenario scenario);
+    Server(const KBot::Terrain &terrain, std::unique_ptr<KBot::Recording> recording);
+    ~Server();
+
+    // Advances the game by a frame: applies the actions of the scenario (or the next frame of the
+    // record), writes the events and updates BWAPI::Broodwar. The first call starts the match, the
+    // last frame of the scenario (or the record) ends it. Returns false once the match is over.
+    bool update();
+
+    bool isInGame() const;
+    int  frame() const { return m_frame; }
+
+    // Commands issued by the bot during the last frame
+    int unitCommands() const { return m_unitCommands; }
+
+private:
+    Server();
+    void setMap(const KBot::Terrain &terrain);
+
+    // Scenario
+    void play();
+    void start();
+    void apply(const Scenario::Action &action);
+
+    // Record
+    void replay();
+
+    // Creates a unit and returns its index in BWAPI::GameData::units.
+    int  create(int player, BWAPI::UnitType type, BWAPI::Position position, bool completed,
+                int resources = 0);
+    void reset(int index, int player, BWAPI::UnitType type, BWAPI::Position position,
+               bool completed, int resources);
+    void destroy(int index);
+
+    void updatePlayers();
+    void pushEvent(BWAPI::EventType::Enum type, int v1 = 0, int v2 = 0);
+    int  addEventString(const std::string &text);
+
+    Scenario                         m_scenario;
+    std::unique_ptr<KBot::Recording> m_recording;
+
+    std::unique_ptr<BWAPI::GameData> m_data;
+    std::unique_ptr<BWAPI::GameImpl> m_game;
+
+    std::unordered_map<int, int> m_units;         // scenario id -> index
+    int                          m_unitCount = 0; // used indexes in BWAPI::GameData::units
+    std::size_t                  m_nextAction = 0;
+    int                          m_frame = 0;
+    bool                         m_ended = false;
+    int                          m_unitCommands = 0;
+};
+
+} // namespace
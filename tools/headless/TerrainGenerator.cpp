@@ -0,0 +1,385 @@
+#include "TerrainGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+namespace Headless {
+
+using namespace BWAPI;
+
+namespace {
+
+// Ground heights, as BWAPI::Game::getGroundHeight()
+const int lowGround = 0;
+const int highGround = 2;
+const int veryHighGround = 4;
+
+// Tiles between the border of the map and a base
+const int baseMargin = 12;
+
+// Number generator with the same output on every platform. std::mt19937 is specified exactly, the
+// standard distributions are not.
+class Random {
+public:
+    explicit Random(unsigned seed) : m_engine(seed) {}
+
+    // In [min, max]
+    int operator()(int min, int max) {
+        return max <= min ? min : min + (int) (m_engine() % (std::uint32_t)(max - min + 1));
+    }
+
+    double angle() { return (m_engine() % 3600) * 3.14159265358979 / 1800; }
+
+private:
+    std::mt19937 m_engine;
+};
+
+struct Ramp {
+    std::vector<TilePosition> tiles;
+    std::vector<TilePosition> middle; // across the ramp, where it can be blocked
+};
+
+class Generator {
+public:
+    explicit Generator(const TerrainParameters &parameters)
+        : m_parameters(parameters), m_random(parameters.seed), m_width(parameters.width),
+          m_height(parameters.height), m_groundHeight(m_width * m_height, lowGround),
+          m_water(m_width * m_height, 0), m_ramp(m_width * m_height, 0),
+          m_occupied(m_width * m_height, 0) {}
+
+    KBot::Terrain run() {
+        m_terrain.name = m_parameters.name();
+        m_terrain.hash = hash(m_terrain.name);
+        m_terrain.width = m_width;
+        m_terrain.height = m_height;
+
+        addPlateaus();
+        addLakes();
+        addBases();
+        blockRamps();
+        computeWalkability();
+        return std::move(m_terrain);
+    }
+
+private:
+    bool inside(int x, int y) const { return 0 <= x && x < m_width && 0 <= y && y < m_height; }
+    int  index(int x, int y) const { return y * m_width + x; }
+
+    static std::string hash(const std::string &text) {
+        std::uint64_t hash = 14695981039346656037ull; // FNV-1a
+        for (const char c : text)
+            hash = (hash ^ (std::uint8_t) c) * 1099511628211ull;
+        std::ostringstream out;
+        out << std::hex << std::setw(16) << std::setfill('0') << hash;
+        return out.str();
+    }
+
+    // Raises discs of high or very high ground, each with one to three ramps down.
+    void addPlateaus() {
+        const int size = std::min(m_width, m_height);
+        for (int i = 0; i < m_parameters.plateaus; ++i) {
+            const int radius = m_random(std::max(3, size / 20), std::max(4, size / 8));
+            const int cx = m_random(radius + 2, m_width - radius - 3);
+            const int cy = m_random(radius + 2, m_height - radius - 3);
+            const int level = m_random(0, 2) == 0 ? veryHighGround : highGround;
+            for (int y = std::max(0, cy - radius); y <= std::min(m_height - 1, cy + radius); ++y)
+                for (int x = std::max(0, cx - radius); x <= std::min(m_width - 1, cx + radius); ++x)
+                    if ((x - cx) * (x - cx) + (y - cy) * (y - cy) <= radius * radius)
+                        m_groundHeight[index(x, y)] = std::max(m_groundHeight[index(x, y)], level);
+
+            for (int ramps = m_random(1, 3); ramps > 0; --ramps)
+                addRamp(cx, cy, radius);
+        }
+    }
+
+    // A ramp is three tiles wide and four tiles long, across the edge of the plateau.
+    void addRamp(int cx, int cy, int radius) {
+        const double angle = m_random.angle();
+        const double dx = std::cos(angle), dy = std::sin(angle);
+        Ramp         ramp;
+        for (double along = -2; along <= 1.5; along += 0.5)
+            for (double across = -1.5; across <= 1.5; across += 0.5) {
+                const auto tile = TilePosition(
+                    (int) std::floor(cx + (radius + along) * dx - across * dy + 0.5),
+                    (int) std::floor(cy + (radius + along) * dy + across * dx + 0.5));
+                if (!inside(tile.x, tile.y))
+                    continue;
+                if (!m_ramp[index(tile.x, tile.y)]) {
+                    m_ramp[index(tile.x, tile.y)] = 1;
+                    ramp.tiles.push_back(tile);
+                }
+                if (along == 0 && std::find(ramp.middle.begin(), ramp.middle.end(), tile) ==
+                                      ramp.middle.end())
+                    ramp.middle.push_back(tile);
+            }
+        m_ramps.push_back(std::move(ramp));
+    }
+
+    // Lakes are blobs of a few overlapping discs of water on low ground.
+    void addLakes() {
+        const int size = std::min(m_width, m_height);
+        for (int i = 0; i < m_parameters.lakes; ++i) {
+            const int cx = m_random(0, m_width - 1);
+            const int cy = m_random(0, m_height - 1);
+            for (int discs = m_random(2, 5); discs > 0; --discs) {
+                const int radius = m_random(2, size / 16 + 2);
+                const int x0 = cx + m_random(-radius, radius);
+                const int y0 = cy + m_random(-radius, radius);
+                for (int y = y0 - radius; y <= y0 + radius; ++y)
+                    for (int x = x0 - radius; x <= x0 + radius; ++x)
+                        if (inside(x, y) &&
+                            (x - x0) * (x - x0) + (y - y0) * (y - y0) <= radius * radius) {
+                            m_water[index(x, y)] = 1;
+                            m_groundHeight[index(x, y)] = lowGround;
+                        }
+            }
+        }
+    }
+
+    // The start locations lie on a ring around the center of the map, the other bases anywhere,
+    // at least minDistance tiles apart.
+    void addBases() {
+        const int                 minDistance = 16;
+        std::vector<TilePosition> centers;
+        const auto                farEnough = [&](const TilePosition &tile) {
+            for (const auto &center : centers)
+                if (center.getDistance(tile) < minDistance)
+                    return false;
+            return true;
+        };
+
+        const int    starts = std::min(m_parameters.startLocations, 8);
+        const double offset = m_random.angle();
+        const double radius = std::min(m_width, m_height) / 2.0 - baseMargin;
+        for (int i = 0; i < starts; ++i) {
+            const double angle = offset + 2 * 3.14159265358979 * i / starts;
+            const auto   center =
+                TilePosition(clamp((int) (m_width / 2 + radius * std::cos(angle)), m_width),
+                             clamp((int) (m_height / 2 + radius * std::sin(angle)), m_height));
+            if (!farEnough(center))
+                continue;
+            centers.push_back(center);
+            m_terrain.startLocations.push_back(addBase(center));
+        }
+
+        for (int i = 0, tries = 0; i < m_parameters.bases && tries < 100 * m_parameters.bases;
+             ++tries) {
+            const auto center = TilePosition(m_random(baseMargin, m_width - baseMargin - 1),
+                                             m_random(baseMargin, m_height - baseMargin - 1));
+            if (!farEnough(center))
+                continue;
+            centers.push_back(center);
+            addBase(center);
+            ++i;
+        }
+    }
+
+    static int clamp(int value, int size) {
+        return std::max(baseMargin, std::min(size - baseMargin - 1, value));
+    }
+
+    // Levels the surroundings of the resource depot to low ground, then places the mineral fields
+    // on the side facing the border of the map and the vespene geyser beside. Returns the depot
+    // location.
+    TilePosition addBase(const TilePosition &center) {
+        const int flatRadius = 10;
+        for (int y = center.y - flatRadius; y <= center.y + flatRadius; ++y)
+            for (int x = center.x - flatRadius; x <= center.x + flatRadius; ++x)
+                if (inside(x, y) && center.getDistance(TilePosition(x, y)) <= flatRadius) {
+                    m_groundHeight[index(x, y)] = lowGround;
+                    m_water[index(x, y)] = 0;
+                    m_ramp[index(x, y)] = 0;
+                }
+
+        const auto depot = center - TilePosition(2, 1);
+        occupy(depot, UnitTypes::Terran_Command_Center.tileSize());
+
+        enum class Side { up, down, left, right };
+        const int  dx = center.x - m_width / 2;
+        const int  dy = center.y - m_height / 2;
+        const auto side = std::abs(dx) > std::abs(dy) ? (dx > 0 ? Side::right : Side::left)
+                                                       : (dy > 0 ? Side::down : Side::up);
+
+        // Two staggered rows (or columns) of mineral fields, three tiles away from the depot
+        for (int i = 0; i < m_parameters.minerals; ++i) {
+            const int    k = i / 2, odd = i % 2;
+            TilePosition tile;
+            switch (side) {
+            case Side::up:
+                tile = depot + TilePosition(-2 + 2 * k + odd, -4 - odd);
+                break;
+            case Side::down:
+                tile = depot + TilePosition(-2 + 2 * k + odd, 6 + odd);
+                break;
+            case Side::left:
+                tile = depot + TilePosition(-5 - 2 * odd, -1 + k - odd);
+                break;
+            case Side::right:
+                tile = depot + TilePosition(7 + 2 * odd, -1 + k - odd);
+                break;
+            }
+            place(UnitTypes::Mineral_Field, tile, 1500);
+        }
+
+        const auto geyser = side == Side::up || side == Side::down ? depot + TilePosition(-7, 0)
+                                                                   : depot + TilePosition(0, -5);
+        place(UnitTypes::Resource_Vespene_Geyser, geyser, 5000);
+        return depot;
+    }
+
+    // Closes some of the remaining ramps with a line of mineral fields across.
+    void blockRamps() {
+        int blocked = 0;
+        for (std::size_t i = 0; i < m_ramps.size() && blocked < m_parameters.blockedRamps; ++i) {
+            const auto &ramp = m_ramps[(i * 7919 + m_parameters.seed) % m_ramps.size()];
+            const bool  intact = std::all_of(
+                ramp.middle.begin(), ramp.middle.end(),
+                [this](const TilePosition &tile) { return m_ramp[index(tile.x, tile.y)] != 0; });
+            if (!intact || ramp.middle.empty())
+                continue;
+            for (const auto &tile : ramp.middle)
+                place(UnitTypes::Mineral_Field, tile, 0);
+            ++blocked;
+        }
+    }
+
+    void occupy(const TilePosition &topLeft, const TilePosition &size) {
+        for (int y = topLeft.y; y < topLeft.y + size.y; ++y)
+            for (int x = topLeft.x; x < topLeft.x + size.x; ++x)
+                if (inside(x, y))
+                    m_occupied[index(x, y)] = 1;
+    }
+
+    // Places a neutral unit if its tiles are inside the map and free.
+    void place(UnitType type, const TilePosition &topLeft, int resources) {
+        const auto size = type.tileSize();
+        for (int y = topLeft.y; y < topLeft.y + size.y; ++y)
+            for (int x = topLeft.x; x < topLeft.x + size.x; ++x)
+                if (!inside(x, y) || m_occupied[index(x, y)] || m_water[index(x, y)])
+                    return;
+        occupy(topLeft, size);
+        m_terrain.neutrals.push_back(
+            {type, Position(topLeft) + Position(size.x * 16, size.y * 16), resources});
+    }
+
+    // Water is unwalkable. Between two tiles of different heights, the half of the higher tile
+    // facing the lower one is an unwalkable cliff, except on the ramps. A tile is buildable if it
+    // is fully walkable and not part of a ramp.
+    void computeWalkability() {
+        m_terrain.groundHeight.assign(m_groundHeight.begin(), m_groundHeight.end());
+        m_terrain.walkable.assign(m_width * 4 * m_height * 4, 0);
+        m_terrain.buildable.assign(m_width * m_height, 0);
+
+        const auto cliff = [this](int x, int y, int nx, int ny) {
+            return inside(nx, ny) && m_groundHeight[index(nx, ny)] < m_groundHeight[index(x, y)] &&
+                   !m_ramp[index(x, y)] && !m_ramp[index(nx, ny)];
+        };
+
+        for (int y = 0; y < m_height; ++y)
+            for (int x = 0; x < m_width; ++x) {
+                if (m_water[index(x, y)])
+                    continue;
+                const bool left = cliff(x, y, x - 1, y), right = cliff(x, y, x + 1, y);
+                const bool up = cliff(x, y, x, y - 1), down = cliff(x, y, x, y + 1);
+                bool       full = true;
+                for (int wy = 0; wy < 4; ++wy)
+                    for (int wx = 0; wx < 4; ++wx) {
+                        const bool walkable = !(left && wx < 2) && !(right && wx >= 2) &&
+                                              !(up && wy < 2) && !(down && wy >= 2);
+                        m_terrain.walkable[(y * 4 + wy) * m_width * 4 + x * 4 + wx] = walkable;
+                        full = full && walkable;
+                    }
+                m_terrain.buildable[index(x, y)] = full && !m_ramp[index(x, y)];
+            }
+    }
+
+    const TerrainParameters &m_parameters;
+    Random                   m_random;
+    const int                m_width, m_height;
+
+    std::vector<int>          m_groundHeight;
+    std::vector<std::uint8_t> m_water, m_ramp, m_occupied;
+    std::vector<Ramp>         m_ramps;
+    KBot::Terrain             m_terrain;
+};
+
+} // namespace
+
+TerrainParameters TerrainParameters::parse(const std::string &text) {
+    TerrainParameters  parameters;
+    std::istringstream in(text);
+    std::string        item;
+    while (std::getline(in, item, ',')) {
+        const auto equal = item.find('=');
+        if (equal == std::string::npos)
+            throw std::runtime_error("expected key=value instead of \"" + item + "\"");
+        const auto key = item.substr(0, equal);
+        const auto value = item.substr(equal + 1);
+        try {
+            if (key == "size") {
+                const auto x = value.find('x');
+                parameters.width = std::stoi(value.substr(0, x));
+                parameters.height = x == std::string::npos ? parameters.width
+                                                           : std::stoi(value.substr(x + 1));
+            } else if (key == "seed")
+                parameters.seed = (unsigned) std::stoul(value);
+            else if (key == "plateaus")
+                parameters.plateaus = std::stoi(value);
+            else if (key == "lakes")
+                parameters.lakes = std::stoi(value);
+            else if (key == "starts")
+                parameters.startLocations = std::stoi(value);
+            else if (key == "bases")
+                parameters.bases = std::stoi(value);
+            else if (key == "minerals")
+                parameters.minerals = std::stoi(value);
+            else if (key == "blocked")
+                parameters.blockedRamps = std::stoi(value);
+            else
+                throw std::runtime_error("unknown key \"" + key + "\"");
+        } catch (const std::logic_error &) { // from std::stoi
+            throw std::runtime_error("invalid value \"" + value + "\" for " + key);
+        }
+    }
+
+    // BWAPI::GameData holds maps up to 256x256 tiles and 8 start locations.
+    if (parameters.width < 64 || parameters.width > 256 || parameters.height < 64 ||
+        parameters.height > 256)
+        throw std::runtime_error("the size must be between 64 and 256 tiles");
+    if (parameters.startLocations < 0 || parameters.startLocations > 8)
+        throw std::runtime_error("there can be at most 8 start locations");
+    if (parameters.plateaus < 0 || parameters.lakes < 0 || parameters.bases < 0 ||
+        parameters.minerals < 0 || parameters.minerals > 32 || parameters.blockedRamps < 0)
+        throw std::runtime_error("invalid count");
+    return parameters;
+}
+
+std::string TerrainParameters::name() const {
+    std::ostringstream out;
+    out << "synthetic-" << width << "x" << height << "-s" << seed << "-p" << plateaus << "-l"
+        << lakes << "-st" << startLocations << "-b" << bases << "-m" << minerals << "-r"
+        << blockedRamps;
+    return out.str();
+}
+
+KBot::Terrain generateTerrain(const TerrainParameters &parameters) {
+    return Generator(parameters).run();
+}
+
+KBot::Terrain benchmarkTerrain(const std::string &argument) {
+    const std::string synthetic = "synthetic:";
+    if (argument.compare(0, synthetic.size(), synthetic) == 0)
+        return generateTerrain(TerrainParameters::parse(argument.substr(synthetic.size())));
+
+    KBot::Terrain terrain;
+    if (!terrain.load(argument))
+        throw std::runtime_error(argument + ": cannot read terrain dump");
+    return terrain;
+}
+
+} // namespace
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "Terrain.h"
+#include <string>
+
+namespace Headless {
+
+// Parameters of a synthetic map. The same parameters (seed included) always give the same map.
+struct TerrainParameters {
+    int      width = 128;  // tiles, 64 to 256 (BWAPI::GameData)
+    int      height = 128; // tiles, 64 to 256
+    unsigned seed = 1;
+
+    int plateaus = 8;       // high and very high ground, with one to three ramps each
+    int lakes = 3;          // unwalkable water
+    int startLocations = 2; // at most 8, each with a base
+    int bases = 6;          // expansions, besides the start locations
+    int minerals = 8;       // mineral fields per base
+    int blockedRamps = 2;   // ramps closed by a line of mineral fields (0 resources)
+
+    // Reads "key=value,..." with the keys size (WxH), seed, plateaus, lakes, starts, bases,
+    // minerals and blocked. Missing keys keep their default. Throws std::runtime_error.
+    static TerrainParameters parse(const std::string &text);
+
+    // "synthetic-WxH-s<seed>-..." with all the parameters
+    std::string name() const;
+};
+
+// Generates a map for the map analysis benchmarks: low ground with plateaus and their ramps, lakes,
+// bases with mineral fields and a vespene geyser, and ramps blocked by mineral fields. The terrain
+// is served to BWEM through the headless server, as a real map.
+KBot::Terrain generateTerrain(const TerrainParameters &parameters);
+
+// The map of a benchmark argument: "synthetic:key=value,..." is generated, anything else is read
+// as a terrain dump. Throws std::runtime_error.
+KBot::Terrain benchmarkTerrain(const std::string &argument);
+
+} // namespace